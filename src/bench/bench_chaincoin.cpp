@@ -4,7 +4,11 @@
 
 #include <bench/bench.h>
 
+#include <crypto/cubehash512.h>
+#include <crypto/echo512.h>
 #include <crypto/sha256.h>
+#include <crypto/shavite512.h>
+#include <hash.h>
 #include <key.h>
 #include <util/system.h>
 #include <util/strencodings.h>
@@ -26,6 +30,7 @@ static void SetupBenchArgs()
 {
     SetupHelpOptions(gArgs);
 
+    gArgs.AddArg("-c11-breakdown", "Print the time spent in each stage of the C11 hash chain instead of running benchmarks. Can be combined with -evals", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-list", "List benchmarks without executing them. Can be combined with -scaling and -filter", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-evals=<n>", strprintf("Number of measurement evaluations to perform. (default: %u)", DEFAULT_BENCH_EVALUATIONS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-filter=<regex>", strprintf("Regular expression filter to select benchmark by name (default: %s)", DEFAULT_BENCH_FILTER), false, OptionsCategory::OPTIONS);
@@ -36,6 +41,54 @@ static void SetupBenchArgs()
     gArgs.AddArg("-plot-height=<x>", strprintf("Plot height in pixel (default: %u)", DEFAULT_PLOT_HEIGHT), false, OptionsCategory::OPTIONS);
 }
 
+/* Number of chained hashes per stage and evaluation in -c11-breakdown mode */
+static const int C11_BREAKDOWN_ITERATIONS = 20000;
+
+/** Time one C11 stage the way CHashC11 runs it: 64 bytes in, 64 bytes out. */
+template <typename Hasher>
+static double TimeC11Stage(int64_t evaluations)
+{
+    uint8_t buf[64] = {};
+    double best = std::numeric_limits<double>::max();
+    for (int64_t eval = 0; eval < evaluations; eval++) {
+        benchmark::time_point start = benchmark::clock::now();
+        for (int i = 0; i < C11_BREAKDOWN_ITERATIONS; i++) {
+            Hasher().Write(buf, sizeof(buf)).Finalize(buf);
+        }
+        std::chrono::duration<double> elapsed = benchmark::clock::now() - start;
+        best = std::min(best, elapsed.count() / C11_BREAKDOWN_ITERATIONS);
+    }
+    return best;
+}
+
+static void PrintC11Breakdown(int64_t evaluations)
+{
+    const std::vector<std::pair<std::string, double>> stages = {
+        {"blake512", TimeC11Stage<CBLAKE512>(evaluations)},
+        {"bmw512", TimeC11Stage<CBMW512>(evaluations)},
+        {"groestl512", TimeC11Stage<CGROESTL512>(evaluations)},
+        {"jh512", TimeC11Stage<CJH512>(evaluations)},
+        {"keccak512", TimeC11Stage<CKECCAK512>(evaluations)},
+        {"skein512", TimeC11Stage<CSKEIN512>(evaluations)},
+        {"luffa512", TimeC11Stage<CLUFFA512>(evaluations)},
+        {"cubehash512", TimeC11Stage<CCUBEHASH512>(evaluations)},
+        {"shavite512", TimeC11Stage<CSHAVITE512>(evaluations)},
+        {"simd512", TimeC11Stage<CSIMD512>(evaluations)},
+        {"echo512", TimeC11Stage<CECHO512>(evaluations)},
+    };
+
+    double total = 0;
+    for (const auto& stage : stages) {
+        total += stage.second;
+    }
+
+    std::cout << "# C11 stage, ns/hash, share" << std::endl;
+    for (const auto& stage : stages) {
+        tfm::format(std::cout, "%-12s %10.1f %6.1f%%\n", stage.first, stage.second * 1e9, 100.0 * stage.second / total);
+    }
+    tfm::format(std::cout, "%-12s %10.1f %6.1f%%\n", "total", total * 1e9, 100.0);
+}
+
 static fs::path SetDataDir()
 {
     fs::path ret = fs::temp_directory_path() / "bench_chaincoin" / fs::unique_path();
@@ -63,6 +116,9 @@ int main(int argc, char** argv)
     const fs::path bench_datadir{SetDataDir()};
 
     SHA256AutoDetect();
+    ECHO512AutoDetect();
+    SHAVITE512AutoDetect();
+    CUBEHASH512AutoDetect();
     ECC_Start();
     SetupEnvironment();
 
@@ -71,6 +127,13 @@ int main(int argc, char** argv)
     std::string scaling_str = gArgs.GetArg("-scaling", DEFAULT_BENCH_SCALING);
     bool is_list_only = gArgs.GetBoolArg("-list", false);
 
+    if (gArgs.GetBoolArg("-c11-breakdown", false)) {
+        PrintC11Breakdown(evaluations);
+        fs::remove_all(bench_datadir);
+        ECC_Stop();
+        return EXIT_SUCCESS;
+    }
+
     double scaling_factor;
     if (!ParseDouble(scaling_str, &scaling_factor)) {
         tfm::format(std::cerr, "Error parsing scaling factor as double: %s\n", scaling_str.c_str());
@@ -8,6 +8,7 @@
 #include <validation.h>
 #include <streams.h>
 #include <consensus/validation.h>
+#include <hash.h>
 
 namespace block_bench {
 #include <bench/data/block413567.raw.h>
@@ -55,5 +56,39 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     }
 }
 
+// Cost of one header hash without the cache (a full HashC11) and of one
+// cached GetHash() lookup. Each later GetHash() call on an unchanged header
+// pays the second price instead of the first.
+static void BlockHashUncached(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)block_bench::block413567 + sizeof(block_bench::block413567),
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlockHeader header;
+    stream >> header;
+
+    while (state.KeepRunning()) {
+        uint256 hash = HashC11((char*)&(header.nVersion), (char*)&((&(header.nNonce))[1]));
+        assert(!hash.IsNull());
+    }
+}
+
+static void BlockHashCached(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)block_bench::block413567 + sizeof(block_bench::block413567),
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlockHeader header;
+    stream >> header;
+    header.GetHash();
+
+    while (state.KeepRunning()) {
+        uint256 hash = header.GetHash();
+        assert(!hash.IsNull());
+    }
+}
+
 BENCHMARK(DeserializeBlockTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(BlockHashUncached, 500);
+BENCHMARK(BlockHashCached, 500000);
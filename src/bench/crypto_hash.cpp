@@ -15,6 +15,7 @@
 #include <crypto/sha256.h>
 #include <crypto/sha512.h>
 #include <crypto/siphash.h>
+#include <primitives/block.h>
 
 /* Number of bytes to hash per iteration */
 static const uint64_t BUFFER_SIZE = 1000*1000;
@@ -78,6 +79,75 @@ static void SipHash_32b(benchmark::State& state)
     }
 }
 
+/* C11 stages, each hashing the 64-byte output of the previous stage */
+template <typename Hasher>
+static void C11Stage(benchmark::State& state)
+{
+    uint8_t buf[64] = {};
+    while (state.KeepRunning()) {
+        Hasher().Write(buf, sizeof(buf)).Finalize(buf);
+    }
+}
+
+static void C11Stage01_BLAKE512_64b(benchmark::State& state) { C11Stage<CBLAKE512>(state); }
+static void C11Stage02_BMW512_64b(benchmark::State& state) { C11Stage<CBMW512>(state); }
+static void C11Stage03_GROESTL512_64b(benchmark::State& state) { C11Stage<CGROESTL512>(state); }
+static void C11Stage04_JH512_64b(benchmark::State& state) { C11Stage<CJH512>(state); }
+static void C11Stage05_KECCAK512_64b(benchmark::State& state) { C11Stage<CKECCAK512>(state); }
+static void C11Stage06_SKEIN512_64b(benchmark::State& state) { C11Stage<CSKEIN512>(state); }
+static void C11Stage07_LUFFA512_64b(benchmark::State& state) { C11Stage<CLUFFA512>(state); }
+static void C11Stage08_CUBEHASH512_64b(benchmark::State& state) { C11Stage<CCUBEHASH512>(state); }
+static void C11Stage09_SHAVITE512_64b(benchmark::State& state) { C11Stage<CSHAVITE512>(state); }
+static void C11Stage10_SIMD512_64b(benchmark::State& state) { C11Stage<CSIMD512>(state); }
+static void C11Stage11_ECHO512_64b(benchmark::State& state) { C11Stage<CECHO512>(state); }
+
+static void HashC11_80b(benchmark::State& state)
+{
+    uint8_t hash[CHashC11::OUTPUT_SIZE];
+    std::vector<uint8_t> in(80, 0);
+    while (state.KeepRunning()) {
+        CHashC11().Write(in.data(), in.size()).Finalize(hash);
+        in[76]++; // nNonce
+    }
+}
+
+/* Number of headers in a full "headers" message */
+static const int HEADERS_PER_MESSAGE = 2000;
+
+static std::vector<CBlockHeader> MakeHeadersMessage()
+{
+    std::vector<CBlockHeader> headers(HEADERS_PER_MESSAGE);
+    for (int i = 0; i < HEADERS_PER_MESSAGE; i++) {
+        headers[i].nVersion = 4;
+        headers[i].nTime = 1554076800 + i * 90;
+        headers[i].nBits = 0x1d00ffff;
+        headers[i].nNonce = i;
+    }
+    return headers;
+}
+
+static void HashC11_2000Headers(benchmark::State& state)
+{
+    std::vector<CBlockHeader> headers = MakeHeadersMessage();
+    while (state.KeepRunning()) {
+        for (const CBlockHeader& header : headers) {
+            HashC11((char*)&(header.nVersion), (char*)&((&(header.nNonce))[1]));
+        }
+    }
+}
+
+static void HashC11Batch_2000Headers(benchmark::State& state)
+{
+    std::vector<CBlockHeader> headers = MakeHeadersMessage();
+    std::vector<uint256> hashes(headers.size());
+    while (state.KeepRunning()) {
+        for (const CBlockHeader& header : headers) {
+            header.InvalidateHash();
+        }
+        HashC11Batch(headers.data(), headers.size(), hashes.data());
+    }
+}
+
 static void FastRandom_32bit(benchmark::State& state)
 {
     FastRandomContext rng(true);
@@ -102,5 +172,20 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+
+BENCHMARK(C11Stage01_BLAKE512_64b, 1000 * 1000);
+BENCHMARK(C11Stage02_BMW512_64b, 1000 * 1000);
+BENCHMARK(C11Stage03_GROESTL512_64b, 200 * 1000);
+BENCHMARK(C11Stage04_JH512_64b, 300 * 1000);
+BENCHMARK(C11Stage05_KECCAK512_64b, 1000 * 1000);
+BENCHMARK(C11Stage06_SKEIN512_64b, 1000 * 1000);
+BENCHMARK(C11Stage07_LUFFA512_64b, 500 * 1000);
+BENCHMARK(C11Stage08_CUBEHASH512_64b, 300 * 1000);
+BENCHMARK(C11Stage09_SHAVITE512_64b, 300 * 1000);
+BENCHMARK(C11Stage10_SIMD512_64b, 100 * 1000);
+BENCHMARK(C11Stage11_ECHO512_64b, 100 * 1000);
+BENCHMARK(HashC11_80b, 20 * 1000);
+BENCHMARK(HashC11_2000Headers, 10);
+BENCHMARK(HashC11Batch_2000Headers, 10);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
@@ -0,0 +1,84 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <hash.h>
+#include <modules/masternode/masternode_man.h>
+#include <modules/masternode/masternode_sync.h>
+#include <validation.h>
+
+#include <vector>
+
+static const int RANK_MASTERNODES = 5000;
+// longer than the rank cache, so cycling through every height never hits it
+static const int RANK_CHAIN_LENGTH = 64;
+
+/** A short fake active chain and RANK_MASTERNODES masternodes in mnodeman, torn down on destruction. */
+class RankSetup
+{
+public:
+    std::vector<uint256> vBlockHashes;
+    std::vector<CBlockIndex> vBlockIndex;
+    std::vector<COutPoint> vOutpoints;
+
+    RankSetup() : vBlockHashes(RANK_CHAIN_LENGTH), vBlockIndex(RANK_CHAIN_LENGTH)
+    {
+        for (int i = 0; i < RANK_CHAIN_LENGTH; i++) {
+            vBlockHashes[i] = SerializeHash(i);
+            vBlockIndex[i].phashBlock = &vBlockHashes[i];
+            vBlockIndex[i].nHeight = i;
+            vBlockIndex[i].pprev = i > 0 ? &vBlockIndex[i - 1] : nullptr;
+        }
+        chainActive.SetTip(&vBlockIndex.back());
+
+        for (int i = 0; i < RANK_MASTERNODES; i++) {
+            COutPoint outpoint(SerializeHash(i), 1);
+            CMasternode mn(CService(), outpoint, CPubKey(), CNoDestination(), CPubKey(), PROTOCOL_VERSION);
+            mn.nCollateralMinConfBlockHash = vBlockHashes[i % RANK_CHAIN_LENGTH];
+            mnodeman.Add(mn);
+            vOutpoints.push_back(outpoint);
+        }
+
+        // ranks are only calculated once the list is synced
+        masternodeSync.Reset();
+        while (!masternodeSync.IsMasternodeListSynced()) {
+            masternodeSync.SwitchToNextAsset(nullptr);
+        }
+    }
+
+    ~RankSetup()
+    {
+        masternodeSync.Reset();
+        mnodeman.Clear();
+        chainActive.SetTip(nullptr);
+    }
+};
+
+// Rank a masternode at a different height every time, as a node catching up on votes does.
+static void MasternodeRankUncached(benchmark::State& state)
+{
+    RankSetup setup;
+    int nRank;
+    int i = 0;
+    while (state.KeepRunning()) {
+        mnodeman.GetMasternodeRank(setup.vOutpoints[i % RANK_MASTERNODES], nRank, i % RANK_CHAIN_LENGTH);
+        i++;
+    }
+}
+
+// Rank masternodes at the same height, as payment vote and verification checks do.
+static void MasternodeRankCached(benchmark::State& state)
+{
+    RankSetup setup;
+    int nRank;
+    int i = 0;
+    while (state.KeepRunning()) {
+        mnodeman.GetMasternodeRank(setup.vOutpoints[i % RANK_MASTERNODES], nRank, RANK_CHAIN_LENGTH - 1);
+        i++;
+    }
+}
+
+BENCHMARK(MasternodeRankUncached, 50);
+BENCHMARK(MasternodeRankCached, 5000);
@@ -0,0 +1,57 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <index/spentindex.h>
+#include <fs.h>
+#include <streams.h>
+#include <undo.h>
+#include <util/system.h>
+
+namespace block_bench {
+#include <bench/data/block413567.raw.h>
+} // namespace block_bench
+
+// Index the inputs of a full block into an in-memory database, as the spent index
+// does for every block while it syncs. The undo data is made up, only its values
+// end up in the index.
+static void SpentIndexWriteBlock(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)block_bench::block413567 + sizeof(block_bench::block413567),
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+
+    CBlockUndo block_undo;
+    block_undo.vtxundo.resize(block.vtx.size() - 1);
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        for (size_t j = 0; j < block.vtx[i]->vin.size(); ++j) {
+            block_undo.vtxundo[i - 1].vprevout.emplace_back(CTxOut(COIN, CScript()), 413000, false);
+        }
+    }
+
+    // the index database is named after the net-specific datadir, keep it in a directory of its own
+    const fs::path bench_dir = fs::temp_directory_path() / "bench_spentindex" / fs::unique_path();
+    const std::string prev_datadir = gArgs.GetArg("-datadir", "");
+    fs::create_directories(bench_dir);
+    gArgs.ForceSetArg("-datadir", bench_dir.string());
+    ClearDatadirCache();
+    SelectParams(CBaseChainParams::REGTEST);
+    {
+        SpentIndex index(8 << 20, true, true);
+
+        int height = 413567;
+        while (state.KeepRunning()) {
+            bool written = index.WriteSpentOutputs(block, block_undo, height++);
+            assert(written);
+        }
+    }
+    gArgs.ForceSetArg("-datadir", prev_datadir);
+    ClearDatadirCache();
+    fs::remove_all(bench_dir);
+}
+
+BENCHMARK(SpentIndexWriteBlock, 10);
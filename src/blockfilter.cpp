@@ -2,6 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <map>
+#include <mutex>
+#include <sstream>
+
 #include <blockfilter.h>
 #include <crypto/siphash.h>
 #include <hash.h>
@@ -197,6 +201,99 @@ bool GCSFilter::MatchAny(const ElementSet& elements) const
     return MatchInternal(queries.data(), queries.size());
 }
 
+std::vector<bool> GCSFilter::MatchEach(const std::vector<Element>& elements) const
+{
+    // Sort the queries by hash, keeping their position so the flags come out in order
+    std::vector<std::pair<uint64_t, size_t>> queries;
+    queries.reserve(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) {
+        queries.emplace_back(HashToRange(elements[i]), i);
+    }
+    std::sort(queries.begin(), queries.end());
+
+    std::vector<bool> matches(elements.size(), false);
+
+    VectorReader stream(GCS_SER_TYPE, GCS_SER_VERSION, m_encoded, 0);
+
+    // Seek forward by size of N
+    uint64_t N = ReadCompactSize(stream);
+    assert(N == m_N);
+
+    BitStreamReader<VectorReader> bitreader(stream);
+
+    uint64_t value = 0;
+    size_t query_index = 0;
+    for (uint32_t i = 0; i < m_N && query_index < queries.size(); ++i) {
+        uint64_t delta = GolombRiceDecode(bitreader, m_params.m_P);
+        value += delta;
+
+        while (query_index < queries.size() && queries[query_index].first <= value) {
+            if (queries[query_index].first == value) {
+                matches[queries[query_index].second] = true;
+            }
+            query_index++;
+        }
+    }
+
+    return matches;
+}
+
+static const std::map<BlockFilterType, std::string> g_filter_types = {
+    {BlockFilterType::BASIC, "basic"},
+};
+
+const std::string& BlockFilterTypeName(BlockFilterType filter_type)
+{
+    static std::string unknown_retval = "";
+    auto it = g_filter_types.find(filter_type);
+    return it != g_filter_types.end() ? it->second : unknown_retval;
+}
+
+bool BlockFilterTypeByName(const std::string& name, BlockFilterType& filter_type)
+{
+    for (const auto& entry : g_filter_types) {
+        if (entry.second == name) {
+            filter_type = entry.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<BlockFilterType>& AllBlockFilterTypes()
+{
+    static std::vector<BlockFilterType> types;
+
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        types.reserve(g_filter_types.size());
+        for (auto entry : g_filter_types) {
+            types.push_back(entry.first);
+        }
+    });
+
+    return types;
+}
+
+const std::string& ListBlockFilterTypes()
+{
+    static std::string type_list;
+
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        std::stringstream ret;
+        bool first = true;
+        for (auto entry : g_filter_types) {
+            if (!first) ret << ", ";
+            ret << entry.second;
+            first = false;
+        }
+        type_list = ret.str();
+    });
+
+    return type_list;
+}
+
 static GCSFilter::ElementSet BasicFilterElements(const CBlock& block,
                                                  const CBlockUndo& block_undo)
 {
@@ -251,6 +348,8 @@ bool BlockFilter::BuildParams(GCSFilter::Params& params) const
         params.m_P = BASIC_FILTER_P;
         params.m_M = BASIC_FILTER_M;
         return true;
+    case BlockFilterType::INVALID:
+        return false;
     }
 
     return false;
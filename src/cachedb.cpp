@@ -8,7 +8,6 @@
 #include <addrman.h>
 #include <chainparams.h>
 #include <clientversion.h>
-#include <modules/coinjoin/coinjoin_analyzer.h>
 #include <modules/platform/funding.h>
 #include <hash.h>
 #include <netfulfilledman.h>
@@ -18,6 +17,20 @@
 #include <streams.h>
 #include <tinyformat.h>
 #include <util/system.h>
+#include <util/time.h>
+
+namespace {
+// state records of the modules in CModuleCacheDB
+constexpr char DB_MNMAN_STATE = 'M';
+constexpr char DB_MNPAYMENTS_STATE = 'P';
+constexpr char DB_FUNDING_STATE = 'G';
+// funding votes spilled from memory
+constexpr char DB_FUNDING_VOTE = 'w';
+// CoinJoin! depths were kept here before they got their own index
+constexpr char DB_LEGACY_COINJOIN_STATE = 'C';
+}
+
+std::unique_ptr<CModuleCacheDB> g_modulecachedb;
 
 namespace {
 
@@ -156,11 +169,6 @@ CMNCacheDB::CMNCacheDB()
     pathMNCache = GetDataDir() / "mncache.dat";
 }
 
-bool CMNCacheDB::Write(const CMasternodeMan& mncache)
-{
-    return SerializeFileDB("mncache", pathMNCache, mncache);
-}
-
 bool CMNCacheDB::Read(CMasternodeMan& mncache)
 {
     return DeserializeFileDB(pathMNCache, mncache);
@@ -171,11 +179,6 @@ CMNPayDB::CMNPayDB()
     pathMNPay = GetDataDir() / "mnpayments.dat";
 }
 
-bool CMNPayDB::Write(const CMasternodePayments& mnpayments)
-{
-    return SerializeFileDB("mnpayments", pathMNPay, mnpayments);
-}
-
 bool CMNPayDB::Read(CMasternodePayments& mnpayments)
 {
     return DeserializeFileDB(pathMNPay, mnpayments);
@@ -186,11 +189,6 @@ CGovDB::CGovDB()
     pathGovernance = GetDataDir() / "funding.dat";
 }
 
-bool CGovDB::Write(const CGovernanceManager& funding)
-{
-    return SerializeFileDB("funding", pathGovernance, funding);
-}
-
 bool CGovDB::Read(CGovernanceManager& funding)
 {
     return DeserializeFileDB(pathGovernance, funding);
@@ -211,17 +209,180 @@ bool CNetFulDB::Read(CNetFulfilledRequestManager& netfulfilled)
     return DeserializeFileDB(pathNetfulfilled, netfulfilled);
 }
 
-CCoinJoinDB::CCoinJoinDB()
+CModuleCacheDB::CModuleCacheDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    CDBWrapper(GetDataDir() / "modulecache", nCacheSize, fMemory, fWipe),
+    masternodes('m'),
+    paymentVotes('v'),
+    paymentBlocks('b'),
+    fundingObjects('o')
+{
+    CModuleCacheMap<uint256>('c').Wipe(*this);
+    CDBWrapper::Erase(DB_LEGACY_COINJOIN_STATE);
+}
+
+template <typename Data>
+void CModuleCacheDB::WriteState(CDBBatch& batch, char chKey, const Data& data)
+{
+    CDataStream ss(SER_DISK | SER_MODULECACHE, CLIENT_VERSION);
+    ss << data;
+    batch.Write(chKey, std::vector<unsigned char>(ss.begin(), ss.end()));
+}
+
+template <typename Data>
+bool CModuleCacheDB::ReadState(char chKey, Data& data)
+{
+    std::vector<unsigned char> vchState;
+    if (!CDBWrapper::Read(chKey, vchState)) return false;
+
+    try {
+        CDataStream ss(vchState, SER_DISK | SER_MODULECACHE, CLIENT_VERSION);
+        ss >> data;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
+void CModuleCacheDB::Write(CDBBatch& batch, CMasternodeMan& mnodeman)
+{
+    LOCK(mnodeman.cs);
+    masternodes.Write(batch, mnodeman.mapMasternodes, mnodeman.setCacheDirtyMasternodes);
+    if (mnodeman.fCacheStateDirty.exchange(false)) {
+        WriteState(batch, DB_MNMAN_STATE, mnodeman);
+    }
+}
+
+void CModuleCacheDB::Write(CDBBatch& batch, CMasternodePayments& mnpayments)
+{
+    LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+    size_t nChanges = paymentVotes.Write(batch, mnpayments.mapMasternodePaymentVotes, mnpayments.setCacheDirtyVotes);
+    nChanges += paymentBlocks.Write(batch, mnpayments.mapMasternodeBlocks, mnpayments.setCacheDirtyBlocks);
+    // the payments keep nothing besides their maps, the record only has to exist
+    if (nChanges > 0 || !Exists(DB_MNPAYMENTS_STATE)) {
+        WriteState(batch, DB_MNPAYMENTS_STATE, mnpayments);
+    }
+}
+
+void CModuleCacheDB::Write(CDBBatch& batch, CGovernanceManager& funding)
 {
-    pathCoinJoin = GetDataDir() / "coinjoin.dat";
+    LOCK(funding.cs);
+    // votes over the memory limit leave the changed objects in the batch that writes the objects
+    for (const auto& nHash : funding.setCacheDirtyObjects) {
+        auto it = funding.mapObjects.find(nHash);
+        if (it == funding.mapObjects.end()) continue;
+        LOCK(it->second.cs_fobject);
+        for (const auto& votePair : it->second.fileVotes.SpillVotes()) {
+            batch.Write(std::make_pair(DB_FUNDING_VOTE, votePair.first), votePair.second);
+        }
+    }
+    for (const auto& nHash : funding.setCacheErasedVotes) {
+        batch.Erase(std::make_pair(DB_FUNDING_VOTE, nHash));
+    }
+    setErasingVotes.insert(funding.setCacheErasedVotes.begin(), funding.setCacheErasedVotes.end());
+    funding.setCacheErasedVotes.clear();
+    fundingObjects.Write(batch, funding.mapObjects, funding.setCacheDirtyObjects);
+    if (funding.fCacheStateDirty) {
+        funding.fCacheStateDirty = false;
+        WriteState(batch, DB_FUNDING_STATE, funding);
+    }
 }
 
-bool CCoinJoinDB::Write(const CAnalyzer& coinjoin)
+void CModuleCacheDB::Written(CMasternodeMan& mnodeman, CMasternodePayments& mnpayments, CGovernanceManager& funding, bool fWritten)
 {
-    return SerializeFileDB("coinjoin", pathCoinJoin, coinjoin);
+    {
+        LOCK(mnodeman.cs);
+        masternodes.Written(mnodeman.setCacheDirtyMasternodes, fWritten);
+        if (!fWritten) mnodeman.fCacheStateDirty = true;
+    }
+    {
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+        paymentVotes.Written(mnpayments.setCacheDirtyVotes, fWritten);
+        paymentBlocks.Written(mnpayments.setCacheDirtyBlocks, fWritten);
+    }
+    {
+        LOCK(funding.cs);
+        fundingObjects.Written(funding.setCacheDirtyObjects, fWritten);
+        if (fWritten) {
+            // only a flush spills votes, so all votes waiting to be written were in this batch
+            for (auto& objPair : funding.mapObjects) {
+                LOCK(objPair.second.cs_fobject);
+                objPair.second.fileVotes.SpillWritten();
+            }
+        } else {
+            funding.setCacheErasedVotes.insert(setErasingVotes.begin(), setErasingVotes.end());
+            funding.fCacheStateDirty = true;
+        }
+        setErasingVotes.clear();
+    }
 }
 
-bool CCoinJoinDB::Read(CAnalyzer& coinjoin)
+// The entries are read before the state, as reading the state rebuilds the indexes over them.
+
+bool CModuleCacheDB::Read(CMasternodeMan& mnodeman)
 {
-    return DeserializeFileDB(pathCoinJoin, coinjoin);
+    LOCK(mnodeman.cs);
+    if (!masternodes.Read(*this, mnodeman.mapMasternodes) || !ReadState(DB_MNMAN_STATE, mnodeman)) {
+        masternodes.Wipe(*this);
+        mnodeman.Clear();
+        return false;
+    }
+    return true;
+}
+
+bool CModuleCacheDB::Read(CMasternodePayments& mnpayments)
+{
+    LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+    if (!paymentVotes.Read(*this, mnpayments.mapMasternodePaymentVotes) ||
+        !paymentBlocks.Read(*this, mnpayments.mapMasternodeBlocks) ||
+        !ReadState(DB_MNPAYMENTS_STATE, mnpayments)) {
+        paymentVotes.Wipe(*this);
+        paymentBlocks.Wipe(*this);
+        mnpayments.Clear();
+        return false;
+    }
+    return true;
+}
+
+bool CModuleCacheDB::Read(CGovernanceManager& funding)
+{
+    LOCK(funding.cs);
+    if (!fundingObjects.Read(*this, funding.mapObjects) || !ReadState(DB_FUNDING_STATE, funding)) {
+        fundingObjects.Wipe(*this);
+        CModuleCacheMap<uint256>(DB_FUNDING_VOTE).Wipe(*this);
+        funding.Clear();
+        return false;
+    }
+    return true;
+}
+
+bool CModuleCacheDB::ReadGovernanceVote(const uint256& nHash, CGovernanceVote& vote)
+{
+    return CDBWrapper::Read(std::make_pair(DB_FUNDING_VOTE, nHash), vote);
+}
+
+bool CModuleCacheDB::Flush(CMasternodeMan& mnodeman, CMasternodePayments& mnpayments, CGovernanceManager& funding)
+{
+    LOCK(cs_flush);
+
+    int64_t nStart = GetTimeMillis();
+    CDBBatch batch(*this);
+    Write(batch, mnodeman);
+    Write(batch, mnpayments);
+    Write(batch, funding);
+
+    size_t nSize = batch.SizeEstimate();
+    bool fWritten;
+    try {
+        fWritten = WriteBatch(batch, true);
+    } catch (const dbwrapper_error& e) {
+        fWritten = error("%s: %s", __func__, e.what());
+    }
+    Written(mnodeman, mnpayments, funding, fWritten);
+    if (!fWritten) {
+        return error("%s: Failed to write to the module cache database", __func__);
+    }
+
+    LogPrint(BCLog::MNODE, "Flushed %u bytes of module cache changes  %dms\n", nSize, GetTimeMillis() - nStart);
+    return true;
 }
@@ -6,17 +6,24 @@
 #ifndef BITCOIN_CACHEDB_H
 #define BITCOIN_CACHEDB_H
 
+#include <dbwrapper.h>
 #include <fs.h>
+#include <hash.h>
+#include <primitives/transaction.h>
 #include <serialize.h>
+#include <sync.h>
+#include <uint256.h>
 
 #include <string>
 #include <map>
+#include <memory>
+#include <set>
 
 class CSubNet;
 class CAddrMan;
-class CAnalyzer;
 class CMasternodeMan;
 class CGovernanceManager;
+class CGovernanceVote;
 class CNetFulfilledRequestManager;
 class CMasternodePayments;
 
@@ -112,36 +119,33 @@ public:
 
 // Chaincoin specific cache files
 
-/** Access to the mncache database (mncache.dat) */
+/** Access to the mncache database (mncache.dat), read once to fill an empty CModuleCacheDB */
 class CMNCacheDB
 {
 private:
     fs::path pathMNCache;
 public:
     CMNCacheDB();
-    bool Write(const CMasternodeMan& mncache);
     bool Read(CMasternodeMan& mncache);
 };
 
-/** Access to the mnpayments database (mnpayments.dat) */
+/** Access to the mnpayments database (mnpayments.dat), read once to fill an empty CModuleCacheDB */
 class CMNPayDB
 {
 private:
     fs::path pathMNPay;
 public:
     CMNPayDB();
-    bool Write(const CMasternodePayments& mnpayments);
     bool Read(CMasternodePayments& mnpayments);
 };
 
-/** Access to the funding database (funding.dat) */
+/** Access to the funding database (funding.dat), read once to fill an empty CModuleCacheDB */
 class CGovDB
 {
 private:
     fs::path pathGovernance;
 public:
     CGovDB();
-    bool Write(const CGovernanceManager& funding);
     bool Read(CGovernanceManager& funding);
 };
 
@@ -156,15 +160,128 @@ public:
     bool Read(CNetFulfilledRequestManager& netfulfilled);
 };
 
-/** Access to the CoinJoin! database (coinjoin.dat) */
-class CCoinJoinDB
+/** Write the module caches to CModuleCacheDB every 5 minutes (300s) */
+static const int MODULE_CACHE_FLUSH_INTERVAL = 5 * 60;
+/** LevelDB cache size of CModuleCacheDB */
+static const size_t MODULE_CACHE_DB_CACHE_SIZE = 8 << 20;
+
+/**
+ * One map of a module in CModuleCacheDB, stored entry by entry. The module
+ * marks the keys it adds, changes or removes and a flush only writes those.
+ */
+template <typename K>
+class CModuleCacheMap
+{
+private:
+    const char chPrefix;
+    // keys in the batch being written, handed back to the module if the write fails
+    std::set<K> setWriting;
+
+public:
+    explicit CModuleCacheMap(char chPrefixIn) : chPrefix(chPrefixIn) {}
+
+    /** Add the entries in setDirty to batch, or erase them when gone from mapData, returns the number of changes */
+    template <typename V>
+    size_t Write(CDBBatch& batch, const std::map<K, V>& mapData, std::set<K>& setDirty)
+    {
+        for (const K& key : setDirty) {
+            auto it = mapData.find(key);
+            if (it != mapData.end()) {
+                batch.Write(std::make_pair(chPrefix, key), it->second);
+            } else {
+                batch.Erase(std::make_pair(chPrefix, key));
+            }
+        }
+        setWriting.insert(setDirty.begin(), setDirty.end());
+        setDirty.clear();
+        return setWriting.size();
+    }
+
+    /** Forget the keys of the last Write, or hand them back to setDirty if the batch was not written */
+    void Written(std::set<K>& setDirty, bool fWritten)
+    {
+        if (!fWritten) setDirty.insert(setWriting.begin(), setWriting.end());
+        setWriting.clear();
+    }
+
+    /** Read all entries into mapData */
+    template <typename V>
+    bool Read(CDBWrapper& db, std::map<K, V>& mapData)
+    {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        std::pair<char, K> key;
+        for (pcursor->Seek(chPrefix); pcursor->Valid(); pcursor->Next()) {
+            if (!pcursor->GetKey(key) || key.first != chPrefix) break;
+            V value;
+            if (!pcursor->GetValue(value)) {
+                return error("%s: failed to read entry with prefix %c", __func__, chPrefix);
+            }
+            mapData.emplace(key.second, std::move(value));
+        }
+        return true;
+    }
+
+    /** Erase all entries, as after a failed Read */
+    void Wipe(CDBWrapper& db)
+    {
+        CDBBatch batch(db);
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        std::pair<char, K> key;
+        for (pcursor->Seek(chPrefix); pcursor->Valid(); pcursor->Next()) {
+            if (!pcursor->GetKey(key) || key.first != chPrefix) break;
+            batch.Erase(key);
+        }
+        db.WriteBatch(batch);
+    }
+};
+
+/**
+ * Access to the module cache database (modulecache/), which keeps the masternode
+ * list, payment votes and funding objects. The large maps are
+ * stored entry by entry and the rest of each module as a single state record.
+ * The modules track which entries and whether their state changed, so flushing
+ * on an interval only serializes and writes what changed since the last flush.
+ */
+class CModuleCacheDB : public CDBWrapper
 {
 private:
-    fs::path pathCoinJoin;
+    // guards the keys being written, flushes come from the scheduler and from shutdown
+    CCriticalSection cs_flush;
+
+    // Each module only touches its own members, so different modules can be read in parallel
+    CModuleCacheMap<COutPoint> masternodes;
+    CModuleCacheMap<uint256> paymentVotes;
+    CModuleCacheMap<int> paymentBlocks;
+    CModuleCacheMap<uint256> fundingObjects;
+    // spilled funding votes being erased by the batch being written
+    std::set<uint256> setErasingVotes;
+
+    template <typename Data>
+    void WriteState(CDBBatch& batch, char chKey, const Data& data);
+    template <typename Data>
+    bool ReadState(char chKey, Data& data);
+
+    void Write(CDBBatch& batch, CMasternodeMan& mnodeman);
+    void Write(CDBBatch& batch, CMasternodePayments& mnpayments);
+    void Write(CDBBatch& batch, CGovernanceManager& funding);
+    void Written(CMasternodeMan& mnodeman, CMasternodePayments& mnpayments, CGovernanceManager& funding, bool fWritten);
+
 public:
-    CCoinJoinDB();
-    bool Write(const CAnalyzer& coinjoin);
-    bool Read(CAnalyzer& coinjoin);
+    explicit CModuleCacheDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Read a module, different modules may be read in parallel but not while flushing */
+    bool Read(CMasternodeMan& mnodeman);
+    bool Read(CMasternodePayments& mnpayments);
+    bool Read(CGovernanceManager& funding);
+
+    /** Read a funding vote spilled from memory, they are written and erased along with their objects */
+    bool ReadGovernanceVote(const uint256& nHash, CGovernanceVote& vote);
+
+    /** Write the changes of all modules in one batch */
+    bool Flush(CMasternodeMan& mnodeman, CMasternodePayments& mnpayments, CGovernanceManager& funding);
 };
 
+/// The global module cache database. May be null.
+extern std::unique_ptr<CModuleCacheDB> g_modulecachedb;
+
 #endif // BITCOIN_CACHEDB_H
@@ -5,10 +5,31 @@
 
 #include <crypto/cubehash512.h>
 
+#include <crypto/common.h>
+
+#include <assert.h>
 #include <stddef.h>
 #include <string.h>
 #include <limits.h>
 
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+#if defined(__SSE2__)
+namespace cubehash512_sse2
+{
+void Transform_4way(unsigned char* out, const unsigned char* in, const sph_u32* iv);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace cubehash512_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in, const sph_u32* iv);
+}
+#endif
+
 static const sph_u32 IV512[] = {
     SPH_C32(0x2AEA2A61), SPH_C32(0x50F494D4), SPH_C32(0x2D538B8B),
     SPH_C32(0x4167D83E), SPH_C32(0x3FEE2313), SPH_C32(0xC701CF8C),
@@ -345,6 +366,37 @@ void inline Initialize(cubehash_context *sc, const sph_u32 *iv)
     sc->ptr = 0;
 }
 
+typedef void (*TransformMultiType)(unsigned char*, const unsigned char*, const sph_u32*);
+
+TransformMultiType Transform64_4way = nullptr;
+TransformMultiType Transform64_8way = nullptr;
+
+bool SelfTest()
+{
+    // Hash eight distinct messages one lane set at a time and compare
+    // against the portable code
+    unsigned char in[8 * 64];
+    unsigned char out[8 * 64];
+    unsigned char expected[8 * 64];
+    for (size_t i = 0; i < sizeof(in); i++) {
+        in[i] = (unsigned char)(i * 7 + 3);
+    }
+    for (int i = 0; i < 8; i++) {
+        CCUBEHASH512().Write(in + 64 * i, 64).Finalize(expected + 64 * i);
+    }
+
+    if (Transform64_4way) {
+        Transform64_4way(out, in, IV512);
+        Transform64_4way(out + 256, in + 256, IV512);
+        if (memcmp(out, expected, sizeof(out)) != 0) return false;
+    }
+    if (Transform64_8way) {
+        Transform64_8way(out, in, IV512);
+        if (memcmp(out, expected, sizeof(out)) != 0) return false;
+    }
+    return true;
+}
+
 } // namespace cubehash512
 
 } // namespace
@@ -422,3 +474,59 @@ CCUBEHASH512& CCUBEHASH512::Reset()
     cubehash512::Initialize(&s, IV512);
     return *this;
 }
+
+std::string CUBEHASH512AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(__SSE2__)
+    cubehash512::Transform64_4way = cubehash512_sse2::Transform_4way;
+    ret = "sse2(4way)";
+#endif
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    unsigned int eax, ebx, ecx, edx;
+    bool have_avx = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 27) & 1) && ((ecx >> 28) & 1);
+    if (have_avx) {
+        // Check that the OS saves the AVX registers
+        uint32_t a, d;
+        __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        have_avx = (a & 6) == 6;
+    }
+    if (have_avx && __get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx >> 5) & 1) {
+            cubehash512::Transform64_8way = cubehash512_avx2::Transform_8way;
+            ret += ",avx2(8way)";
+        }
+    }
+#endif
+
+    assert(cubehash512::SelfTest());
+    return ret;
+}
+
+void CubeHash512_64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (cubehash512::Transform64_8way) {
+        while (blocks >= 8) {
+            cubehash512::Transform64_8way(out, in, IV512);
+            out += 512;
+            in += 512;
+            blocks -= 8;
+        }
+    }
+    if (cubehash512::Transform64_4way) {
+        while (blocks >= 4) {
+            cubehash512::Transform64_4way(out, in, IV512);
+            out += 256;
+            in += 256;
+            blocks -= 4;
+        }
+    }
+    CCUBEHASH512 hasher;
+    while (blocks) {
+        hasher.Write(in, 64).Finalize(out);
+        out += 64;
+        in += 64;
+        blocks -= 1;
+    }
+}
@@ -8,6 +8,7 @@
 
 
 #include <stddef.h>
+#include <string>
 #include <crypto/c11_types.h>
 
 /**
@@ -41,4 +42,16 @@ public:
     CCUBEHASH512& Reset();
 };
 
+/** Autodetect the best available multi-lane CUBEHASH512 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string CUBEHASH512AutoDetect();
+
+/** Compute multiple CUBEHASH512's of 64-byte blobs, as hashed by the C11 chain.
+ *  output:  pointer to a blocks*64 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void CubeHash512_64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // CUBEHASH512_H
@@ -0,0 +1,51 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// 8-way CubeHash-512 of 64-byte messages using AVX2.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+#include <crypto/cubehash512_multiway.h>
+
+namespace cubehash512_avx2 {
+namespace {
+
+struct Ops
+{
+    typedef __m256i V;
+    static const int LANES = 8;
+
+    static V inline Set1(uint32_t x) { return _mm256_set1_epi32(x); }
+    static V inline Add(V x, V y) { return _mm256_add_epi32(x, y); }
+    static V inline Xor(V x, V y) { return _mm256_xor_si256(x, y); }
+    static V inline Rotl(V x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+    static V inline Load(const unsigned char* in, int w)
+    {
+        return _mm256_set_epi32(ReadLE32(in + 448 + 4 * w), ReadLE32(in + 384 + 4 * w), ReadLE32(in + 320 + 4 * w), ReadLE32(in + 256 + 4 * w),
+                                ReadLE32(in + 192 + 4 * w), ReadLE32(in + 128 + 4 * w), ReadLE32(in + 64 + 4 * w), ReadLE32(in + 4 * w));
+    }
+    static void inline Store(unsigned char* out, int w, V x)
+    {
+        alignas(32) uint32_t v[8];
+        _mm256_store_si256((__m256i*)v, x);
+        for (int i = 0; i < 8; i++) {
+            WriteLE32(out + 64 * i + 4 * w, v[i]);
+        }
+    }
+};
+
+} // namespace
+
+void Transform_8way(unsigned char* out, const unsigned char* in, const sph_u32* iv)
+{
+    cubehash512_multiway::Transform64<Ops>(out, in, iv);
+}
+
+} // namespace cubehash512_avx2
+
+#endif
@@ -0,0 +1,266 @@
+// Copyright (c) 2007-2010  Projet RNRT SAPHIR
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// Multi-lane CubeHash-512 over 64-byte messages, shared by the SSE2 and AVX2
+// implementations. Every state word holds the same word of several
+// independent messages, one per vector lane, so the rounds below are the
+// ROUND_EVEN/ROUND_ODD macros of cubehash512.cpp applied to whole vectors.
+//
+// O must provide a vector type V with LANES 32-bit lanes and the static
+// members Set1, Add, Xor, Rotl, Load (word w of every lane's input) and
+// Store (word w into every lane's output).
+
+#ifndef CUBEHASH512_MULTIWAY_H
+#define CUBEHASH512_MULTIWAY_H
+
+#include <crypto/c11_types.h>
+
+namespace cubehash512_multiway {
+
+template<typename O>
+void inline RoundEven(typename O::V* x)
+{
+    x[16] = O::Add(x[0], x[16]);
+    x[0] = O::Rotl(x[0], 7);
+    x[17] = O::Add(x[1], x[17]);
+    x[1] = O::Rotl(x[1], 7);
+    x[18] = O::Add(x[2], x[18]);
+    x[2] = O::Rotl(x[2], 7);
+    x[19] = O::Add(x[3], x[19]);
+    x[3] = O::Rotl(x[3], 7);
+    x[20] = O::Add(x[4], x[20]);
+    x[4] = O::Rotl(x[4], 7);
+    x[21] = O::Add(x[5], x[21]);
+    x[5] = O::Rotl(x[5], 7);
+    x[22] = O::Add(x[6], x[22]);
+    x[6] = O::Rotl(x[6], 7);
+    x[23] = O::Add(x[7], x[23]);
+    x[7] = O::Rotl(x[7], 7);
+    x[24] = O::Add(x[8], x[24]);
+    x[8] = O::Rotl(x[8], 7);
+    x[25] = O::Add(x[9], x[25]);
+    x[9] = O::Rotl(x[9], 7);
+    x[26] = O::Add(x[10], x[26]);
+    x[10] = O::Rotl(x[10], 7);
+    x[27] = O::Add(x[11], x[27]);
+    x[11] = O::Rotl(x[11], 7);
+    x[28] = O::Add(x[12], x[28]);
+    x[12] = O::Rotl(x[12], 7);
+    x[29] = O::Add(x[13], x[29]);
+    x[13] = O::Rotl(x[13], 7);
+    x[30] = O::Add(x[14], x[30]);
+    x[14] = O::Rotl(x[14], 7);
+    x[31] = O::Add(x[15], x[31]);
+    x[15] = O::Rotl(x[15], 7);
+    x[8] = O::Xor(x[8], x[16]);
+    x[9] = O::Xor(x[9], x[17]);
+    x[10] = O::Xor(x[10], x[18]);
+    x[11] = O::Xor(x[11], x[19]);
+    x[12] = O::Xor(x[12], x[20]);
+    x[13] = O::Xor(x[13], x[21]);
+    x[14] = O::Xor(x[14], x[22]);
+    x[15] = O::Xor(x[15], x[23]);
+    x[0] = O::Xor(x[0], x[24]);
+    x[1] = O::Xor(x[1], x[25]);
+    x[2] = O::Xor(x[2], x[26]);
+    x[3] = O::Xor(x[3], x[27]);
+    x[4] = O::Xor(x[4], x[28]);
+    x[5] = O::Xor(x[5], x[29]);
+    x[6] = O::Xor(x[6], x[30]);
+    x[7] = O::Xor(x[7], x[31]);
+    x[18] = O::Add(x[8], x[18]);
+    x[8] = O::Rotl(x[8], 11);
+    x[19] = O::Add(x[9], x[19]);
+    x[9] = O::Rotl(x[9], 11);
+    x[16] = O::Add(x[10], x[16]);
+    x[10] = O::Rotl(x[10], 11);
+    x[17] = O::Add(x[11], x[17]);
+    x[11] = O::Rotl(x[11], 11);
+    x[22] = O::Add(x[12], x[22]);
+    x[12] = O::Rotl(x[12], 11);
+    x[23] = O::Add(x[13], x[23]);
+    x[13] = O::Rotl(x[13], 11);
+    x[20] = O::Add(x[14], x[20]);
+    x[14] = O::Rotl(x[14], 11);
+    x[21] = O::Add(x[15], x[21]);
+    x[15] = O::Rotl(x[15], 11);
+    x[26] = O::Add(x[0], x[26]);
+    x[0] = O::Rotl(x[0], 11);
+    x[27] = O::Add(x[1], x[27]);
+    x[1] = O::Rotl(x[1], 11);
+    x[24] = O::Add(x[2], x[24]);
+    x[2] = O::Rotl(x[2], 11);
+    x[25] = O::Add(x[3], x[25]);
+    x[3] = O::Rotl(x[3], 11);
+    x[30] = O::Add(x[4], x[30]);
+    x[4] = O::Rotl(x[4], 11);
+    x[31] = O::Add(x[5], x[31]);
+    x[5] = O::Rotl(x[5], 11);
+    x[28] = O::Add(x[6], x[28]);
+    x[6] = O::Rotl(x[6], 11);
+    x[29] = O::Add(x[7], x[29]);
+    x[7] = O::Rotl(x[7], 11);
+    x[12] = O::Xor(x[12], x[18]);
+    x[13] = O::Xor(x[13], x[19]);
+    x[14] = O::Xor(x[14], x[16]);
+    x[15] = O::Xor(x[15], x[17]);
+    x[8] = O::Xor(x[8], x[22]);
+    x[9] = O::Xor(x[9], x[23]);
+    x[10] = O::Xor(x[10], x[20]);
+    x[11] = O::Xor(x[11], x[21]);
+    x[4] = O::Xor(x[4], x[26]);
+    x[5] = O::Xor(x[5], x[27]);
+    x[6] = O::Xor(x[6], x[24]);
+    x[7] = O::Xor(x[7], x[25]);
+    x[0] = O::Xor(x[0], x[30]);
+    x[1] = O::Xor(x[1], x[31]);
+    x[2] = O::Xor(x[2], x[28]);
+    x[3] = O::Xor(x[3], x[29]);
+}
+
+template<typename O>
+void inline RoundOdd(typename O::V* x)
+{
+    x[19] = O::Add(x[12], x[19]);
+    x[12] = O::Rotl(x[12], 7);
+    x[18] = O::Add(x[13], x[18]);
+    x[13] = O::Rotl(x[13], 7);
+    x[17] = O::Add(x[14], x[17]);
+    x[14] = O::Rotl(x[14], 7);
+    x[16] = O::Add(x[15], x[16]);
+    x[15] = O::Rotl(x[15], 7);
+    x[23] = O::Add(x[8], x[23]);
+    x[8] = O::Rotl(x[8], 7);
+    x[22] = O::Add(x[9], x[22]);
+    x[9] = O::Rotl(x[9], 7);
+    x[21] = O::Add(x[10], x[21]);
+    x[10] = O::Rotl(x[10], 7);
+    x[20] = O::Add(x[11], x[20]);
+    x[11] = O::Rotl(x[11], 7);
+    x[27] = O::Add(x[4], x[27]);
+    x[4] = O::Rotl(x[4], 7);
+    x[26] = O::Add(x[5], x[26]);
+    x[5] = O::Rotl(x[5], 7);
+    x[25] = O::Add(x[6], x[25]);
+    x[6] = O::Rotl(x[6], 7);
+    x[24] = O::Add(x[7], x[24]);
+    x[7] = O::Rotl(x[7], 7);
+    x[31] = O::Add(x[0], x[31]);
+    x[0] = O::Rotl(x[0], 7);
+    x[30] = O::Add(x[1], x[30]);
+    x[1] = O::Rotl(x[1], 7);
+    x[29] = O::Add(x[2], x[29]);
+    x[2] = O::Rotl(x[2], 7);
+    x[28] = O::Add(x[3], x[28]);
+    x[3] = O::Rotl(x[3], 7);
+    x[4] = O::Xor(x[4], x[19]);
+    x[5] = O::Xor(x[5], x[18]);
+    x[6] = O::Xor(x[6], x[17]);
+    x[7] = O::Xor(x[7], x[16]);
+    x[0] = O::Xor(x[0], x[23]);
+    x[1] = O::Xor(x[1], x[22]);
+    x[2] = O::Xor(x[2], x[21]);
+    x[3] = O::Xor(x[3], x[20]);
+    x[12] = O::Xor(x[12], x[27]);
+    x[13] = O::Xor(x[13], x[26]);
+    x[14] = O::Xor(x[14], x[25]);
+    x[15] = O::Xor(x[15], x[24]);
+    x[8] = O::Xor(x[8], x[31]);
+    x[9] = O::Xor(x[9], x[30]);
+    x[10] = O::Xor(x[10], x[29]);
+    x[11] = O::Xor(x[11], x[28]);
+    x[17] = O::Add(x[4], x[17]);
+    x[4] = O::Rotl(x[4], 11);
+    x[16] = O::Add(x[5], x[16]);
+    x[5] = O::Rotl(x[5], 11);
+    x[19] = O::Add(x[6], x[19]);
+    x[6] = O::Rotl(x[6], 11);
+    x[18] = O::Add(x[7], x[18]);
+    x[7] = O::Rotl(x[7], 11);
+    x[21] = O::Add(x[0], x[21]);
+    x[0] = O::Rotl(x[0], 11);
+    x[20] = O::Add(x[1], x[20]);
+    x[1] = O::Rotl(x[1], 11);
+    x[23] = O::Add(x[2], x[23]);
+    x[2] = O::Rotl(x[2], 11);
+    x[22] = O::Add(x[3], x[22]);
+    x[3] = O::Rotl(x[3], 11);
+    x[25] = O::Add(x[12], x[25]);
+    x[12] = O::Rotl(x[12], 11);
+    x[24] = O::Add(x[13], x[24]);
+    x[13] = O::Rotl(x[13], 11);
+    x[27] = O::Add(x[14], x[27]);
+    x[14] = O::Rotl(x[14], 11);
+    x[26] = O::Add(x[15], x[26]);
+    x[15] = O::Rotl(x[15], 11);
+    x[29] = O::Add(x[8], x[29]);
+    x[8] = O::Rotl(x[8], 11);
+    x[28] = O::Add(x[9], x[28]);
+    x[9] = O::Rotl(x[9], 11);
+    x[31] = O::Add(x[10], x[31]);
+    x[10] = O::Rotl(x[10], 11);
+    x[30] = O::Add(x[11], x[30]);
+    x[11] = O::Rotl(x[11], 11);
+    x[0] = O::Xor(x[0], x[17]);
+    x[1] = O::Xor(x[1], x[16]);
+    x[2] = O::Xor(x[2], x[19]);
+    x[3] = O::Xor(x[3], x[18]);
+    x[4] = O::Xor(x[4], x[21]);
+    x[5] = O::Xor(x[5], x[20]);
+    x[6] = O::Xor(x[6], x[23]);
+    x[7] = O::Xor(x[7], x[22]);
+    x[8] = O::Xor(x[8], x[25]);
+    x[9] = O::Xor(x[9], x[24]);
+    x[10] = O::Xor(x[10], x[27]);
+    x[11] = O::Xor(x[11], x[26]);
+    x[12] = O::Xor(x[12], x[29]);
+    x[13] = O::Xor(x[13], x[28]);
+    x[14] = O::Xor(x[14], x[31]);
+    x[15] = O::Xor(x[15], x[30]);
+}
+
+template<typename O>
+void inline SixteenRounds(typename O::V* x)
+{
+    for (int r = 0; r < 8; r++) {
+        RoundEven<O>(x);
+        RoundOdd<O>(x);
+    }
+}
+
+/** Hash O::LANES 64-byte messages, input and output are O::LANES * 64 bytes. */
+template<typename O>
+void Transform64(unsigned char* out, const unsigned char* in, const sph_u32* iv)
+{
+    typename O::V x[32];
+    for (int i = 0; i < 32; i++) {
+        x[i] = O::Set1(iv[i]);
+    }
+
+    // Two 32-byte message blocks
+    for (int b = 0; b < 2; b++) {
+        for (int i = 0; i < 8; i++) {
+            x[i] = O::Xor(x[i], O::Load(in, b * 8 + i));
+        }
+        SixteenRounds<O>(x);
+    }
+
+    // Padding block: a single 0x80 byte followed by zeros
+    x[0] = O::Xor(x[0], O::Set1(0x80));
+    for (int i = 0; i < 11; i++) {
+        SixteenRounds<O>(x);
+        if (i == 0) {
+            x[31] = O::Xor(x[31], O::Set1(1));
+        }
+    }
+
+    for (int i = 0; i < 16; i++) {
+        O::Store(out, i, x[i]);
+    }
+}
+
+} // namespace cubehash512_multiway
+
+#endif // CUBEHASH512_MULTIWAY_H
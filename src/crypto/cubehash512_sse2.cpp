@@ -0,0 +1,51 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// 4-way CubeHash-512 of 64-byte messages using SSE2, which every x86-64 CPU
+// supports, so this needs neither special compiler flags nor runtime detection.
+
+#if defined(__SSE2__)
+
+#include <stdint.h>
+#include <emmintrin.h>
+
+#include <crypto/common.h>
+#include <crypto/cubehash512_multiway.h>
+
+namespace cubehash512_sse2 {
+namespace {
+
+struct Ops
+{
+    typedef __m128i V;
+    static const int LANES = 4;
+
+    static V inline Set1(uint32_t x) { return _mm_set1_epi32(x); }
+    static V inline Add(V x, V y) { return _mm_add_epi32(x, y); }
+    static V inline Xor(V x, V y) { return _mm_xor_si128(x, y); }
+    static V inline Rotl(V x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+    static V inline Load(const unsigned char* in, int w)
+    {
+        return _mm_set_epi32(ReadLE32(in + 192 + 4 * w), ReadLE32(in + 128 + 4 * w), ReadLE32(in + 64 + 4 * w), ReadLE32(in + 4 * w));
+    }
+    static void inline Store(unsigned char* out, int w, V x)
+    {
+        alignas(16) uint32_t v[4];
+        _mm_store_si128((__m128i*)v, x);
+        for (int i = 0; i < 4; i++) {
+            WriteLE32(out + 64 * i + 4 * w, v[i]);
+        }
+    }
+};
+
+} // namespace
+
+void Transform_4way(unsigned char* out, const unsigned char* in, const sph_u32* iv)
+{
+    cubehash512_multiway::Transform64<Ops>(out, in, iv);
+}
+
+} // namespace cubehash512_sse2
+
+#endif
@@ -4,11 +4,22 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/echo512.h>
+#include <crypto/common.h>
 
+#include <assert.h>
 #include <stddef.h>
 #include <string.h>
 #include <limits.h>
 
+#if defined(ENABLE_AESNI) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace echo512_aesni
+{
+void Compress(echo_context *sc);
+}
+
 #define T32   SPH_T32
 #define C32   SPH_C32
 #define C64   SPH_C64
@@ -198,10 +209,44 @@ void inline echo_compress(echo_context *sc)
         COMPRESS_BIG(sc);
 }
 
+typedef void (*CompressType)(echo_context *sc);
+
+CompressType Compress = echo_compress;
+
+/** Check the selected compression function against the portable one. */
+bool SelfTest()
+{
+    echo_context ref, ctx;
+    Initialize(&ref);
+    for (unsigned i = 0; i < sizeof ref.buf; i++) {
+        ref.buf[i] = (unsigned char)(i * 7 + 1);
+    }
+    ref.C0 = 0xFFFFFF80; // exercise the carry into C1 inside the rounds
+    ref.C1 = 1;
+    memcpy(&ctx, &ref, sizeof ctx);
+    echo_compress(&ref);
+    Compress(&ctx);
+    return memcmp(ref.state, ctx.state, sizeof ref.state) == 0;
+}
+
 } // namespace echo512
 
 } // namespace
 
+std::string ECHO512AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 25) & 1) && ((ecx >> 19) & 1)) {
+        echo512::Compress = echo512_aesni::Compress;
+        ret = "aesni";
+    }
+#endif
+
+    assert(echo512::SelfTest());
+    return ret;
+}
 
 CECHO512::CECHO512()
 {
@@ -235,7 +280,7 @@ CECHO512& CECHO512::Write(const unsigned char* data, size_t len)
                 len -= clen;
                 if (ptr == sizeof s.buf) {
                         INCR_COUNTER(&s, 1024);
-                        echo512::echo_compress(&s);
+                        echo512::Compress(&s);
                         ptr = 0;
                 }
         }
@@ -276,13 +321,13 @@ void CECHO512::Finalize(unsigned char hash[OUTPUT_SIZE])
         buf[ptr ++] = ((0 & -z) | z) & 0xFF;
         memset(buf + ptr, 0, (sizeof s.buf) - ptr);
         if (ptr > ((sizeof s.buf) - 18)) {
-            echo512::echo_compress(&s);
+            echo512::Compress(&s);
             s.C0 = s.C1 = s.C2 = s.C3 = 0;
             memset(buf, 0, sizeof s.buf);
         }
         sph_enc16le(buf + (sizeof s.buf) - 18, 16 << 5);
         memcpy(buf + (sizeof s.buf) - 16, u.tmp, 16);
-        echo512::echo_compress(&s);
+        echo512::Compress(&s);
         for (VV = &s.state[0][0], k = 0; k < ((16 + 1) >> 1); k ++)
             sph_enc64le_aligned(u.tmp + (k << 3), VV[k]);
         memcpy(hash, u.tmp, 16 << 2);
@@ -7,6 +7,7 @@
 #define ECHO512_H
 
 #include <stddef.h>
+#include <string>
 #include <crypto/c11_types.h>
 
 /**
@@ -41,4 +42,9 @@ public:
     CECHO512& Reset();
 };
 
+/** Autodetect the best available ECHO512 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string ECHO512AutoDetect();
+
 #endif // ECHO512_H
@@ -0,0 +1,100 @@
+// Copyright (c) 2007-2010  Projet RNRT SAPHIR
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// This is a translation of the portable ECHO-512 compression function in
+// echo512.cpp to AES-NI. Each 128-bit state word is a native AES state, so
+// AES_2ROUNDS becomes two AESENC instructions and the big MixColumns step
+// works on all sixteen bytes of a word at once.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/echo512.h>
+
+namespace echo512_aesni {
+namespace {
+
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+
+/** Multiply every byte by x in GF(2^8), as the 64-bit abx/bcx/cdx terms do. */
+__m128i inline XTime(__m128i x)
+{
+    __m128i hi = _mm_cmplt_epi8(x, _mm_setzero_si128());
+    return Xor(_mm_add_epi8(x, x), _mm_and_si128(hi, _mm_set1_epi8(0x1B)));
+}
+
+void inline MixColumn(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    __m128i ab = Xor(a, b);
+    __m128i bc = Xor(b, c);
+    __m128i cd = Xor(c, d);
+    __m128i abx = XTime(ab);
+    __m128i bcx = XTime(bc);
+    __m128i cdx = XTime(cd);
+    __m128i na = Xor(Xor(abx, bc), d);
+    __m128i nb = Xor(Xor(bcx, a), cd);
+    __m128i nc = Xor(Xor(cdx, ab), d);
+    __m128i nd = Xor(Xor(Xor(abx, bcx), Xor(cdx, ab)), c);
+    a = na;
+    b = nb;
+    c = nc;
+    d = nd;
+}
+
+} // namespace
+
+void Compress(echo_context* sc)
+{
+    const __m128i zero = _mm_setzero_si128();
+    sph_u32 K0 = sc->C0;
+    sph_u32 K1 = sc->C1;
+    sph_u32 K2 = sc->C2;
+    sph_u32 K3 = sc->C3;
+    __m128i W[16];
+    __m128i tmp;
+
+    for (int u = 0; u < 8; u++) {
+        W[u] = _mm_loadu_si128((const __m128i*)sc->state[u]);
+        W[u + 8] = _mm_loadu_si128((const __m128i*)(sc->buf + 16 * u));
+    }
+
+    for (int r = 0; r < 10; r++) {
+        /* BIG_SUB_WORDS */
+        for (int u = 0; u < 16; u++) {
+            __m128i k = _mm_set_epi32(K3, K2, K1, K0);
+            W[u] = _mm_aesenc_si128(_mm_aesenc_si128(W[u], k), zero);
+            if ((K0 = SPH_T32(K0 + 1)) == 0) {
+                if ((K1 = SPH_T32(K1 + 1)) == 0)
+                    if ((K2 = SPH_T32(K2 + 1)) == 0)
+                        K3 = SPH_T32(K3 + 1);
+            }
+        }
+
+        /* BIG_SHIFT_ROWS */
+        tmp = W[1]; W[1] = W[5]; W[5] = W[9]; W[9] = W[13]; W[13] = tmp;
+        tmp = W[2]; W[2] = W[10]; W[10] = tmp;
+        tmp = W[6]; W[6] = W[14]; W[14] = tmp;
+        tmp = W[15]; W[15] = W[11]; W[11] = W[7]; W[7] = W[3]; W[3] = tmp;
+
+        /* BIG_MIX_COLUMNS */
+        MixColumn(W[0], W[1], W[2], W[3]);
+        MixColumn(W[4], W[5], W[6], W[7]);
+        MixColumn(W[8], W[9], W[10], W[11]);
+        MixColumn(W[12], W[13], W[14], W[15]);
+    }
+
+    /* FINAL_BIG */
+    for (int u = 0; u < 8; u++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)sc->state[u]);
+        __m128i m = _mm_loadu_si128((const __m128i*)(sc->buf + 16 * u));
+        _mm_storeu_si128((__m128i*)sc->state[u], Xor(Xor(v, m), Xor(W[u], W[u + 8])));
+    }
+}
+
+} // namespace echo512_aesni
+
+#endif
@@ -4,10 +4,21 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/shavite512.h>
+#include <crypto/common.h>
 
+#include <assert.h>
 #include <stddef.h>
 #include <string.h>
 
+#if defined(ENABLE_AESNI) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace shavite512_aesni
+{
+void Compress(shavite_context *sc, const void *msg);
+}
+
 #define C32   SPH_C32
 
 static const sph_u32 IV512[] = {
@@ -634,10 +645,48 @@ void inline Initialize(shavite_context *sc, const sph_u32 *iv)
     sc->count3 = 0;
 }
 
+typedef void (*CompressType)(shavite_context *sc, const void *msg);
+
+CompressType Compress = c512;
+
+/** Check the selected compression function against the portable one. */
+bool SelfTest()
+{
+    shavite_context ref, ctx;
+    unsigned char msg[128];
+    Initialize(&ref, IV512);
+    for (unsigned i = 0; i < sizeof msg; i++) {
+        msg[i] = (unsigned char)(i * 7 + 1);
+    }
+    ref.count0 = 0x12345678;
+    ref.count1 = 0x9ABCDEF0;
+    ref.count2 = 0x0F1E2D3C;
+    ref.count3 = 0x4B5A6978;
+    memcpy(&ctx, &ref, sizeof ctx);
+    c512(&ref, msg);
+    Compress(&ctx, msg);
+    return memcmp(ref.h, ctx.h, sizeof ref.h) == 0;
+}
+
 } // namespace shavite512
 
 } // namespace
 
+std::string SHAVITE512AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 25) & 1) && ((ecx >> 19) & 1)) {
+        shavite512::Compress = shavite512_aesni::Compress;
+        ret = "aesni";
+    }
+#endif
+
+    assert(shavite512::SelfTest());
+    return ret;
+}
+
 CSHAVITE512::CSHAVITE512()
 {
     shavite512::Initialize(&s, IV512);
@@ -671,7 +720,7 @@ CSHAVITE512& CSHAVITE512::Write(const unsigned char* data, size_t len)
                     }
                 }
             }
-            c512(&s, buf);
+            shavite512::Compress(&s, buf);
             ptr = 0;
         }
     }
@@ -704,7 +753,7 @@ void CSHAVITE512::Finalize(unsigned char hash[OUTPUT_SIZE])
     } else {
         buf[ptr ++] = z;
         memset(buf + ptr, 0, 128 - ptr);
-        c512(&s, buf);
+        shavite512::Compress(&s, buf);
         memset(buf, 0, 110);
         s.count0 = s.count1 = s.count2 = s.count3 = 0;
     }
@@ -714,7 +763,7 @@ void CSHAVITE512::Finalize(unsigned char hash[OUTPUT_SIZE])
     sph_enc32le(buf + 122, count3);
     buf[126] = 0;
     buf[127] = 16 >> 3;
-    c512(&s, buf);
+    shavite512::Compress(&s, buf);
     for (u = 0; u < 16; u ++)
         sph_enc32le(hash + (u << 2), s.h[u]);
     Reset();
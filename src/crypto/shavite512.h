@@ -8,6 +8,7 @@
 
 
 #include <stddef.h>
+#include <string>
 #include <crypto/c11_types.h>
 
 /**
@@ -42,4 +43,9 @@ public:
     CSHAVITE512& Reset();
 };
 
+/** Autodetect the best available SHAVITE512 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string SHAVITE512AutoDetect();
+
 #endif // SHAVITE512_H
@@ -0,0 +1,181 @@
+// Copyright (c) 2007-2010  Projet RNRT SAPHIR
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// This is a translation of the portable SHAvite-3-512 compression function in
+// shavite512.cpp to AES-NI, where every AES_ROUND_NOKEY maps to one AESENC
+// with an all-zero round key.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/shavite512.h>
+
+namespace shavite512_aesni {
+namespace {
+
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Load(const unsigned char* p) { return _mm_loadu_si128((const __m128i*)p); }
+
+/** One keyless AES round, as AES_ROUND_NOKEY_LE does with table lookups. */
+__m128i inline Round(__m128i x) { return _mm_aesenc_si128(x, _mm_setzero_si128()); }
+
+/** KEY_EXPAND_ELT: AES round over the key words rotated down by one. */
+__m128i inline Expand(__m128i k) { return Round(_mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 2, 1))); }
+
+/** The four words starting at the second word of lo and ending at the first word of hi. */
+__m128i inline Shift(__m128i hi, __m128i lo) { return _mm_alignr_epi8(hi, lo, 4); }
+
+} // namespace
+
+void Compress(shavite_context* sc, const void* msg)
+{
+    const unsigned char* m = (const unsigned char*)msg;
+    const __m128i cnt1 = _mm_set_epi32(~sc->count3, sc->count2, sc->count1, sc->count0);
+    const __m128i cnt2 = _mm_set_epi32(~sc->count0, sc->count1, sc->count2, sc->count3);
+    const __m128i cnt3 = _mm_set_epi32(~sc->count1, sc->count0, sc->count3, sc->count2);
+    const __m128i cnt13 = _mm_set_epi32(~sc->count2, sc->count3, sc->count0, sc->count1);
+
+    __m128i p0 = _mm_loadu_si128((const __m128i*)&sc->h[0x0]);
+    __m128i p1 = _mm_loadu_si128((const __m128i*)&sc->h[0x4]);
+    __m128i p2 = _mm_loadu_si128((const __m128i*)&sc->h[0x8]);
+    __m128i p3 = _mm_loadu_si128((const __m128i*)&sc->h[0xC]);
+    __m128i x;
+
+    /* round 0 */
+    __m128i k0 = Load(m +   0);
+    __m128i k1 = Load(m +  16);
+    __m128i k2 = Load(m +  32);
+    __m128i k3 = Load(m +  48);
+    __m128i k4 = Load(m +  64);
+    __m128i k5 = Load(m +  80);
+    __m128i k6 = Load(m +  96);
+    __m128i k7 = Load(m + 112);
+    x = Round(Xor(p1, k0));
+    x = Round(Xor(x, k1));
+    x = Round(Xor(x, k2));
+    x = Round(Xor(x, k3));
+    p0 = Xor(p0, x);
+    x = Round(Xor(p3, k4));
+    x = Round(Xor(x, k5));
+    x = Round(Xor(x, k6));
+    x = Round(Xor(x, k7));
+    p2 = Xor(p2, x);
+
+    for (int r = 0; r < 3; r++) {
+        /* round 1, 5, 9 */
+        k0 = Xor(Expand(k0), k7);
+        if (r == 0) k0 = Xor(k0, cnt1);
+        x = Round(Xor(p0, k0));
+        k1 = Xor(Expand(k1), k0);
+        if (r == 1) k1 = Xor(k1, cnt2);
+        x = Round(Xor(x, k1));
+        k2 = Xor(Expand(k2), k1);
+        x = Round(Xor(x, k2));
+        k3 = Xor(Expand(k3), k2);
+        x = Round(Xor(x, k3));
+        p3 = Xor(p3, x);
+        k4 = Xor(Expand(k4), k3);
+        x = Round(Xor(p2, k4));
+        k5 = Xor(Expand(k5), k4);
+        x = Round(Xor(x, k5));
+        k6 = Xor(Expand(k6), k5);
+        x = Round(Xor(x, k6));
+        k7 = Xor(Expand(k7), k6);
+        if (r == 2) k7 = Xor(k7, cnt3);
+        x = Round(Xor(x, k7));
+        p1 = Xor(p1, x);
+
+        /* round 2, 6, 10 */
+        k0 = Xor(k0, Shift(k7, k6));
+        x = Round(Xor(p3, k0));
+        k1 = Xor(k1, Shift(k0, k7));
+        x = Round(Xor(x, k1));
+        k2 = Xor(k2, Shift(k1, k0));
+        x = Round(Xor(x, k2));
+        k3 = Xor(k3, Shift(k2, k1));
+        x = Round(Xor(x, k3));
+        p2 = Xor(p2, x);
+        k4 = Xor(k4, Shift(k3, k2));
+        x = Round(Xor(p1, k4));
+        k5 = Xor(k5, Shift(k4, k3));
+        x = Round(Xor(x, k5));
+        k6 = Xor(k6, Shift(k5, k4));
+        x = Round(Xor(x, k6));
+        k7 = Xor(k7, Shift(k6, k5));
+        x = Round(Xor(x, k7));
+        p0 = Xor(p0, x);
+
+        /* round 3, 7, 11 */
+        k0 = Xor(Expand(k0), k7);
+        x = Round(Xor(p2, k0));
+        k1 = Xor(Expand(k1), k0);
+        x = Round(Xor(x, k1));
+        k2 = Xor(Expand(k2), k1);
+        x = Round(Xor(x, k2));
+        k3 = Xor(Expand(k3), k2);
+        x = Round(Xor(x, k3));
+        p1 = Xor(p1, x);
+        k4 = Xor(Expand(k4), k3);
+        x = Round(Xor(p0, k4));
+        k5 = Xor(Expand(k5), k4);
+        x = Round(Xor(x, k5));
+        k6 = Xor(Expand(k6), k5);
+        x = Round(Xor(x, k6));
+        k7 = Xor(Expand(k7), k6);
+        x = Round(Xor(x, k7));
+        p3 = Xor(p3, x);
+
+        /* round 4, 8, 12 */
+        k0 = Xor(k0, Shift(k7, k6));
+        x = Round(Xor(p1, k0));
+        k1 = Xor(k1, Shift(k0, k7));
+        x = Round(Xor(x, k1));
+        k2 = Xor(k2, Shift(k1, k0));
+        x = Round(Xor(x, k2));
+        k3 = Xor(k3, Shift(k2, k1));
+        x = Round(Xor(x, k3));
+        p0 = Xor(p0, x);
+        k4 = Xor(k4, Shift(k3, k2));
+        x = Round(Xor(p3, k4));
+        k5 = Xor(k5, Shift(k4, k3));
+        x = Round(Xor(x, k5));
+        k6 = Xor(k6, Shift(k5, k4));
+        x = Round(Xor(x, k6));
+        k7 = Xor(k7, Shift(k6, k5));
+        x = Round(Xor(x, k7));
+        p2 = Xor(p2, x);
+    }
+
+    /* round 13 */
+    k0 = Xor(Expand(k0), k7);
+    x = Round(Xor(p0, k0));
+    k1 = Xor(Expand(k1), k0);
+    x = Round(Xor(x, k1));
+    k2 = Xor(Expand(k2), k1);
+    x = Round(Xor(x, k2));
+    k3 = Xor(Expand(k3), k2);
+    x = Round(Xor(x, k3));
+    p3 = Xor(p3, x);
+    k4 = Xor(Expand(k4), k3);
+    x = Round(Xor(p2, k4));
+    k5 = Xor(Expand(k5), k4);
+    x = Round(Xor(x, k5));
+    k6 = Xor(Xor(Expand(k6), k5), cnt13);
+    x = Round(Xor(x, k6));
+    k7 = Xor(Expand(k7), k6);
+    x = Round(Xor(x, k7));
+    p1 = Xor(p1, x);
+
+    _mm_storeu_si128((__m128i*)&sc->h[0x0], Xor(_mm_loadu_si128((const __m128i*)&sc->h[0x0]), p2));
+    _mm_storeu_si128((__m128i*)&sc->h[0x4], Xor(_mm_loadu_si128((const __m128i*)&sc->h[0x4]), p3));
+    _mm_storeu_si128((__m128i*)&sc->h[0x8], Xor(_mm_loadu_si128((const __m128i*)&sc->h[0x8]), p0));
+    _mm_storeu_si128((__m128i*)&sc->h[0xC], Xor(_mm_loadu_si128((const __m128i*)&sc->h[0xC]), p1));
+}
+
+} // namespace shavite512_aesni
+
+#endif
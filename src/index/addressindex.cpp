@@ -0,0 +1,307 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <crypto/sha256.h>
+#include <index/addressindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* Keys of both tables start with the SHA256 hash of the scriptPubKey followed by the block height
+ * as big-endian, so that all entries of a script are stored next to each other ordered by height
+ * and a height range can be read with a single seek.
+ *
+ * Delta keys have the type [DB_ADDRESS_DELTA, script hash, height (BE), tx position (BE), txid,
+ * input or output index (BE), spending] and the signed amount as value.
+ * Unspent keys have the type [DB_ADDRESS_UNSPENT, script hash, height (BE), txid, output index
+ * (BE)] and the amount as value.
+ */
+constexpr char DB_ADDRESS_DELTA = 'd';
+constexpr char DB_ADDRESS_UNSPENT = 'u';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+namespace {
+
+struct DBDeltaKey {
+    uint256 script_hash;
+    int height;
+    uint32_t tx_pos;
+    uint256 txid;
+    uint32_t index;
+    bool spending;
+
+    DBDeltaKey() : height(0), tx_pos(0), index(0), spending(false) {}
+    DBDeltaKey(const uint256& script_hash_in, int height_in, uint32_t tx_pos_in,
+               const uint256& txid_in, uint32_t index_in, bool spending_in) :
+        script_hash(script_hash_in), height(height_in), tx_pos(tx_pos_in),
+        txid(txid_in), index(index_in), spending(spending_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_DELTA);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, tx_pos);
+        s << txid;
+        ser_writedata32be(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ADDRESS_DELTA) {
+            throw std::ios_base::failure("Invalid format for address index DB delta key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        tx_pos = ser_readdata32be(s);
+        s >> txid;
+        index = ser_readdata32be(s);
+        spending = ser_readdata8(s);
+    }
+};
+
+struct DBUnspentKey {
+    uint256 script_hash;
+    int height;
+    COutPoint outpoint;
+
+    DBUnspentKey() : height(0) {}
+    DBUnspentKey(const uint256& script_hash_in, int height_in, const COutPoint& outpoint_in) :
+        script_hash(script_hash_in), height(height_in), outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_UNSPENT);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        s << outpoint.hash;
+        ser_writedata32be(s, outpoint.n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ADDRESS_UNSPENT) {
+            throw std::ios_base::failure("Invalid format for address index DB unspent key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        s >> outpoint.hash;
+        outpoint.n = ser_readdata32be(s);
+    }
+};
+
+/** Leading part of the keys of both tables, to seek to the first entry of a script at a height */
+struct DBSeekKey {
+    char prefix;
+    uint256 script_hash;
+    int height;
+
+    DBSeekKey(char prefix_in, const uint256& script_hash_in, int height_in) :
+        prefix(prefix_in), script_hash(script_hash_in), height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, prefix);
+        s << script_hash;
+        ser_writedata32be(s, height);
+    }
+};
+
+} // namespace
+
+static uint256 GetScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+/**
+ * Access to the addressindex database (indexes/addressindex/)
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Write (or, when disconnecting, erase) the deltas and unspent outputs of a block to a batch.
+    void WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& block_undo,
+                    int height, bool disconnect);
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+void AddressIndex::DB::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& block_undo,
+                                  int height, bool disconnect)
+{
+    // Transactions are visited in reverse when disconnecting, so an output spent
+    // within the same block is restored as unspent before it is erased again.
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const size_t tx_pos = disconnect ? block.vtx.size() - 1 - i : i;
+        const CTransaction& tx = *block.vtx[tx_pos];
+        const uint256& txid = tx.GetHash();
+
+        // the coinbase transaction has no undo entry
+        if (tx_pos > 0) {
+            const CTxUndo& tx_undo = block_undo.vtxundo[tx_pos - 1];
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = tx_undo.vprevout[j];
+                if (coin.out.scriptPubKey.empty()) continue;
+
+                const uint256 script_hash = GetScriptHash(coin.out.scriptPubKey);
+                const DBDeltaKey delta_key(script_hash, height, tx_pos, txid, j, true);
+                const DBUnspentKey unspent_key(script_hash, coin.nHeight, prevout);
+                if (disconnect) {
+                    batch.Erase(delta_key);
+                    batch.Write(unspent_key, coin.out.nValue);
+                } else {
+                    batch.Write(delta_key, -coin.out.nValue);
+                    batch.Erase(unspent_key);
+                }
+            }
+        }
+
+        for (size_t j = 0; j < tx.vout.size(); ++j) {
+            const CTxOut& out = tx.vout[j];
+            if (out.scriptPubKey.empty() || out.scriptPubKey.IsUnspendable()) continue;
+
+            const uint256 script_hash = GetScriptHash(out.scriptPubKey);
+            const DBDeltaKey delta_key(script_hash, height, tx_pos, txid, j, false);
+            const DBUnspentKey unspent_key(script_hash, height, COutPoint(txid, j));
+            if (disconnect) {
+                batch.Erase(delta_key);
+                batch.Erase(unspent_key);
+            } else {
+                batch.Write(delta_key, out.nValue);
+                batch.Write(unspent_key, out.nValue);
+            }
+        }
+    }
+}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    // Blocks that left the active chain while the index was not running still have their
+    // entries in the index, remove them before syncing from the fork point.
+    CBlockLocator locator;
+    if (m_db->ReadBestBlock(locator) && !locator.vHave.empty()) {
+        const CBlockIndex* best_block_index;
+        const CBlockIndex* fork_index;
+        {
+            LOCK(cs_main);
+            best_block_index = LookupBlockIndex(locator.vHave.front());
+            fork_index = best_block_index ? chainActive.FindFork(best_block_index) : nullptr;
+        }
+        if (fork_index && fork_index != best_block_index && !Rewind(best_block_index, fork_index)) {
+            return false;
+        }
+    }
+
+    return BaseIndex::Init();
+}
+
+bool AddressIndex::BuildBlockBatch(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    m_db->WriteBlock(batch, block, block_undo, pindex->nHeight, false);
+    return true;
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // The disconnected blocks are still on disk, remove what they added to the index
+    // in a single batch with the new locator so a failure leaves the index at current_tip.
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        if (pindex->nHeight == 0) continue;
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        CBlockUndo block_undo;
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: Failed to read undo data of block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        m_db->WriteBlock(batch, block, block_undo, pindex->nHeight, true);
+    }
+    WriteLocator(batch, new_tip);
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::LookupDeltas(const CScript& script, int start_height, int end_height,
+                                std::vector<AddressDelta>& deltas) const
+{
+    const uint256 script_hash = GetScriptHash(script);
+
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    for (db_it->Seek(DBSeekKey(DB_ADDRESS_DELTA, script_hash, start_height)); db_it->Valid(); db_it->Next()) {
+        DBDeltaKey key;
+        if (!db_it->GetKey(key) || key.script_hash != script_hash || key.height > end_height) {
+            break;
+        }
+
+        CAmount amount;
+        if (!db_it->GetValue(amount)) {
+            return error("%s: unable to read value in %s at height %d", __func__, GetName(), key.height);
+        }
+        deltas.push_back({key.height, key.tx_pos, key.txid, key.index, key.spending, amount});
+    }
+    return true;
+}
+
+bool AddressIndex::LookupUnspent(const CScript& script, int start_height, int end_height,
+                                 std::vector<AddressUnspent>& unspent) const
+{
+    const uint256 script_hash = GetScriptHash(script);
+
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    for (db_it->Seek(DBSeekKey(DB_ADDRESS_UNSPENT, script_hash, start_height)); db_it->Valid(); db_it->Next()) {
+        DBUnspentKey key;
+        if (!db_it->GetKey(key) || key.script_hash != script_hash || key.height > end_height) {
+            break;
+        }
+
+        CAmount amount;
+        if (!db_it->GetValue(amount)) {
+            return error("%s: unable to read value in %s at height %d", __func__, GetName(), key.height);
+        }
+        unspent.push_back({key.outpoint, key.height, amount});
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+#include <script/script.h>
+
+#include <vector>
+
+static const bool DEFAULT_ADDRESSINDEX = false;
+
+/** A change to the balance of a script made by one transaction input or output */
+struct AddressDelta
+{
+    int height;
+    uint32_t tx_pos;
+    uint256 txid;
+    /// index of the input if spending, of the output otherwise
+    uint32_t index;
+    bool spending;
+    CAmount amount;
+};
+
+/** An unspent output paying to a script */
+struct AddressUnspent
+{
+    COutPoint outpoint;
+    int height;
+    CAmount amount;
+};
+
+/**
+ * AddressIndex is used to look up the history, balance and unspent outputs of
+ * a scriptPubKey. The index is written to a LevelDB database and records, by
+ * script hash, block height and position in the block, every input and output
+ * touching the script, together with the outputs that are still unspent.
+ * Blocks that are disconnected are removed again by reading their undo data.
+ * Unspent outputs would come back if a block were connected twice, so the
+ * locator is written together with the entries of every block.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool Init() override;
+
+    bool BuildBlockBatch(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) override;
+
+    bool AllowParallelSync() const override { return true; }
+
+    bool CommitWithBlocks() const override { return true; }
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Look up the inputs and outputs touching a script within a range of block heights.
+    ///
+    /// @param[in]   script  The scriptPubKey to look up.
+    /// @param[in]   start_height  The first block height to include.
+    /// @param[in]   end_height  The last block height to include.
+    /// @param[out]  deltas  The balance changes, ordered by height and position in the block.
+    /// @return  false if the database is corrupted, true otherwise
+    bool LookupDeltas(const CScript& script, int start_height, int end_height, std::vector<AddressDelta>& deltas) const;
+
+    /// Look up the unspent outputs paying to a script created within a range of block heights.
+    ///
+    /// @param[in]   script  The scriptPubKey to look up.
+    /// @param[in]   start_height  The first block height to include.
+    /// @param[in]   end_height  The last block height to include.
+    /// @param[out]  unspent  The unspent outputs, ordered by height.
+    /// @return  false if the database is corrupted, true otherwise
+    bool LookupUnspent(const CScript& script, int start_height, int end_height, std::vector<AddressUnspent>& unspent) const;
+};
+
+/// The global address index. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
@@ -7,15 +7,23 @@
 #include <shutdown.h>
 #include <tinyformat.h>
 #include <ui_interface.h>
+#include <util/memory.h>
 #include <util/system.h>
 #include <validation.h>
 #include <warnings.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
 
+constexpr size_t SYNC_BLOCKS_PER_WORKER = 4; // blocks read ahead of the sync thread, per worker
+
 template<typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
 {
@@ -46,6 +54,11 @@ bool BaseIndex::DB::WriteBestBlock(const CBlockLocator& locator)
     return Write(DB_BEST_BLOCK, locator);
 }
 
+void BaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator)
+{
+    batch.Write(DB_BEST_BLOCK, locator);
+}
+
 BaseIndex::~BaseIndex()
 {
     Interrupt();
@@ -69,6 +82,167 @@ bool BaseIndex::Init()
     return true;
 }
 
+namespace {
+
+/** Workers taken by the pipelines of all indexes syncing at the same time, at most -indexsyncworkers */
+Mutex g_sync_workers_mutex;
+int g_sync_workers_in_use GUARDED_BY(g_sync_workers_mutex){0};
+
+int AcquireSyncWorkers(int n_wanted)
+{
+    const int64_t n_arg = gArgs.GetArg("-indexsyncworkers", std::min(GetNumCores(), MAX_INDEX_SYNC_WORKERS));
+    const int n_budget = std::max(0, static_cast<int>(std::min<int64_t>(n_arg, MAX_INDEX_SYNC_WORKERS)));
+    LOCK(g_sync_workers_mutex);
+    const int n_acquired = std::max(0, std::min(n_wanted, n_budget - g_sync_workers_in_use));
+    g_sync_workers_in_use += n_acquired;
+    return n_acquired;
+}
+
+void ReleaseSyncWorkers(int n_acquired)
+{
+    LOCK(g_sync_workers_mutex);
+    g_sync_workers_in_use -= n_acquired;
+}
+
+/**
+ * Blocks the sync thread is about to write, in chain order. Worker threads
+ * read and deserialize them from disk ahead of the sync thread and, for
+ * indexes that allow it, build their index batches as well, so that the sync
+ * thread only has to write the results in order.
+ */
+class SyncPipeline
+{
+public:
+    using BuildFn = std::function<bool(const CBlock&, const CBlockIndex*, CDBBatch&)>;
+
+    struct Job {
+        const CBlockIndex* pindex;
+        CBlock block;
+        /// The index entries of the block, if built by the workers.
+        std::unique_ptr<CDBBatch> batch;
+        bool read_ok{false};
+        bool build_ok{false};
+        bool done{false};
+    };
+
+    /// build_batch is left empty if the index entries are written by the sync thread.
+    /// The workers are taken from those left by other indexes syncing at the same
+    /// time. Without any, blocks are processed on the sync thread as they are popped.
+    SyncPipeline(const Consensus::Params& consensus_params, const CDBWrapper& db, BuildFn build_batch)
+        : m_consensus_params(consensus_params), m_db(db), m_build_batch(std::move(build_batch))
+    {
+        const int n_workers = AcquireSyncWorkers(MAX_INDEX_SYNC_WORKERS);
+        for (int i = 0; i < n_workers; i++) {
+            m_workers.emplace_back(&SyncPipeline::ThreadWorker, this);
+        }
+    }
+
+    ~SyncPipeline()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+        ReleaseSyncWorkers(static_cast<int>(m_workers.size()));
+    }
+
+    /// The number of blocks to keep queued ahead of the sync thread.
+    size_t Capacity() const
+    {
+        return std::max<size_t>(m_workers.size() * SYNC_BLOCKS_PER_WORKER, 1);
+    }
+
+    size_t Size() const
+    {
+        LOCK(m_mutex);
+        return m_jobs.size();
+    }
+
+    /// Queue the next block to be written.
+    void Push(const CBlockIndex* pindex)
+    {
+        {
+            LOCK(m_mutex);
+            m_jobs.emplace_back(MakeUnique<Job>());
+            m_jobs.back()->pindex = pindex;
+            if (!m_workers.empty()) m_pending.push_back(m_jobs.back().get());
+        }
+        m_cv.notify_all();
+    }
+
+    /// Wait for the oldest queued block to be processed and remove it from the pipeline.
+    std::unique_ptr<Job> Pop()
+    {
+        std::unique_ptr<Job> job;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            assert(!m_jobs.empty());
+            if (!m_workers.empty()) {
+                m_cv.wait(lock, [this] { return m_jobs.front()->done; });
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        if (!job->done) {
+            Process(*job);
+            job->done = true;
+        }
+        return job;
+    }
+
+private:
+    void Process(Job& job) const
+    {
+        job.read_ok = ReadBlockFromDisk(job.block, job.pindex, m_consensus_params);
+        if (job.read_ok && m_build_batch) {
+            job.batch = MakeUnique<CDBBatch>(m_db);
+            job.build_ok = m_build_batch(job.block, job.pindex, *job.batch);
+        }
+    }
+
+    void ThreadWorker()
+    {
+        RenameThread("chaincoin-idxsync");
+        while (true) {
+            Job* job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+                if (m_stop) return;
+                job = m_pending.front();
+                m_pending.pop_front();
+            }
+
+            Process(*job);
+
+            {
+                LOCK(m_mutex);
+                job->done = true;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    const Consensus::Params& m_consensus_params;
+    const CDBWrapper& m_db;
+    const BuildFn m_build_batch;
+
+    mutable Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::unique_ptr<Job>> m_jobs GUARDED_BY(m_mutex);
+    /// Jobs not picked up by a worker yet.
+    std::deque<Job*> m_pending GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace
+
 static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
@@ -89,28 +263,72 @@ void BaseIndex::ThreadSync()
 {
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
+        SyncPipeline::BuildFn build_batch;
+        if (AllowParallelSync()) {
+            build_batch = std::bind(&BaseIndex::BuildBlockBatch, this,
+                                    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+        }
+        SyncPipeline pipeline(Params().GetConsensus(), GetDB(), build_batch);
+        // The last block handed to the pipeline. pindex is the last one written.
+        const CBlockIndex* pindex_queued = pindex;
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
         while (true) {
             if (m_interrupt) {
-                WriteBestBlock(pindex);
+                m_best_block_index = pindex;
+                // No need to handle errors in Commit. If it fails, the error will be already be
+                // logged. The best way to recover is to continue, as index cannot be corrupted by
+                // a missed commit to disk for an advanced index state.
+                Commit();
                 return;
             }
 
             {
                 LOCK(cs_main);
-                const CBlockIndex* pindex_next = NextSyncBlock(pindex);
-                if (!pindex_next) {
-                    WriteBestBlock(pindex);
+                while (pipeline.Size() < pipeline.Capacity()) {
+                    const CBlockIndex* pindex_next = NextSyncBlock(pindex_queued);
+                    if (!pindex_next) break;
+                    if (pindex_next->pprev != pindex_queued) {
+                        // The blocks already queued are written before rewinding past them.
+                        if (pipeline.Size() > 0) break;
+                        if (!Rewind(pindex, pindex_next->pprev)) {
+                            FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                                       __func__, GetName());
+                            return;
+                        }
+                        pindex = pindex_next->pprev;
+                    }
+                    pipeline.Push(pindex_next);
+                    pindex_queued = pindex_next;
+                }
+                if (pipeline.Size() == 0) {
                     m_best_block_index = pindex;
                     m_synced = true;
+                    // No need to handle errors in Commit. See rationale above.
+                    Commit();
                     break;
                 }
-                pindex = pindex_next;
             }
 
+            std::unique_ptr<SyncPipeline::Job> job = pipeline.Pop();
+            if (!job->read_ok) {
+                FatalError("%s: Failed to read block %s from disk",
+                           __func__, job->pindex->GetBlockHash().ToString());
+                return;
+            }
+            if (job->batch && job->build_ok && CommitWithBlocks()) {
+                WriteLocator(*job->batch, job->pindex);
+            }
+            const bool written = job->batch ? job->build_ok && GetDB().WriteBatch(*job->batch)
+                                            : WriteBlock(job->block, job->pindex);
+            if (!written) {
+                FatalError("%s: Failed to write block %s to index database",
+                           __func__, job->pindex->GetBlockHash().ToString());
+                return;
+            }
+            pindex = job->pindex;
+
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
                 LogPrintf("Syncing %s with block chain from height %d\n",
@@ -119,20 +337,10 @@ void BaseIndex::ThreadSync()
             }
 
             if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
-                WriteBestBlock(pindex);
+                m_best_block_index = pindex;
                 last_locator_write_time = current_time;
-            }
-
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
-            if (!WriteBlock(block, pindex)) {
-                FatalError("%s: Failed to write block %s to index database",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
+                // No need to handle errors in Commit. See rationale above.
+                Commit();
             }
         }
     }
@@ -144,12 +352,48 @@ void BaseIndex::ThreadSync()
     }
 }
 
-bool BaseIndex::WriteBestBlock(const CBlockIndex* block_index)
+bool BaseIndex::Commit()
+{
+    CDBBatch batch(GetDB());
+    if (!CommitInternal(batch) || !GetDB().WriteBatch(batch)) {
+        return error("%s: Failed to commit latest %s state", __func__, GetName());
+    }
+    return true;
+}
+
+bool BaseIndex::CommitInternal(CDBBatch& batch)
 {
     LOCK(cs_main);
-    if (!GetDB().WriteBestBlock(chainActive.GetLocator(block_index))) {
-        return error("%s: Failed to write locator to disk", __func__);
+    GetDB().WriteBestBlock(batch, chainActive.GetLocator(m_best_block_index));
+    return true;
+}
+
+void BaseIndex::WriteLocator(CDBBatch& batch, const CBlockIndex* pindex)
+{
+    LOCK(cs_main);
+    GetDB().WriteBestBlock(batch, chainActive.GetLocator(pindex));
+}
+
+bool BaseIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(GetDB());
+    if (!BuildBlockBatch(block, pindex, batch)) return false;
+    if (CommitWithBlocks()) WriteLocator(batch, pindex);
+    return GetDB().WriteBatch(batch);
+}
+
+bool BaseIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // In the case of a reorg, ensure persisted block locator is not stale.
+    m_best_block_index = new_tip;
+    if (!Commit()) {
+        // If commit fails, revert the best block index to avoid corruption.
+        m_best_block_index = current_tip;
+        return false;
     }
+
     return true;
 }
 
@@ -180,6 +424,11 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
                       best_block_index->GetBlockHash().ToString());
             return;
         }
+        if (best_block_index != pindex->pprev && !Rewind(best_block_index, pindex->pprev)) {
+            FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                       __func__, GetName());
+            return;
+        }
     }
 
     if (WriteBlock(*block, pindex)) {
@@ -191,6 +440,27 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
     }
 }
 
+void BaseIndex::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    if (!m_synced) {
+        return;
+    }
+
+    // Only the current best block can be rewound here. Blocks disconnected while the index was
+    // behind are handled by the Rewind in BlockConnected once the new chain gets connected.
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    if (!best_block_index || best_block_index->GetBlockHash() != block->GetHash() ||
+        !best_block_index->pprev) {
+        return;
+    }
+
+    if (!Rewind(best_block_index, best_block_index->pprev)) {
+        FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                   __func__, GetName());
+        return;
+    }
+}
+
 void BaseIndex::ChainStateFlushed(const CBlockLocator& locator)
 {
     if (!m_synced) {
@@ -224,9 +494,10 @@ void BaseIndex::ChainStateFlushed(const CBlockLocator& locator)
         return;
     }
 
-    if (!GetDB().WriteBestBlock(locator)) {
-        error("%s: Failed to write locator to disk", __func__);
-    }
+    // No need to handle errors in Commit. If it fails, the error will be already be logged. The
+    // best way to recover is to continue, as index cannot be corrupted by a missed commit to disk
+    // for an advanced index state.
+    Commit();
 }
 
 bool BaseIndex::BlockUntilSyncedToCurrentChain()
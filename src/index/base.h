@@ -14,6 +14,9 @@
 
 class CBlockIndex;
 
+/** Maximum number of threads reading blocks ahead of the index sync threads, shared by all indexes */
+static const int MAX_INDEX_SYNC_WORKERS = 8;
+
 /**
  * Base class for indices of blockchain data. This implements
  * CValidationInterface and ensures blocks are indexed sequentially according
@@ -33,6 +36,9 @@ protected:
 
         /// Write block locator of the chain that the txindex is in sync with.
         bool WriteBestBlock(const CBlockLocator& locator);
+
+        /// Write block locator of the chain that the txindex is in sync with to a batch.
+        void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
     };
 
 private:
@@ -49,25 +55,61 @@ private:
 
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
-    /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
-    /// flag is set and the BlockConnected ValidationInterface callback takes
-    /// over and the sync thread exits.
+    /// interrupted with m_interrupt. Blocks are read ahead by a pool of workers
+    /// and written in chain order by this thread. Once the index gets in sync,
+    /// the m_synced flag is set and the BlockConnected ValidationInterface
+    /// callback takes over and the sync thread exits.
     void ThreadSync();
 
-    /// Write the current chain block locator to the DB.
-    bool WriteBestBlock(const CBlockIndex* block_index);
+    /// Write the current index state (eg. chain block locator and subclass-specific items) to disk.
+    ///
+    /// Recommendations for error handling:
+    /// If called on a successor of the previous committed best block in the index, the index can
+    /// continue processing without risk of corruption, though the index state will need to catch up
+    /// from further behind on reboot. If the new state is not a successor of the previous state (due
+    /// to a chain reorganization), the index must halt until Commit succeeds or else it could end up
+    /// getting corrupted.
+    bool Commit();
 
 protected:
     void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
                         const std::vector<CTransactionRef>& txn_conflicted) override;
 
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+
     void ChainStateFlushed(const CBlockLocator& locator) override;
 
     /// Initialize internal state from the database and block index.
     virtual bool Init();
 
-    /// Write update index entries for a newly connected block.
-    virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
+    /// Write update index entries for a newly connected block. By default this writes the
+    /// entries added by BuildBlockBatch.
+    virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex);
+
+    /// Add the index entries of a newly connected block to a batch. Indexes building their
+    /// entries here instead of overriding WriteBlock can enable AllowParallelSync.
+    virtual bool BuildBlockBatch(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) { return true; }
+
+    /// Whether the sync thread may call BuildBlockBatch for several blocks at once from its
+    /// workers. Only valid if the entries of a block do not depend on those of earlier blocks.
+    /// The batches are always written in chain order.
+    virtual bool AllowParallelSync() const { return false; }
+
+    /// Whether the block locator is written in the same batch as the entries of every block, for
+    /// indexes that would be corrupted by adding the entries of a block a second time after an
+    /// unclean shutdown.
+    virtual bool CommitWithBlocks() const { return false; }
+
+    /// Add the locator of a block to a batch, making it the best block once the batch is written.
+    void WriteLocator(CDBBatch& batch, const CBlockIndex* pindex);
+
+    /// Virtual method called internally by Commit that can be overridden to atomically
+    /// commit more index state.
+    virtual bool CommitInternal(CDBBatch& batch);
+
+    /// Rewind index to an earlier chain tip during a chain reorg. The tip must
+    /// be an ancestor of the current best block.
+    virtual bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip);
 
     virtual DB& GetDB() const = 0;
 
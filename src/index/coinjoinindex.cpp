@@ -0,0 +1,151 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/coinjoinindex.h>
+#include <modules/coinjoin/coinjoin.h>
+#include <txmempool.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <numeric>
+
+constexpr char DB_COINJOIN_DEPTHS = 'd';
+
+std::unique_ptr<CoinJoinIndex> g_coinjoinindex;
+
+/**
+ * Access to the coinjoinindex database (indexes/coinjoinindex/)
+ *
+ * Only transactions with at least one denominated output are stored, so the
+ * database stays small and a miss means the transaction was never mixed.
+ */
+class CoinJoinIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Read the depths of the outputs of the transaction with the given hash. Returns false if the
+    /// transaction hash is not indexed.
+    bool ReadDepths(const uint256& txid, std::vector<int>& depths) const;
+
+    /// Write a batch of transaction output depths to the DB.
+    bool WriteDepths(const std::map<uint256, std::vector<int>>& depths);
+};
+
+CoinJoinIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "coinjoinindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool CoinJoinIndex::DB::ReadDepths(const uint256& txid, std::vector<int>& depths) const
+{
+    return Read(std::make_pair(DB_COINJOIN_DEPTHS, txid), depths);
+}
+
+bool CoinJoinIndex::DB::WriteDepths(const std::map<uint256, std::vector<int>>& depths)
+{
+    CDBBatch batch(*this);
+    for (const auto& tuple : depths) {
+        batch.Write(std::make_pair(DB_COINJOIN_DEPTHS, tuple.first), tuple.second);
+    }
+    return WriteBatch(batch);
+}
+
+CoinJoinIndex::CoinJoinIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<CoinJoinIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+CoinJoinIndex::~CoinJoinIndex() {}
+
+std::vector<int> CoinJoinIndex::CalculateDepths(const CTransaction& tx,
+                                                const std::map<uint256, std::vector<int>>& m_pending) const
+{
+    bool any_denom = false;
+    bool all_denoms = true;
+    for (const auto& out : tx.vout) {
+        bool is_denom = CCoinJoin::IsDenominatedAmount(out.nValue);
+        any_denom = any_denom || is_denom;
+        all_denoms = all_denoms && is_denom;
+    }
+    if (!any_denom) return {};
+
+    std::vector<int> depths;
+    depths.reserve(tx.vout.size());
+
+    // this one is denominated but there is another non-denominated output found in the same tx
+    if (!all_denoms) {
+        for (const auto& out : tx.vout) {
+            depths.push_back(CCoinJoin::IsDenominatedAmount(out.nValue) ? 0 : -2);
+        }
+        return depths;
+    }
+
+    // only denoms here, so each input adds one round to the depth of the output it spends,
+    // up to MAX_COINJOIN_DEPTH
+    std::vector<int> roots;
+    roots.reserve(tx.vin.size());
+    for (const auto& txin : tx.vin) {
+        int prev_depth = 0;
+        if (!txin.prevout.IsNull()) {
+            std::vector<int> prev_depths;
+            auto it = m_pending.find(txin.prevout.hash);
+            if (it != m_pending.end()) {
+                prev_depths = it->second;
+            } else {
+                m_db->ReadDepths(txin.prevout.hash, prev_depths);
+            }
+            if (txin.prevout.n < prev_depths.size()) {
+                prev_depth = std::max(prev_depths[txin.prevout.n], 0);
+            }
+        }
+        roots.push_back(std::min(prev_depth + 1, MAX_COINJOIN_DEPTH));
+    }
+
+    int depth = std::accumulate(roots.begin(), roots.end(), int64_t(0)) / std::max<size_t>(roots.size(), 1);
+    depths.assign(tx.vout.size(), depth);
+    return depths;
+}
+
+bool CoinJoinIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    // outputs spent within the same block are looked up here before the index
+    std::map<uint256, std::vector<int>> depths;
+    for (const auto& tx : block.vtx) {
+        std::vector<int> tx_depths = CalculateDepths(*tx, depths);
+        if (!tx_depths.empty()) {
+            depths.emplace(tx->GetHash(), std::move(tx_depths));
+        }
+    }
+    if (depths.empty()) return true;
+    return m_db->WriteDepths(depths);
+}
+
+BaseIndex::DB& CoinJoinIndex::GetDB() const { return *m_db; }
+
+bool CoinJoinIndex::LookupDepth(const COutPoint& outpoint, const CAmount& value, int& depth) const
+{
+    // transactions without a denominated output are not indexed, so a miss can't tell them apart
+    // from those the index hasn't reached yet
+    if (!CCoinJoin::IsDenominatedAmount(value)) {
+        depth = -2;
+        return true;
+    }
+
+    std::vector<int> depths;
+    if (!m_db->ReadDepths(outpoint.hash, depths)) {
+        CTransactionRef tx = mempool.get(outpoint.hash);
+        if (!tx) {
+            return false;
+        }
+        // mempool transactions are not indexed, their depth follows from the outputs they spend
+        depths = CalculateDepths(*tx, {});
+    }
+    if (outpoint.n >= depths.size()) {
+        return false;
+    }
+    depth = depths[outpoint.n];
+    return true;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_COINJOININDEX_H
+#define BITCOIN_INDEX_COINJOININDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+
+#include <map>
+#include <vector>
+
+static const bool DEFAULT_COINJOININDEX = false;
+
+/**
+ * CoinJoinIndex is used to look up how deeply the outputs of a transaction
+ * have been mixed. The index is written to a LevelDB database and records,
+ * for every transaction with a denominated output, the CoinJoin! depth of
+ * each of its outputs as blocks connect. A depth of -2 marks an output that
+ * is not denominated, 0 a denominated output of a transaction that also has
+ * non-denominated ones.
+ */
+class CoinJoinIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Depths of the outputs of tx, looking up spent outputs in m_pending
+    /// first and then in the index. Returns an empty vector for transactions
+    /// without a denominated output.
+    std::vector<int> CalculateDepths(const CTransaction& tx,
+                                     const std::map<uint256, std::vector<int>>& m_pending) const;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "coinjoinindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit CoinJoinIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~CoinJoinIndex() override;
+
+    /// Look up the CoinJoin! depth of an output, confirmed or in the mempool.
+    ///
+    /// @param[in]   outpoint  The output to look up.
+    /// @param[in]   value  The value of the output, a non-denominated output has depth -2 without a lookup.
+    /// @param[out]  depth  The depth of the output.
+    /// @return  true if the depth is known, false if a denominated output's transaction is neither
+    ///          indexed nor in the mempool
+    bool LookupDepth(const COutPoint& outpoint, const CAmount& value, int& depth) const;
+};
+
+/// The global CoinJoin! depth index. May be null.
+extern std::unique_ptr<CoinJoinIndex> g_coinjoinindex;
+
+#endif // BITCOIN_INDEX_COINJOININDEX_H
@@ -0,0 +1,117 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/spentindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+constexpr char DB_SPENT = 's';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/**
+ * Access to the spentindex database (indexes/spentindex/)
+ */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Read the input that spent an output. Returns false if the output is not indexed.
+    bool ReadSpent(const COutPoint& outpoint, SpentInfo& info) const;
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool SpentIndex::DB::ReadSpent(const COutPoint& outpoint, SpentInfo& info) const
+{
+    return Read(std::make_pair(DB_SPENT, outpoint), info);
+}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+static bool AddSpentOutputs(CDBBatch& batch, const CBlock& block, const CBlockUndo& block_undo, int height)
+{
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: undo data of block %s doesn't match its transactions",
+                     __func__, block.GetHash().ToString());
+    }
+
+    SpentInfo info;
+    info.height = height;
+    // the coinbase transaction spends nothing and has no undo entry
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+        if (tx_undo.vprevout.size() != tx.vin.size()) {
+            return error("%s: undo data of transaction %s doesn't match its inputs",
+                         __func__, tx.GetHash().ToString());
+        }
+        info.txid = tx.GetHash();
+        for (size_t j = 0; j < tx.vin.size(); ++j) {
+            info.input_index = j;
+            info.amount = tx_undo.vprevout[j].out.nValue;
+            batch.Write(std::make_pair(DB_SPENT, tx.vin[j].prevout), info);
+        }
+    }
+    return true;
+}
+
+bool SpentIndex::BuildBlockBatch(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+    return AddSpentOutputs(batch, block, block_undo, pindex->nHeight);
+}
+
+bool SpentIndex::WriteSpentOutputs(const CBlock& block, const CBlockUndo& block_undo, int height)
+{
+    CDBBatch batch(*m_db);
+    return AddSpentOutputs(batch, block, block_undo, height) && m_db->WriteBatch(batch);
+}
+
+bool SpentIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Outputs spent by the disconnected blocks are unspent again.
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        if (pindex->nHeight == 0) continue;
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        for (size_t i = 1; i < block.vtx.size(); ++i) {
+            for (const CTxIn& txin : block.vtx[i]->vin) {
+                batch.Erase(std::make_pair(DB_SPENT, txin.prevout));
+            }
+        }
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+bool SpentIndex::LookupSpent(const COutPoint& outpoint, SpentInfo& info) const
+{
+    return m_db->ReadSpent(outpoint, info);
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+#include <serialize.h>
+
+class CBlockUndo;
+
+static const bool DEFAULT_SPENTINDEX = false;
+
+/** The input that spent an output */
+struct SpentInfo
+{
+    uint256 txid;
+    uint32_t input_index;
+    int height;
+    /// value of the spent output
+    CAmount amount;
+
+    SpentInfo() : input_index(0), height(0), amount(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(input_index);
+        READWRITE(height);
+        READWRITE(amount);
+    }
+};
+
+/**
+ * SpentIndex is used to look up the transaction input that spent an output.
+ * The index is written to a LevelDB database and records, by outpoint, the
+ * spending transaction, the input index and the height of the block, together
+ * with the value of the spent output taken from the block undo data.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool BuildBlockBatch(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) override;
+
+    bool AllowParallelSync() const override { return true; }
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Write the outputs spent by a block, with block_undo holding the coins they spent.
+    bool WriteSpentOutputs(const CBlock& block, const CBlockUndo& block_undo, int height);
+
+    /// Look up the input that spent an output.
+    ///
+    /// @param[in]   outpoint  The output to look up.
+    /// @param[out]  info  The spending input.
+    /// @return  true if the output was spent in the active chain, false otherwise
+    bool LookupSpent(const COutPoint& outpoint, SpentInfo& info) const;
+};
+
+/// The global spent output index. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
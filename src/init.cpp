@@ -20,10 +20,17 @@
 #include <checkpoints.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <crypto/cubehash512.h>
+#include <crypto/echo512.h>
+#include <crypto/shavite512.h>
 #include <fs.h>
 #include <httpserver.h>
 #include <httprpc.h>
 #include <interfaces/chain.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/coinjoinindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <interfaces/modules.h>
 #include <key.h>
@@ -58,7 +65,6 @@
 #include <netfulfilledman.h>
 
 #include <modules/masternode/activemasternode.h>
-#include <modules/coinjoin/coinjoin_analyzer.h>
 #include <modules/masternode/masternode_payments.h>
 #include <modules/masternode/masternode_sync.h>
 #include <modules/masternode/masternode_man.h>
@@ -69,6 +75,9 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <functional>
+#include <future>
+
 #ifndef WIN32
 #include <attributes.h>
 #include <cerrno>
@@ -95,8 +104,6 @@ static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 
 // Dump addresses to banlist.dat every 15 minutes (900s)
 static constexpr int DUMP_BANS_INTERVAL = 60 * 15;
-// Clean coinjoin cache every 60 minutes (3600s)
-static constexpr int CJ_CLEAN_INTERVAL = 60 * 60;
 
 std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
@@ -105,6 +112,9 @@ std::unique_ptr<BanMan> g_banman;
 
 static ModuleInterface* pModuleNotificationInterface = nullptr;
 
+// Block filter types with an enabled -blockfilterindex
+static std::vector<BlockFilterType> g_enabled_filter_types;
+
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
 // accessing block files don't count towards the fd_set size limit
@@ -210,6 +220,16 @@ void Interrupt()
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_coinjoinindex) {
+        g_coinjoinindex->Interrupt();
+    }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_spentindex) {
+        g_spentindex->Interrupt();
+    }
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
 }
 
 void Shutdown(InitInterfaces& interfaces)
@@ -241,20 +261,18 @@ void Shutdown(InitInterfaces& interfaces)
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
+    if (g_coinjoinindex) g_coinjoinindex->Stop();
+    if (g_addressindex) g_addressindex->Stop();
+    if (g_spentindex) g_spentindex->Stop();
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
 
     if (!fLiteMode) {
-        // STORE DATA CACHES INTO SERIALIZED DAT FILES
-        CMNCacheDB mncachedb;
-        mncachedb.Write(mnodeman);
-        CMNPayDB mnpaydb;
-        mnpaydb.Write(mnpayments);
-        CGovDB govdb;
-        govdb.Write(funding);
+        // STORE DATA CACHES INTO THE MODULE CACHE DATABASE AND SERIALIZED DAT FILES
+        if (g_modulecachedb) {
+            g_modulecachedb->Flush(mnodeman, mnpayments, funding);
+        }
         CNetFulDB netfuldb;
         netfuldb.Write(netfulfilledman);
-        g_analyzer->WriteCache();
-        CCoinJoinDB coinjoindb;
-        coinjoindb.Write(*g_analyzer);
     }
 
     StopTorControl();
@@ -270,7 +288,11 @@ void Shutdown(InitInterfaces& interfaces)
     g_connman.reset();
     g_banman.reset();
     g_txindex.reset();
-    g_analyzer.reset();
+    g_coinjoinindex.reset();
+    g_addressindex.reset();
+    g_spentindex.reset();
+    DestroyAllBlockFilterIndexes();
+    g_modulecachedb.reset();
 
     if (g_is_mempool_loaded && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
@@ -414,12 +436,18 @@ void SetupServerArgs()
         "-allowselfsignedrootcertificates", "-choosedatadir", "-lang=<lang>", "-min", "-resetguisettings", "-rootcertificates=<file>", "-splash", "-uiplatform"};
 
     gArgs.AddArg("-version", "Print version and exit", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-addressindex", strprintf("Maintain an index of the inputs, outputs and unspent outputs of every address, used by the getaddress* calls (default: %u)", DEFAULT_ADDRESSINDEX), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockfilterindex=<type>",
+                 strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
+                 " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
+                 false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Transactions from the wallet or RPC are not affected. (default: %u)", DEFAULT_BLOCKSONLY), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinjoinindex", strprintf("Maintain an index of the CoinJoin! depth of denominated outputs, used for mixing and anonymized balances (default: %u)", DEFAULT_COINJOININDEX), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", CHAINCOIN_CONF_FILENAME), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), true, OptionsCategory::OPTIONS);
@@ -441,6 +469,7 @@ void SetupServerArgs()
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-spentindex", strprintf("Maintain an index of the transaction inputs spending every output, used by the getspentinfo call (default: %u)", DEFAULT_SPENTINDEX), false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", false, OptionsCategory::OPTIONS);
 #else
@@ -531,10 +560,12 @@ void SetupServerArgs()
         "each level includes the checks of the previous levels "
         "(0-4, default: %u)", DEFAULT_CHECKLEVEL), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-checkindexpow", strprintf("Check the proof of work of every block index entry at startup. If disabled, the ancestors of the last checkpoint and of the -assumevalid block are trusted (default: %u)", DEFAULT_CHECK_INDEX_POW), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages", true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-indexsyncworkers=<n>", strprintf("Number of threads reading blocks ahead of the index syncs, shared by all indexes (0 = sync on the index threads, default: number of cores, at most %d)", MAX_INDEX_SYNC_WORKERS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopatheight", strprintf("Stop running after reaching the given height in the main chain (default: %u)", DEFAULT_STOPATHEIGHT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-limitancestorcount=<n>", strprintf("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)", DEFAULT_ANCESTOR_LIMIT), true, OptionsCategory::DEBUG_TEST);
@@ -566,6 +597,7 @@ void SetupServerArgs()
     gArgs.AddArg("-mnconf=<file>", strprintf(_("Specify masternode configuration file (default: %s)"), "masternode.conf"), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mnconflock=<n>", strprintf(_("Lock masternodes from masternode configuration file (default: %u)"), 1), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-masternodeprivkey=<n>", _("Set the masternode private key"), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinjoinsessions=<n>", strprintf(_("Number of CoinJoin! sessions a masternode runs at the same time (1-%u, default: %u)"), COINJOIN_MAX_SESSIONS, DEFAULT_COINJOIN_SESSIONS), false, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-acceptnonstdtxn", strprintf("Relay and mine \"non-standard\" transactions (%sdefault: %u)", "testnet/regtest only; ", !testnetChainParams->RequireStandard()), true, OptionsCategory::NODE_RELAY);
     gArgs.AddArg("-incrementalrelayfee=<amt>", strprintf("Fee rate (in %s/kB) used to define cost of relay, used for mempool limiting and BIP 125 replacement. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_INCREMENTAL_RELAY_FEE)), true, OptionsCategory::NODE_RELAY);
@@ -643,6 +675,14 @@ static void BlockNotifyCallback(bool initialSync, const CBlockIndex *pBlockIndex
     }
 }
 
+/** Load one module cache on the calling thread and log how long it took */
+static void LoadModuleCache(const std::string& strName, const std::function<void()>& load)
+{
+    int64_t nStart = GetTimeMillis();
+    load();
+    LogPrintf("Loaded %s cache  %dms\n", strName, GetTimeMillis() - nStart);
+}
+
 static bool fHaveGenesis = false;
 static Mutex g_genesis_wait_mutex;
 static std::condition_variable g_genesis_wait_cv;
@@ -855,6 +895,12 @@ void InitParameterInteraction()
         }
     }
 
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        // CoinJoin! depths used to be looked up through the txindex
+        if (gArgs.SoftSetBoolArg("-coinjoinindex", true))
+            LogPrintf("%s: parameter interaction: -txindex=1 -> setting -coinjoinindex=1\n", __func__);
+    }
+
     if (gArgs.IsArgSet("-proxy")) {
         // to protect privacy, do not listen by default if a default proxy server is specified
         if (gArgs.SoftSetBoolArg("-listen", false))
@@ -1021,10 +1067,34 @@ bool AppInitParameterInteraction()
         return InitError(strprintf(_("Specified blocks directory \"%s\" does not exist."), gArgs.GetArg("-blocksdir", "").c_str()));
     }
 
+    // parse and validate enabled filter types
+    std::string blockfilterindex_value = gArgs.GetArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    if (blockfilterindex_value == "" || blockfilterindex_value == "1") {
+        g_enabled_filter_types = AllBlockFilterTypes();
+    } else if (blockfilterindex_value != "0") {
+        const std::vector<std::string> names = gArgs.GetArgs("-blockfilterindex");
+        g_enabled_filter_types.reserve(names.size());
+        for (const auto& name : names) {
+            BlockFilterType filter_type;
+            if (!BlockFilterTypeByName(name, filter_type)) {
+                return InitError(strprintf(_("Unknown -blockfilterindex value %s."), name));
+            }
+            g_enabled_filter_types.push_back(filter_type);
+        }
+    }
+
     // if using block pruning, then disallow txindex
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-coinjoinindex", DEFAULT_COINJOININDEX))
+            return InitError(_("Prune mode is incompatible with -coinjoinindex."));
+        if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex."));
+        if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX))
+            return InitError(_("Prune mode is incompatible with -spentindex."));
+        if (!g_enabled_filter_types.empty())
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1261,6 +1331,12 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string echo512_algo = ECHO512AutoDetect();
+    LogPrintf("Using the '%s' ECHO512 implementation\n", echo512_algo);
+    std::string shavite512_algo = SHAVITE512AutoDetect();
+    LogPrintf("Using the '%s' SHAVITE512 implementation\n", shavite512_algo);
+    std::string cubehash512_algo = CUBEHASH512AutoDetect();
+    LogPrintf("Using the '%s' CUBEHASH512 implementation\n", cubehash512_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1524,6 +1600,19 @@ bool AppInitMain(InitInterfaces& interfaces)
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
     nTotalCache -= nTxIndexCache;
+    int64_t nCoinJoinIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-coinjoinindex", DEFAULT_COINJOININDEX) ? nMaxCoinJoinIndexCache << 20 : 0);
+    nTotalCache -= nCoinJoinIndexCache;
+    int64_t nAddressIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ? nMaxAddressIndexCache << 20 : 0);
+    nTotalCache -= nAddressIndexCache;
+    int64_t nSpentIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ? nMaxSpentIndexCache << 20 : 0);
+    nTotalCache -= nSpentIndexCache;
+    int64_t nFilterIndexCache = 0;
+    if (!g_enabled_filter_types.empty()) {
+        size_t n_indexes = g_enabled_filter_types.size();
+        int64_t max_cache = std::min(nTotalCache / 8, nMaxBlockFilterIndexCache << 20);
+        nFilterIndexCache = max_cache / n_indexes;
+        nTotalCache -= nFilterIndexCache * n_indexes;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1534,6 +1623,19 @@ bool AppInitMain(InitInterfaces& interfaces)
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1f MiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
     }
+    if (gArgs.GetBoolArg("-coinjoinindex", DEFAULT_COINJOININDEX)) {
+        LogPrintf("* Using %.1f MiB for CoinJoin! index database\n", nCoinJoinIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        LogPrintf("* Using %.1f MiB for address index database\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        LogPrintf("* Using %.1f MiB for spent index database\n", nSpentIndexCache * (1.0 / 1024 / 1024));
+    }
+    for (BlockFilterType filter_type : g_enabled_filter_types) {
+        LogPrintf("* Using %.1f MiB for %s block filter index database\n",
+                  nFilterIndexCache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1636,6 +1738,12 @@ bool AppInitMain(InitInterfaces& interfaces)
                 break;
             }
 
+            // Hashes the loaded headers on worker threads, so it runs without cs_main
+            if (!CheckBlockIndexProofOfWork(chainparams)) {
+                strLoadError = _("Corrupted block database detected");
+                break;
+            }
+
             if (!fReset) {
                 // Note that RewindBlockIndex MUST run even if we're about to -reindex-chainstate.
                 // It both disconnects blocks based on chainActive, and drops block data in
@@ -1723,6 +1831,26 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_txindex->Start();
     }
 
+    if (gArgs.GetBoolArg("-coinjoinindex", DEFAULT_COINJOININDEX)) {
+        g_coinjoinindex = MakeUnique<CoinJoinIndex>(nCoinJoinIndexCache, false, fReindex);
+        g_coinjoinindex->Start();
+    }
+
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_addressindex = MakeUnique<AddressIndex>(nAddressIndexCache, false, fReindex);
+        g_addressindex->Start();
+    }
+
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        g_spentindex = MakeUnique<SpentIndex>(nSpentIndexCache, false, fReindex);
+        g_spentindex->Start();
+    }
+
+    for (const auto& filter_type : g_enabled_filter_types) {
+        InitBlockFilterIndex(filter_type, nFilterIndexCache, false, fReindex);
+        GetBlockFilterIndex(filter_type)->Start();
+    }
+
     // ********************************************************* Step 9: load wallet
 
     for (const auto& client : interfaces.chain_clients) {
@@ -1826,6 +1954,8 @@ bool AppInitMain(InitInterfaces& interfaces)
         } else {
             return InitError(_("You must specify a masternodeprivkey in the configuration. Please see documentation for help."));
         }
+
+        coinJoinServer.SetMaxSessions(gArgs.GetArg("-coinjoinsessions", DEFAULT_COINJOIN_SESSIONS));
     }
 
     LogPrintf("Using masternode config file %s\n", GetConfigFile(gArgs.GetArg("-mnconf", MASTERNODE_CONF_FILENAME)).string());
@@ -1834,49 +1964,77 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     // ********************************************************* Step 11b: Load cache data
 
-    // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
+    // LOAD THE MODULE CACHE DATABASE AND SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
     if (!fLiteMode) {
-        g_analyzer = MakeUnique<CAnalyzer>();
-        uiInterface.InitMessage(_("Loading masternode cache..."));
-        CMNCacheDB mncachedb;
-        if(!mncachedb.Read(mnodeman)) {
-            LogPrintf("Invalid or missing mncache.dat; recreating\n");
-            mnodeman.Clear();
-            mncachedb.Write(mnodeman);
+        g_modulecachedb = MakeUnique<CModuleCacheDB>(MODULE_CACHE_DB_CACHE_SIZE);
+        // caches from before the module cache database are read from their dat files once
+        bool fMigrate = g_modulecachedb->IsEmpty();
+        if (fMigrate) {
+            LogPrintf("Module cache database is empty, reading dat files\n");
         }
-        mnodeman.CheckAndRemove();
-        if(mnodeman.size()) {
-            CMNPayDB mnpaydb;
-            if(!mnpaydb.Read(mnpayments)) {
-                LogPrintf("Invalid or missing mnpayments.dat; recreating\n");
-                mnpayments.Clear();
-                mnpaydb.Write(mnpayments);
+        // RPC reports this as the warmup status until all modules are loaded
+        uiInterface.InitMessage(_("Loading modules..."));
+        int64_t nStart = GetTimeMillis();
+
+        // Payments and funding need the masternode list, everything else loads alongside it
+        auto masternodesLoaded = std::async(std::launch::async, [fMigrate] {
+            LoadModuleCache("masternode", [fMigrate] {
+                CMNCacheDB mncachedb;
+                if(fMigrate ? !mncachedb.Read(mnodeman) : !g_modulecachedb->Read(mnodeman)) {
+                    LogPrintf("Invalid or missing masternode cache; recreating\n");
+                    mnodeman.Clear();
+                }
+                mnodeman.CheckAndRemove();
+            });
+            if(!mnodeman.size()) {
+                LogPrintf("Masternode cache is empty, skipping payments and funding cache\n");
+                return;
             }
-            mnpayments.CheckAndRemove();
-            CGovDB govdb;
-            if(!govdb.Read(funding)) {
-                LogPrintf("Invalid or missing funding.dat; recreating\n");
-                funding.Clear();
-                govdb.Write(funding);
+            auto paymentsLoaded = std::async(std::launch::async, [fMigrate] {
+                LoadModuleCache("masternode payments", [fMigrate] {
+                    CMNPayDB mnpaydb;
+                    if(fMigrate ? !mnpaydb.Read(mnpayments) : !g_modulecachedb->Read(mnpayments)) {
+                        LogPrintf("Invalid or missing masternode payments cache; recreating\n");
+                        mnpayments.Clear();
+                    }
+                    mnpayments.CheckAndRemove();
+                });
+            });
+            LoadModuleCache("funding", [fMigrate] {
+                CGovDB govdb;
+                if(fMigrate ? !govdb.Read(funding) : !g_modulecachedb->Read(funding)) {
+                    LogPrintf("Invalid or missing funding cache; recreating\n");
+                    funding.Clear();
+                }
+                funding.InitOnLoad();
+            });
+            paymentsLoaded.get();
+        });
+        auto netfulfilledLoaded = std::async(std::launch::async, [] {
+            LoadModuleCache("netfulfilled", [] {
+                CNetFulDB netfuldb;
+                if(!netfuldb.Read(netfulfilledman)) {
+                    LogPrintf("Invalid or missing netfulfilled.dat; recreating\n");
+                    netfuldb.Write(netfulfilledman);
+                }
+                netfulfilledman.CheckAndRemove();
+            });
+        });
+        netfulfilledLoaded.get();
+        masternodesLoaded.get();
+        LogPrintf("Modules loaded  %dms\n", GetTimeMillis() - nStart);
+
+        if (g_modulecachedb->Flush(mnodeman, mnpayments, funding) && fMigrate) {
+            // the dat files are not read again once the database holds their contents
+            for (const char* pszFile : {"mncache.dat", "mnpayments.dat", "funding.dat"}) {
+                try {
+                    fs::remove(GetDataDir() / pszFile);
+                } catch (const fs::filesystem_error& e) {
+                    LogPrintf("Unable to remove %s: %s\n", pszFile, fsbridge::get_filesystem_error_message(e));
+                }
             }
-            funding.InitOnLoad();
-        } else {
-            uiInterface.InitMessage(_("Masternode cache is empty, skipping payments and funding cache..."));
-        }
-        CNetFulDB netfuldb;
-        if(!netfuldb.Read(netfulfilledman)) {
-            LogPrintf("Invalid or missing netfulfilled.dat; recreating\n");
-            netfuldb.Write(netfulfilledman);
         }
-        netfulfilledman.CheckAndRemove();
-        uiInterface.InitMessage(_("Loading CoinJoin! cache..."));
-        CCoinJoinDB coinjoindb;
-        if(!coinjoindb.Read(*g_analyzer)) {
-            LogPrintf("Invalid or missing coinjoin.dat; recreating\n");
-            coinjoindb.Write(*g_analyzer);
-        }
-        g_analyzer->ReadCache();
     }
 
 
@@ -1889,6 +2047,12 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     // ********************************************************* Step 11d: schedule modules
 
+    if (!fLiteMode) {
+        // the message handler thread verifies masternode signatures too, as the script check master does
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadMasternodeSignatureCheck);
+    }
+
     activeMasternode.Controller(scheduler, g_connman.get());
     netfulfilledman.Controller(scheduler);
     mnodeman.Controller(scheduler, g_connman.get());
@@ -1896,6 +2060,12 @@ bool AppInitMain(InitInterfaces& interfaces)
     mnpayments.Controller(scheduler);
     funding.Controller(scheduler, g_connman.get());
 
+    if (!fLiteMode) {
+        scheduler.scheduleEvery([]{
+            g_modulecachedb->Flush(mnodeman, mnpayments, funding);
+        }, MODULE_CACHE_FLUSH_INTERVAL * 1000);
+    }
+
     if (ShutdownRequested()) {
         return false;
     }
@@ -1993,9 +2163,5 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL * 1000);
 
-    scheduler.scheduleEvery([]{
-        g_analyzer->Flush();
-    }, CJ_CLEAN_INTERVAL * 1000);
-
     return true;
 }
@@ -6,7 +6,7 @@
 
 #include <chain.h>
 #include <chainparams.h>
-#include <modules/coinjoin/coinjoin_analyzer.h>
+#include <index/coinjoinindex.h>
 #include <primitives/block.h>
 #include <sync.h>
 #include <txmempool.h>
@@ -186,9 +186,13 @@ public:
             fn(entry.GetSharedTx());
         }
     }
-    int analyzeCoin(const COutPoint& outpoint) override
+    int analyzeCoin(const COutPoint& outpoint, const CAmount& value) override
     {
-        return ::g_analyzer->AnalyzeCoin(outpoint);
+        int depth;
+        if (::g_coinjoinindex && ::g_coinjoinindex->LookupDepth(outpoint, value, depth)) {
+            return depth;
+        }
+        return 1;
     }
 };
 
@@ -145,8 +145,8 @@ public:
     //! removed transactions and already added new transactions.
     virtual void requestMempoolTransactions(std::function<void(const CTransactionRef&)> fn) = 0;
 
-    //! Recursively calculate the depth of obscuring a single outpoint.
-    virtual int analyzeCoin(const COutPoint& outpoint) = 0;
+    //! CoinJoin! depth of an output of the given value, -2 if it isn't denominated.
+    virtual int analyzeCoin(const COutPoint& outpoint, const CAmount& value) = 0;
 };
 
 //! Interface to let node manage chain clients (wallets, or maybe tools for
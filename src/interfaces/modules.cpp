@@ -13,8 +13,15 @@
 
 void ModuleInterface::InitializeCurrentBlockTip()
 {
-    LOCK(cs_main);
-    UpdatedBlockTip(chainActive.Tip(), nullptr, IsInitialBlockDownload());
+    const CBlockIndex* pindexTip;
+    bool fInitialDownload;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+        fInitialDownload = IsInitialBlockDownload();
+    }
+    // Called without cs_main, the modules may rescan blocks from disk
+    UpdatedBlockTip(pindexTip, nullptr, fInitialDownload);
 }
 
 void ModuleInterface::ProcessModuleMessage(CNode* pfrom, const NetMsgDest& dest, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
@@ -63,3 +70,17 @@ void ModuleInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlock
     funding.UpdatedBlockTip(pindexNew, fInitialDownload, connman);
 }
 
+
+void ModuleInterface::BlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *pindex, const std::vector<CTransactionRef> &txnConflicted)
+{
+    if (fLiteMode) return;
+
+    mnodeman.BlockConnected(*block, pindex);
+}
+
+void ModuleInterface::BlockDisconnected(const std::shared_ptr<const CBlock> &block)
+{
+    if (fLiteMode) return;
+
+    mnodeman.BlockDisconnected(*block);
+}
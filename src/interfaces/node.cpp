@@ -9,6 +9,7 @@
 #include <banman.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <index/coinjoinindex.h>
 #include <init.h>
 #include <interfaces/chain.h>
 #include <interfaces/handler.h>
@@ -19,7 +20,6 @@
 #include <modules/platform/funding.h>
 #include <modules/platform/funding_validators.h>
 #include <modules/coinjoin/coinjoin.h>
-#include <modules/coinjoin/coinjoin_analyzer.h>
 #include <net.h>
 #include <net_processing.h>
 #include <netaddress.h>
@@ -395,24 +395,14 @@ public:
     std::vector<Masternode> getMasternodes() override
     {
         std::vector<Masternode> result;
-        std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
-        for (const auto& mnpair : mapMasternodes)
+        std::shared_ptr<const std::map<COutPoint, CMasternode> > pmapMasternodes = mnodeman.GetFullMasternodeMap();
+        for (const auto& mnpair : *pmapMasternodes)
         {
-            CMasternode masternode = mnpair.second;
-            result.emplace_back(MakeMasternode(masternode));
+            result.emplace_back(MakeMasternode(mnpair.second));
         }
         for (const auto& mne : ::masternodeConfig.getEntries())
         {
-            bool fFound = false;
-            for (const auto& mnpair : mapMasternodes)
-            {
-                CMasternode masternode = mnpair.second;
-                if (masternode.outpoint == COutPoint(uint256S(mne.getTxHash()), atoi(mne.getOutputIndex())))
-                {
-                    fFound = true;
-                    break;
-                }
-            }
+            bool fFound = pmapMasternodes->count(COutPoint(uint256S(mne.getTxHash()), atoi(mne.getOutputIndex())));
             if (!fFound)
             {
                 Masternode mineMissing;
@@ -478,9 +468,13 @@ public:
     {
         return g_connman ? ::funding.VoteWithAll(hash, strVoteSignal, nResult, g_connman.get()) : false;
     }
-    int analyzeCoin(const COutPoint& outpoint) override
+    int analyzeCoin(const COutPoint& outpoint, const CAmount& value) override
     {
-        return ::g_analyzer->AnalyzeCoin(outpoint);
+        int depth;
+        if (::g_coinjoinindex && ::g_coinjoinindex->LookupDepth(outpoint, value, depth)) {
+            return depth;
+        }
+        return 1;
     }
     std::string getWalletDir() override
     {
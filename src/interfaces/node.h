@@ -193,8 +193,8 @@ public:
     //! Get unspent outputs associated with a transaction.
     virtual bool getUnspentOutput(const COutPoint& output, Coin& coin) = 0;
 
-    //! Recursively calculate the depth of obscuring a single outpoint.
-    virtual int analyzeCoin(const COutPoint& outpoint) = 0;
+    //! CoinJoin! depth of an output of the given value, -2 if it isn't denominated.
+    virtual int analyzeCoin(const COutPoint& outpoint, const CAmount& value) = 0;
 
     //! Module signals
     virtual std::string getModuleSyncStatus() = 0;
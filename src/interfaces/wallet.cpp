@@ -458,7 +458,14 @@ public:
     }
     int getCappedOutpointCoinJoinRounds(const COutPoint& outpoint) override
     {
-        return m_wallet->chain().analyzeCoin(outpoint);
+        CAmount value;
+        {
+            LOCK(m_wallet->cs_wallet);
+            const CWalletTx* wtx = m_wallet->GetWalletTx(outpoint.hash);
+            if (!wtx || outpoint.n >= wtx->tx->vout.size()) return -2;
+            value = wtx->tx->vout[outpoint.n].nValue;
+        }
+        return m_wallet->chain().analyzeCoin(outpoint, value);
     }
     CAmount getRequiredFee(unsigned int tx_bytes) override { return GetRequiredFee(*m_wallet, tx_bytes); }
     CAmount getMinimumFee(unsigned int tx_bytes,
@@ -2,13 +2,63 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
 #include <hash.h>
 #include <key_io.h>
+#include <random.h>
 #include <validation.h> // For strMessageMagic
 #include <messagesigner.h>
+#include <script/sigcache.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
+#include <boost/thread.hpp>
+
+namespace {
+/**
+ * Cache of hash signatures that verified. Masternode broadcasts and pings are checked again
+ * when they are relayed back to us, embedded in each other or recovered, and CMasternodeMan
+ * verifies batches of them in parallel before processing them one by one.
+ */
+class CHashSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || hash || public key || signature):
+    uint256 nonce;
+    CuckooCache::cache<uint256, SignatureCacheHasher> setValid;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    static const size_t CACHE_BYTES = 2 << 20;
+
+    CHashSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(CACHE_BYTES);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+};
+
+static CHashSignatureCache hashSignatureCache;
+} // namespace
+
 bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     keyRet = DecodeSecret(strSecret);
@@ -44,6 +94,12 @@ bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsi
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    uint256 entry;
+    hashSignatureCache.ComputeEntry(entry, hash, pubkey, vchSig);
+    if (hashSignatureCache.Get(entry)) {
+        return true;
+    }
+
     CPubKey pubkeyFromSig;
     if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
@@ -57,5 +113,6 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const st
         return false;
     }
 
+    hashSignatureCache.Set(entry);
     return true;
 }
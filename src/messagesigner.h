@@ -27,7 +27,7 @@ class CHashSigner
 public:
     /// Sign the hash, returns true if successful
     static bool SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet);
-    /// Verify the hash signature, returns true if succcessful
+    /// Verify the hash signature, returns true if succcessful. Valid signatures are cached.
     static bool VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
 };
 
@@ -17,6 +17,7 @@
 #include <util/system.h>
 #include <util/moneystr.h>
 
+#include <algorithm>
 #include <numeric>
 #include <string>
 
@@ -152,6 +153,16 @@ void CCoinJoinBaseManager::CheckQueue(int nHeight)
     }
 }
 
+void CCoinJoinBaseManager::RemoveQueue(const CCoinJoinQueue& queue)
+{
+    LOCK(cs_vecqueue);
+
+    auto it = std::find_if(vecCoinJoinQueue.begin(), vecCoinJoinQueue.end(), [&queue](const CCoinJoinQueue& q) {
+        return q.IsSameSession(queue);
+    });
+    if (it != vecCoinJoinQueue.end()) vecCoinJoinQueue.erase(it);
+}
+
 bool CCoinJoinBaseManager::GetQueueItem(CCoinJoinQueue& queueRet)
 {
     LOCK(cs_vecqueue);
@@ -33,7 +33,9 @@ static const int COINJOIN_ACCEPT_TIMEOUT         = 60;
 static const int COINJOIN_DEFAULT_TIMEOUT        = 4;
 
 //! minimum peer version accepted by mixing pool
-static const int MIN_COINJOIN_PEER_PROTO_VERSION            = 70017;
+static const int MIN_COINJOIN_PEER_PROTO_VERSION            = 70019;
+//! maximum number of queues a single masternode may have open at the same time
+static const int COINJOIN_MAX_SESSIONS                      = 16;
 //! maximum number of inputs on a single pool transaction
 static const size_t COINJOIN_ENTRY_MAX_SIZE                 = 135;
 //! number of denoms each size before new ones are created
@@ -147,6 +149,8 @@ public:
     COutPoint masternodeOutpoint;
     int nHeight;
     PoolStatusUpdate status;
+    // tells apart the queues of sessions a masternode runs with the same denomination
+    int nSessionID;
     std::vector<unsigned char> vchSig;
     // memory only
     bool fTried;
@@ -156,16 +160,18 @@ public:
         masternodeOutpoint(COutPoint()),
         nHeight(0),
         status(STATUS_CLOSED),
+        nSessionID(0),
         vchSig(std::vector<unsigned char>()),
         fTried(false)
     {
     }
 
-    CCoinJoinQueue(CAmount _nDenom, COutPoint _outpoint, int _nHeight, PoolStatusUpdate _status) :
+    CCoinJoinQueue(CAmount _nDenom, COutPoint _outpoint, int _nHeight, PoolStatusUpdate _status, int _nSessionID) :
         nDenom(_nDenom),
         masternodeOutpoint(_outpoint),
         nHeight(_nHeight),
         status(_status),
+        nSessionID(_nSessionID),
         vchSig(std::vector<unsigned char>()),
         fTried(false)
     {
@@ -182,6 +188,7 @@ public:
         READWRITE(nHeight);
         READWRITE(statusInt);
         status = static_cast<PoolStatusUpdate>(statusInt);
+        READWRITE(nSessionID);
         if (!(s.GetType() & SER_GETHASH)) {
             READWRITE(vchSig);
         }
@@ -208,17 +215,23 @@ public:
 
     std::string ToString() const
     {
-        return strprintf("nDenom=%d, nHeight=%lld, status=%d, fTried=%s, masternode=%s",
-            nDenom, nHeight, status, fTried ? "true" : "false", masternodeOutpoint.ToStringShort());
+        return strprintf("nDenom=%d, nHeight=%lld, status=%d, nSessionID=%d, fTried=%s, masternode=%s",
+            nDenom, nHeight, status, nSessionID, fTried ? "true" : "false", masternodeOutpoint.ToStringShort());
+    }
+
+    /// Was this queue announced for the same session as the other one, whatever its status?
+    bool IsSameSession(const CCoinJoinQueue& other) const
+    {
+        return masternodeOutpoint == other.masternodeOutpoint && nDenom == other.nDenom && nSessionID == other.nSessionID;
     }
 
     friend bool operator==(const CCoinJoinQueue& a, const CCoinJoinQueue& b)
     {
-        return a.masternodeOutpoint == b.masternodeOutpoint && a.status == b.status;
+        return a.IsSameSession(b) && a.status == b.status;
     }
     friend bool operator!=(const CCoinJoinQueue& a, const CCoinJoinQueue& b)
     {
-        return a.masternodeOutpoint == b.masternodeOutpoint && a.status != b.status;
+        return a.IsSameSession(b) && a.status != b.status;
     }
 };
 
@@ -334,6 +347,8 @@ protected:
 
     void SetNull();
     void CheckQueue(int nHeight);
+    /// Forget the queue of the session the given queue was announced for
+    void RemoveQueue(const CCoinJoinQueue& queue);
 
 public:
     CCoinJoinBaseManager() :
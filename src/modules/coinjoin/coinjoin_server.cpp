@@ -11,14 +11,19 @@
 #include <modules/masternode/masternode_man.h>
 #include <modules/masternode/masternode_payments.h>
 #include <netmessagemaker.h>
+#include <policy/policy.h>
 #include <scheduler.h>
 #include <script/interpreter.h>
 #include <shutdown.h>
 #include <txmempool.h>
 #include <util/system.h>
 #include <util/moneystr.h>
+#include <util/time.h>
+#include <validation.h>
 
+#include <algorithm>
 #include <numeric>
+#include <tuple>
 
 CCoinJoinServer coinJoinServer;
 
@@ -40,13 +45,6 @@ void CCoinJoinServer::ProcessModuleMessage(CNode* pfrom, const std::string& strC
         CAmount nDenom;
         vRecv >> nDenom;
 
-        if (IsSessionFull()) {
-            // too many users in this session already, reject new ones
-            LogPrintf("CJACCEPT -- queue is already full!\n");
-            PushStatus(pfrom, STATUS_REJECTED, ERR_QUEUE_FULL, connman);
-            return;
-        }
-
         LogPrint(BCLog::CJOIN, "CJACCEPT -- nDenom %d\n", FormatMoney(nDenom));
 
         masternode_info_t mnInfo;
@@ -55,32 +53,34 @@ void CCoinJoinServer::ProcessModuleMessage(CNode* pfrom, const std::string& strC
             return;
         }
 
-        if (vecDenom.empty()) {
-            LOCK(cs_vecqueue);
-            for (const auto& q : vecCoinJoinQueue) {
-                if (q.masternodeOutpoint == activeMasternode.outpoint) {
-                    // refuse to create another queue this often
-                    LogPrint(BCLog::CJOIN, "CJACCEPT -- last dsq is still in queue, refuse to mix\n");
-                    PushStatus(pfrom, STATUS_REJECTED, ERR_RECENT, connman);
-                    return;
-                }
-            }
+        LOCK(cs_sessions);
+        if (GetSessionForUser(pfrom->addr)) {
+            // every user takes part in one session at a time, that's how we tell their messages apart
+            LogPrintf("CJACCEPT -- %s is already in a session!\n", pfrom->addr.ToStringIPPort());
+            PushStatus(pfrom, STATUS_REJECTED, ERR_MODE, connman);
+            return;
+        }
+
+        CCoinJoinServerSession* session = GetSessionForDenom(nDenom);
+        if (!session && static_cast<int>(mapSessions.size()) >= nMaxSessions) {
+            // too many sessions running already, reject new ones
+            LogPrintf("CJACCEPT -- all %d sessions are busy!\n", nMaxSessions);
+            PushStatus(pfrom, STATUS_REJECTED, ERR_QUEUE_FULL, connman);
+            return;
         }
 
         PoolMessage nMessageID = MSG_NOERR;
 
-        bool fResult = nSessionID == 0  ? CreateNewSession(nDenom, nMessageID, connman)
-                                        : AddUserToExistingSession(nDenom, nMessageID);
+        bool fResult = session ? session->AddUserToExistingSession(nDenom, nMessageID)
+                               : (session = CreateNewSession(nDenom, nMessageID, connman)) != nullptr;
         if (fResult) {
             LogPrintf("CJACCEPT -- is compatible, please submit!\n");
-            PushStatus(pfrom, STATUS_ACCEPTED, nMessageID, connman);
-            vecDenom.push_back(std::make_pair(pfrom->addr, nDenom));
-            if (activeQueue.status > STATUS_OPEN) activeQueue.Push(pfrom->addr, connman);
-            CheckForCompleteQueue();
+            session->AddUser(pfrom, nDenom, nMessageID, connman);
         } else {
             LogPrintf("CJACCEPT -- not compatible with existing transactions!\n");
             PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
         }
+        RemoveFinishedSessions();
 
     } else if (strCommand == NetMsgType::CJQUEUE) {
 
@@ -101,6 +101,7 @@ void CCoinJoinServer::ProcessModuleMessage(CNode* pfrom, const std::string& strC
         LOCK(cs_vecqueue);
         // process every queue only once
         // status has changed, update and remove if closed
+        int nMasternodeQueues = 0;
         for (std::vector<CCoinJoinQueue>::iterator it = vecCoinJoinQueue.begin(); it!=vecCoinJoinQueue.end(); ++it) {
             if (*it == queue) {
                 LogPrint(BCLog::CJOIN, "CJQUEUE -- %s seen from %s\n", queue.ToString(), pfrom->addr.ToStringIPPort());
@@ -110,12 +111,16 @@ void CCoinJoinServer::ProcessModuleMessage(CNode* pfrom, const std::string& strC
                 if (queue.status > it->status) it->status = queue.status; // track unused queues so we can identify duplicates
                 if (queue.nHeight > it->nHeight) it->nHeight = queue.nHeight; // track unused queues so we can identify duplicates
             } else if (it->masternodeOutpoint == queue.masternodeOutpoint) {
-                // refuse to create another queue this often
-                LogPrint(BCLog::CJOIN, "CJQUEUE -- last request is still in queue, return.\n");
-                return;
+                nMasternodeQueues++;
             }
         }
 
+        if (nMasternodeQueues >= COINJOIN_MAX_SESSIONS) {
+            // refuse to create another queue this often
+            LogPrint(BCLog::CJOIN, "CJQUEUE -- last requests are still in queue, return.\n");
+            return;
+        }
+
         if (queue.status <= STATUS_OPEN) {
             LogPrint(BCLog::CJOIN, "CJQUEUE -- new CoinJoin queue (%s) from masternode %s\n", queue.ToString(), infoMn.addr.ToString());
             vecCoinJoinQueue.push_back(queue);
@@ -124,113 +129,390 @@ void CCoinJoinServer::ProcessModuleMessage(CNode* pfrom, const std::string& strC
 
     } else if (strCommand == NetMsgType::CJTXIN) {
 
-        if (!CheckSessionMessage(pfrom, connman)) return;
+        LOCK(cs_sessions);
+        CCoinJoinServerSession* session = GetSessionForUser(pfrom->addr);
+        if (!session) {
+            LogPrintf("CJTXIN -- no session for %s!\n", pfrom->addr.ToStringIPPort());
+            PushStatus(pfrom, STATUS_REJECTED, ERR_SESSION, connman);
+            return;
+        }
+
+        if (!session->CheckSessionMessage(pfrom, connman)) return;
 
         CCoinJoinEntry entry;
         vRecv >> entry;
         entry.addr = pfrom->addr;
 
-        CMutableTransaction mtx(*entry.psbtx.tx);
+        session->ProcessEntry(pfrom, entry, connman);
+        RemoveFinishedSessions();
 
-        LogPrint(BCLog::CJOIN, "CJTXIN -- from addr %s, vin size: %d, vout size: %d\n", entry.addr.ToStringIPPort(), mtx.vin.size(), mtx.vout.size());
+    } else if (strCommand == NetMsgType::CJSIGNFINALTX) {
 
-        if (mtx.vin.size() > COINJOIN_ENTRY_MAX_SIZE) {
-            LogPrintf("CJTXIN -- ERROR: too many inputs! %d/%d\n", mtx.vin.size(), COINJOIN_ENTRY_MAX_SIZE);
-            PushStatus(pfrom, STATUS_REJECTED, ERR_MAXIMUM, connman);
+        LOCK(cs_sessions);
+        CCoinJoinServerSession* session = GetSessionForUser(pfrom->addr);
+        if (!session) {
+            LogPrintf("CJSIGNFINALTX -- no session for %s!\n", pfrom->addr.ToStringIPPort());
+            PushStatus(pfrom, STATUS_REJECTED, ERR_SESSION, connman);
             return;
         }
 
-        if (mtx.vout.size() > COINJOIN_ENTRY_MAX_SIZE * 3) {
-            LogPrintf("CJTXIN -- ERROR: too many outputs! %d/%d\n", mtx.vout.size(), COINJOIN_ENTRY_MAX_SIZE);
-            PushStatus(pfrom, STATUS_REJECTED, ERR_MAXIMUM, connman);
-            return;
-        }
+        if (!session->CheckSessionMessage(pfrom, connman)) return;
 
-        CAmount nFee = 0;
-        CAmount nMNfee = 0;
-        PoolMessage nMessageID = MSG_NOERR;
+        PartiallySignedTransaction ptx(deserialize, vRecv);
 
-        if (!CheckTransaction(entry.psbtx, nFee, nMessageID, true)) {
-            LogPrintf("CJTXIN -- ERROR: CheckTransaction failed!\n");
-            PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
-            return;
-        }
+        LogPrint(BCLog::CJOIN, "CJSIGNFINALTX -- received transaction %s from %s\n", ptx.tx->GetHash().ToString(), pfrom->addr.ToStringIPPort());
 
-        //run the basic checks - there must be at least one input and one output matching our session
-        if (!IsCompatibleTxOut(mtx, nMNfee)) {
-            LogPrintf("CJTXIN -- not compatible with existing transactions!\n");
-            PushStatus(pfrom, STATUS_REJECTED, ERR_INVALID_OUT, connman);
-            return;
-        }
+        session->ProcessSignedFinalTransaction(ptx, connman);
+        RemoveFinishedSessions();
+    }
+}
 
-        if (nMNfee < nFee) {
-            LogPrintf("CJTXIN -- missing masternode fees!\n");
-            PushStatus(pfrom, STATUS_REJECTED, ERR_MN_FEES, connman);
-            return;
+void CCoinJoinServer::SetMaxSessions(int nMaxSessionsIn)
+{
+    LOCK(cs_sessions);
+    nMaxSessions = std::max(1, std::min(nMaxSessionsIn, COINJOIN_MAX_SESSIONS));
+}
+
+int CCoinJoinServer::GetSessionCount() const
+{
+    LOCK(cs_sessions);
+    return mapSessions.size();
+}
+
+int CCoinJoinServer::GetEntriesCount() const
+{
+    LOCK(cs_sessions);
+    int nEntries = 0;
+    for (const auto& pair : mapSessions) {
+        nEntries += pair.second.GetEntriesCount();
+    }
+    return nEntries;
+}
+
+std::string CCoinJoinServer::GetStateString() const
+{
+    LOCK(cs_sessions);
+    // report the session which got furthest
+    const CCoinJoinServerSession* pSession = nullptr;
+    for (const auto& pair : mapSessions) {
+        if (!pSession || pair.second.GetState() > pSession->GetState()) pSession = &pair.second;
+    }
+    return pSession ? pSession->GetStateString() : "IDLE";
+}
+
+CCoinJoinServerSession* CCoinJoinServer::CreateNewSession(const CAmount& nDenom, PoolMessage& nMessageIDRet, CConnman* connman)
+{
+    AssertLockHeld(cs_sessions);
+
+    if (!fMasternodeMode) return nullptr;
+
+    if (!CCoinJoin::IsInDenomRange(nDenom)) {
+        LogPrint(BCLog::CJOIN, "CCoinJoinServer::%s -- denom not valid!\n", __func__);
+        nMessageIDRet = ERR_DENOM;
+        return nullptr;
+    }
+
+    // start new session
+    int nSessionID;
+    do {
+        nSessionID = GetRandInt(999999)+1;
+    } while (std::any_of(mapSessions.begin(), mapSessions.end(), [nSessionID](const std::pair<const std::pair<CAmount, int>, CCoinJoinServerSession>& pair) {
+        return pair.first.second == nSessionID;
+    }));
+
+    CCoinJoinServerSession& session = mapSessions.emplace(std::piecewise_construct,
+        std::forward_as_tuple(nDenom, nSessionID), std::forward_as_tuple(nCachedBlockHeight)).first->second;
+
+    if (fUnitTest) {
+        session.Start(nSessionID, nDenom, CCoinJoinQueue());
+    } else {
+        //broadcast that I'm accepting entries, only if it's the first entry through
+        CCoinJoinQueue queue(nDenom, activeMasternode.outpoint, nCachedBlockHeight, STATUS_OPEN, nSessionID);
+        LogPrint(BCLog::CJOIN, "CCoinJoinServer::CreateNewSession -- signing and relaying new queue: %s\n", queue.ToString());
+        queue.Sign();
+        session.Start(nSessionID, nDenom, queue);
+        LOCK(cs_vecqueue);
+        vecCoinJoinQueue.push_back(queue);
+        queue.Relay(connman);
+    }
+
+    LogPrintf("CCoinJoinServer::CreateNewSession -- new session created, nSessionID: %d  nSessionDenom: %d (%s)  sessions: %d\n",
+            nSessionID, nDenom, CCoinJoin::GetDenominationsToString(nDenom), mapSessions.size());
+
+    nMessageIDRet = MSG_NOERR;
+    return &session;
+}
+
+CCoinJoinServerSession* CCoinJoinServer::GetSessionForUser(const CService& addr)
+{
+    AssertLockHeld(cs_sessions);
+
+    for (auto& pair : mapSessions) {
+        if (pair.second.HasUser(addr)) return &pair.second;
+    }
+    return nullptr;
+}
+
+CCoinJoinServerSession* CCoinJoinServer::GetSessionForDenom(const CAmount& nDenom)
+{
+    AssertLockHeld(cs_sessions);
+
+    auto fnCanJoin = [&nDenom](const CCoinJoinServerSession& session) {
+        // we only add new users to an existing session when we are in queue mode
+        if (session.GetState() != POOL_STATE_QUEUE && session.GetState() != POOL_STATE_ACCEPTING_ENTRIES) return false;
+        if (session.IsSessionFull()) return false;
+        return (session.nSessionDenom ^ nDenom) != (session.nSessionDenom | nDenom);
+    };
+
+    // sessions queued with this very denomination first
+    for (auto it = mapSessions.lower_bound(std::make_pair(nDenom, 0)); it != mapSessions.end() && it->first.first == nDenom; ++it) {
+        if (fnCanJoin(it->second)) return &it->second;
+    }
+    for (auto& pair : mapSessions) {
+        if (fnCanJoin(pair.second)) return &pair.second;
+    }
+    return nullptr;
+}
+
+void CCoinJoinServer::RemoveFinishedSessions()
+{
+    AssertLockHeld(cs_sessions);
+
+    for (auto it = mapSessions.begin(); it != mapSessions.end();) {
+        if (!it->second.IsFinished()) {
+            ++it;
+            continue;
         }
+        const CAmount nDenom = it->first.first;
+        const int nSessionID = it->first.second;
+        LogPrint(BCLog::CJOIN, "CCoinJoinServer::%s -- removing session %d (%s), sessions: %d\n",
+                __func__, nSessionID, CCoinJoin::GetDenominationsToString(nDenom), mapSessions.size() - 1);
+        // our queue for this session is of no use anymore, other sessions with this denomination keep theirs
+        RemoveQueue(CCoinJoinQueue(nDenom, activeMasternode.outpoint, 0, STATUS_CLOSED, nSessionID));
+        it = mapSessions.erase(it);
+    }
+}
 
-        if (AddEntry(entry, nMessageID)) {
-            PushStatus(pfrom, STATUS_ACCEPTED, nMessageID, connman);
-            RelayStatus(STATUS_ACCEPTED, connman);
-            CheckPool(connman);
-        } else {
-            PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
+void CCoinJoinServer::PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman* connman)
+{
+    if (!pnode) return;
+    CNetMsgMaker msgMaker(pnode->GetSendVersion());
+    connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CJSTATUSUPDATE, 0, (int)POOL_STATE_IDLE, 0, (int)nStatusUpdate, (int)nMessageID));
+}
+
+void CCoinJoinServer::SetNull()
+{
+    LOCK(cs_sessions);
+    for (auto& pair : mapSessions) {
+        pair.second.SetNull();
+    }
+    mapSessions.clear();
+    CCoinJoinBaseManager::SetNull();
+}
+
+//
+// Check for various timeouts (queue objects, mixing, etc)
+//
+void CCoinJoinServer::CheckTimeout(int nHeight)
+{
+    if (!fMasternodeMode) return;
+
+    CheckQueue(nHeight);
+
+    LOCK(cs_sessions);
+    for (auto& pair : mapSessions) {
+        pair.second.CheckTimeout();
+    }
+    RemoveFinishedSessions();
+}
+
+void CCoinJoinServer::UpdatedBlockTip(const CBlockIndex *pindexNew) {
+    if (ShutdownRequested()) return;
+    if (fLiteMode) return; // disable all specific functionality
+    if (!fMasternodeMode) return; // only run on masternodes
+
+    nCachedBlockHeight = pindexNew->nHeight;
+    LogPrint(BCLog::CJOIN, "CCoinJoinServer::UpdatedBlockTip -- nCachedBlockHeight: %d\n", nCachedBlockHeight);
+
+    if (!masternodeSync.IsBlockchainSynced())
+        return;
+
+    {
+        LOCK(cs_sessions);
+        for (auto& pair : mapSessions) {
+            pair.second.UpdatedBlockTip(nCachedBlockHeight, g_connman.get());
         }
+    }
+    CheckTimeout(nCachedBlockHeight);
+}
 
-    } else if (strCommand == NetMsgType::CJSIGNFINALTX) {
+bool CCoinJoinServerSession::HasUser(const CService& addr) const
+{
+    for (const auto& pair : vecDenom) {
+        if (pair.first == addr) return true;
+    }
+    return false;
+}
 
-        if (!CheckSessionMessage(pfrom, connman)) return;
+void CCoinJoinServerSession::Start(int nSessionIDIn, const CAmount& nDenom, const CCoinJoinQueue& queue)
+{
+    LOCK(cs_coinjoin);
+    nSessionID = nSessionIDIn;
+    nSessionDenom = nDenom;
+    activeQueue = queue;
+    SetState(POOL_STATE_QUEUE);
+}
 
-        PartiallySignedTransaction ptx(deserialize, vRecv);
+void CCoinJoinServerSession::AddUser(CNode* pnode, const CAmount& nDenom, PoolMessage nMessageID, CConnman* connman)
+{
+    PushStatus(pnode, STATUS_ACCEPTED, nMessageID, connman);
+    vecDenom.push_back(std::make_pair(pnode->addr, nDenom));
+    if (activeQueue.status > STATUS_OPEN) activeQueue.Push(pnode->addr, connman);
+    CheckForCompleteQueue();
+}
 
-        LogPrint(BCLog::CJOIN, "CJSIGNFINALTX -- received transaction %s from %s\n", ptx.tx->GetHash().ToString(), pfrom->addr.ToStringIPPort());
+void CCoinJoinServerSession::ProcessEntry(CNode* pfrom, CCoinJoinEntry& entry, CConnman* connman)
+{
+    CMutableTransaction mtx(*entry.psbtx.tx);
 
-        LOCK(cs_coinjoin);
-        // wrong transaction? just ignore it
-        if (finalPartiallySignedTransaction.tx->GetHash() != ptx.tx->GetHash()) return;
-        if (!finalPartiallySignedTransaction.Merge(ptx)) {
-            // notify everyone else that this session should be terminated
-            for (const auto& entry : vecEntries) {
-                connman->ForNode(entry.addr, [&connman, this](CNode* pnode) {
-                    PushStatus(pnode, STATUS_REJECTED, MSG_NOERR, connman);
-                    return true;
-                });
-            }
-            SetNull();
+    LogPrint(BCLog::CJOIN, "CJTXIN -- from addr %s, vin size: %d, vout size: %d, nSessionID: %d\n", entry.addr.ToStringIPPort(), mtx.vin.size(), mtx.vout.size(), nSessionID);
+
+    if (mtx.vin.size() > COINJOIN_ENTRY_MAX_SIZE) {
+        LogPrintf("CJTXIN -- ERROR: too many inputs! %d/%d\n", mtx.vin.size(), COINJOIN_ENTRY_MAX_SIZE);
+        PushStatus(pfrom, STATUS_REJECTED, ERR_MAXIMUM, connman);
+        return;
+    }
+
+    if (mtx.vout.size() > COINJOIN_ENTRY_MAX_SIZE * 3) {
+        LogPrintf("CJTXIN -- ERROR: too many outputs! %d/%d\n", mtx.vout.size(), COINJOIN_ENTRY_MAX_SIZE);
+        PushStatus(pfrom, STATUS_REJECTED, ERR_MAXIMUM, connman);
+        return;
+    }
+
+    CAmount nFee = 0;
+    CAmount nMNfee = 0;
+    PoolMessage nMessageID = MSG_NOERR;
+
+    if (!CheckTransaction(entry.psbtx, nFee, nMessageID, true)) {
+        LogPrintf("CJTXIN -- ERROR: CheckTransaction failed!\n");
+        PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
+        return;
+    }
+
+    //run the basic checks - there must be at least one input and one output matching our session
+    if (!IsCompatibleTxOut(mtx, nMNfee)) {
+        LogPrintf("CJTXIN -- not compatible with existing transactions!\n");
+        PushStatus(pfrom, STATUS_REJECTED, ERR_INVALID_OUT, connman);
+        return;
+    }
+
+    if (nMNfee < nFee) {
+        LogPrintf("CJTXIN -- missing masternode fees!\n");
+        PushStatus(pfrom, STATUS_REJECTED, ERR_MN_FEES, connman);
+        return;
+    }
+
+    if (AddEntry(entry, nMessageID)) {
+        PushStatus(pfrom, STATUS_ACCEPTED, nMessageID, connman);
+        RelayStatus(STATUS_ACCEPTED, connman);
+        CheckPool(connman);
+    } else {
+        PushStatus(pfrom, STATUS_REJECTED, nMessageID, connman);
+    }
+}
+
+void CCoinJoinServerSession::ProcessSignedFinalTransaction(const PartiallySignedTransaction& ptx, CConnman* connman)
+{
+    LOCK(cs_coinjoin);
+    // wrong transaction? just ignore it
+    if (finalPartiallySignedTransaction.tx->GetHash() != ptx.tx->GetHash()) return;
+    if (!finalPartiallySignedTransaction.Merge(ptx) || !CheckSignedInputs()) {
+        // notify everyone else that this session should be terminated
+        for (const auto& entry : vecEntries) {
+            connman->ForNode(entry.addr, [&connman, this](CNode* pnode) {
+                PushStatus(pnode, STATUS_REJECTED, MSG_NOERR, connman);
+                return true;
+            });
         }
-        // see if we are ready to submit
-        CAmount nFee = 0;
-        PoolMessage nMessageID = MSG_NOERR;
-        if (CheckTransaction(finalPartiallySignedTransaction, nFee, nMessageID, false)) {
-            CommitFinalTransaction(connman);
+        SetNull();
+        return;
+    }
+    // see if we are ready to submit
+    if (std::find(vecInputChecked.begin(), vecInputChecked.end(), false) != vecInputChecked.end()) return;
+    CAmount nFee = 0;
+    PoolMessage nMessageID = MSG_NOERR;
+    if (CheckTransaction(finalPartiallySignedTransaction, nFee, nMessageID, false)) {
+        CommitFinalTransaction(connman);
+    }
+}
+
+//
+// Verify the signatures as they come in on the script check threads, they end up in the
+// signature cache so AcceptToMemoryPool doesn't verify them again when committing
+//
+bool CCoinJoinServerSession::CheckSignedInputs()
+{
+    CMutableTransaction mtx(*finalPartiallySignedTransaction.tx);
+    std::vector<std::pair<unsigned int, CTxOut>> vInputs;
+
+    for (unsigned int i = 0; i < mtx.vin.size(); ++i) {
+        if (vecInputChecked[i]) continue;
+        PSBTInput& input = finalPartiallySignedTransaction.inputs[i];
+        if (!PSBTInputSigned(input) && !input.partial_sigs.empty()) {
+            // combine partial signatures into the final script if they are complete
+            SignPSBTInput(DUMMY_SIGNING_PROVIDER, finalPartiallySignedTransaction, i, SIGHASH_ALL);
         }
+        if (!PSBTInputSigned(input)) continue;
+        if (vecSpentOutputs[i].IsNull()) {
+            LogPrintf("CCoinJoinServerSession::CheckSignedInputs -- missing input %s\n", mtx.vin[i].prevout.ToString());
+            return false;
+        }
+        mtx.vin[i].scriptSig = input.final_script_sig;
+        mtx.vin[i].scriptWitness = input.final_script_witness;
+        vInputs.emplace_back(i, vecSpentOutputs[i]);
+    }
+
+    if (vInputs.empty()) return true;
+
+    int64_t nTimeStartCheck = GetTimeMicros();
+    const CTransaction tx(mtx);
+    if (!CheckInputScriptsParallel(tx, vInputs, STANDARD_SCRIPT_VERIFY_FLAGS)) {
+        LogPrintf("CCoinJoinServerSession::CheckSignedInputs -- invalid signature, nSessionID: %d\n", nSessionID);
+        return false;
     }
+    for (const auto& input : vInputs) {
+        vecInputChecked[input.first] = true;
+    }
+
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CheckSignedInputs -- verified %d inputs in %dus, nSessionID: %d\n",
+             vInputs.size(), GetTimeMicros() - nTimeStartCheck, nSessionID);
+    return true;
 }
 
-bool CCoinJoinServer::CheckSessionMessage(CNode* pfrom, CConnman* connman) {
+bool CCoinJoinServerSession::CheckSessionMessage(CNode* pfrom, CConnman* connman) {
 
     // make sure it's really our session
     if (activeQueue.status < STATUS_READY || activeQueue.status > STATUS_FULL) { // our queue but already closed
-        LogPrintf("CCoinJoinServer::CheckSessionMessage -- queue not ready or open!\n");
+        LogPrintf("CCoinJoinServerSession::CheckSessionMessage -- queue not ready or open!\n");
         PushStatus(pfrom, STATUS_REJECTED, ERR_SESSION, connman);
         return false;
     }
 
     //do we have enough users in the current session?
     if (!IsSessionReady()) {
-        LogPrintf("CCoinJoinServer::CheckSessionMessage -- session not ready!\n");
+        LogPrintf("CCoinJoinServerSession::CheckSessionMessage -- session not ready!\n");
         PushStatus(pfrom, STATUS_REJECTED, ERR_SESSION, connman);
         return false;
     }
     return true;
 }
 
-void CCoinJoinServer::UpdateQueue(PoolStatusUpdate update)
+void CCoinJoinServerSession::UpdateQueue(PoolStatusUpdate update)
 {
     if (activeQueue == CCoinJoinQueue()) return;
     if (activeQueue.IsExpired(nCachedBlockHeight)) return;
     if (activeQueue.status != update) {
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::UpdateQueue -- %s: %s new: %d\n", update == STATUS_CLOSED ? strprintf("closing") : strprintf("updating"), activeQueue.ToString(), update);
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::UpdateQueue -- %s: %s new: %d\n", update == STATUS_CLOSED ? strprintf("closing") : strprintf("updating"), activeQueue.ToString(), update);
         CConnman* connman = g_connman.get();
         activeQueue.nHeight = nCachedBlockHeight;
         activeQueue.status = update;
@@ -240,7 +522,7 @@ void CCoinJoinServer::UpdateQueue(PoolStatusUpdate update)
             for (std::vector<std::pair<CService, CAmount> >::iterator it = vecDenom.begin(); it != vecDenom.end(); ++it) {
                 if (!activeQueue.Push(it->first, connman)) {
                     // no such node? maybe this client disconnected or our own connection went down
-                    LogPrintf("CCoinJoinServer::%s -- client(s) disconnected, removing entry: %s nSessionID: %d  nSessionDenom: %d (%s, size: %d)\n",
+                    LogPrintf("CCoinJoinServerSession::%s -- client(s) disconnected, removing entry: %s nSessionID: %d  nSessionDenom: %d (%s, size: %d)\n",
                               __func__, it->first.ToStringIPPort(), nSessionID, nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom), vecDenom.size());
                     vecDenom.erase(it--);
                 }
@@ -254,26 +536,26 @@ void CCoinJoinServer::UpdateQueue(PoolStatusUpdate update)
     }
 }
 
-void CCoinJoinServer::SetNull()
+void CCoinJoinServerSession::SetNull()
 {
     // MN side
     UpdateQueue(STATUS_CLOSED);
     activeQueue = CCoinJoinQueue();
 
-    LOCK(cs_vecqueue);
     vecDenom.clear();
+    vecSpentOutputs.clear();
+    vecInputChecked.clear();
     CCoinJoinBaseSession::SetNull();
-    CCoinJoinBaseManager::SetNull();
 }
 
 //
 // Check the mixing progress and send client updates if a Masternode
 //
-void CCoinJoinServer::CheckPool(CConnman* connman)
+void CCoinJoinServerSession::CheckPool(CConnman* connman)
 {
     if (!fMasternodeMode) return;
 
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::CheckPool -- entries count %lu\n", GetEntriesCount());
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CheckPool -- nSessionID: %d  entries count %lu\n", nSessionID, GetEntriesCount());
 
     // If entries are full, create finalized transaction
     // wait a while for all to join, otherwise just go ahead
@@ -283,7 +565,7 @@ void CCoinJoinServer::CheckPool(CConnman* connman)
     if (GetState() == POOL_STATE_ACCEPTING_ENTRIES && fReady) {
         // close our queue
         UpdateQueue(STATUS_READY);
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::CheckPool -- FINALIZE TRANSACTIONS\n");
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CheckPool -- FINALIZE TRANSACTIONS\n");
         nTimeStart = GetTime();
         SetState(POOL_STATE_SIGNING);
         CreateFinalTransaction(connman);
@@ -296,16 +578,15 @@ void CCoinJoinServer::CheckPool(CConnman* connman)
 
 }
 
-void CCoinJoinServer::CreateFinalTransaction(CConnman* connman)
+void CCoinJoinServerSession::CreateFinalTransaction(CConnman* connman)
 {
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::CreateFinalTransaction -- FINALIZE TRANSACTIONS\n");
-
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CreateFinalTransaction -- FINALIZE TRANSACTIONS, nSessionID: %d\n", nSessionID);
     LOCK(cs_coinjoin);
     finalPartiallySignedTransaction = PartiallySignedTransaction();
     CMutableTransaction mtx;
 
     for (auto& entry : vecEntries) {
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::CreateFinalTransaction -- processing entry:%s\n", entry.addr.ToStringIPPort());
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CreateFinalTransaction -- processing entry:%s\n", entry.addr.ToStringIPPort());
         for (unsigned int i = 0; i < entry.psbtx.tx->vin.size(); ++i) {
             mtx.vin.push_back(entry.psbtx.tx->vin[i]);
             mtx.vin[i].scriptSig.clear();
@@ -345,8 +626,11 @@ void CCoinJoinServer::CreateFinalTransaction(CConnman* connman)
     }
 
     // Fill the inputs
+    vecSpentOutputs.clear();
+    vecInputChecked.assign(finalPartiallySignedTransaction.tx->vin.size(), false);
     for (unsigned int i = 0; i < finalPartiallySignedTransaction.tx->vin.size(); ++i) {
         PSBTInput& input = finalPartiallySignedTransaction.inputs.at(i);
+        vecSpentOutputs.push_back(view.AccessCoin(finalPartiallySignedTransaction.tx->vin[i].prevout).out);
 
         if (input.non_witness_utxo || !input.witness_utxo.IsNull()) {
             continue;
@@ -361,18 +645,18 @@ void CCoinJoinServer::CreateFinalTransaction(CConnman* connman)
         }
     }
 
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::CreateFinalTransaction -- finalPartiallySignedTransaction=%s\n",
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CreateFinalTransaction -- finalPartiallySignedTransaction=%s\n",
              finalPartiallySignedTransaction.tx->GetHash().ToString());
     RelayFinalTransaction(finalPartiallySignedTransaction, connman);
 }
 
-void CCoinJoinServer::CommitFinalTransaction(CConnman* connman)
+void CCoinJoinServerSession::CommitFinalTransaction(CConnman* connman)
 {
     if (!fMasternodeMode) return; // check and relay final tx only on masternode
 
     CMutableTransaction mtxFinal;
     if (!FinalizeAndExtractPSBT(finalPartiallySignedTransaction, mtxFinal)) {
-        LogPrintf("CCoinJoinServer::CommitFinalTransaction -- FinalizeAndExtractPSBT() error: Transaction not final\n");
+        LogPrintf("CCoinJoinServerSession::CommitFinalTransaction -- FinalizeAndExtractPSBT() error: Transaction not final\n");
         // not much we can do in this case, just notify clients
         RelayCompletedTransaction(ERR_INVALID_TX, connman);
         SetNull();
@@ -382,7 +666,7 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman* connman)
     CTransactionRef finalTransaction = MakeTransactionRef(mtxFinal);
     uint256 hashTx = finalTransaction->GetHash();
 
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::CommitFinalTransaction -- finalTransaction=%s\n", finalTransaction->ToString());
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- finalTransaction=%s\n", finalTransaction->ToString());
 
     CValidationState validationState;
 
@@ -391,7 +675,7 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman* connman)
         LOCK(cs_main);
         if (!AcceptToMemoryPool(mempool, validationState, finalTransaction, nullptr, nullptr, false, maxTxFee, false))
         {
-            LogPrintf("CCoinJoinServer::CommitFinalTransaction -- AcceptToMemoryPool() error: Transaction not valid\n");
+            LogPrintf("CCoinJoinServerSession::CommitFinalTransaction -- AcceptToMemoryPool() error: Transaction not valid\n");
             // not much we can do in this case, just notify clients
             RelayCompletedTransaction(ERR_INVALID_TX, connman);
             SetNull();
@@ -399,7 +683,7 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman* connman)
         }
     }
 
-    LogPrintf("CCoinJoinServer::CommitFinalTransaction -- TRANSMITTING PSBT\n");
+    LogPrintf("CCoinJoinServerSession::CommitFinalTransaction -- TRANSMITTING PSBT\n");
 
     CInv inv(MSG_TX, hashTx);
     connman->RelayInv(inv);
@@ -408,14 +692,14 @@ void CCoinJoinServer::CommitFinalTransaction(CConnman* connman)
     RelayCompletedTransaction(MSG_SUCCESS, connman);
 
     // Reset
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::CommitFinalTransaction -- COMPLETED -- RESETTING\n");
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- COMPLETED -- RESETTING\n");
     SetNull();
 }
 /*
 //
 // Ban clients a fee if they're abusive
 //
-void CCoinJoinServer::BanAbusive(CConnman* connman)
+void CCoinJoinServerSession::BanAbusive(CConnman* connman)
 {
     if (!fMasternodeMode) return;
 
@@ -485,21 +769,22 @@ void CCoinJoinServer::BanAbusive(CConnman* connman)
     }
 }
 */
+
+
 //
-// Check for various timeouts (queue objects, mixing, etc)
+// Check for various timeouts (signing, queue expiry)
 //
-void CCoinJoinServer::CheckTimeout(int nHeight)
+void CCoinJoinServerSession::CheckTimeout()
 {
     if (!fMasternodeMode) return;
 
-    CheckQueue(nHeight);
     if (activeQueue.IsExpired(nCachedBlockHeight)) {
-        LogPrintf("CCoinJoinServer::CheckTimeout -- Queue expired -- resetting\n");
+        LogPrintf("CCoinJoinServerSession::CheckTimeout -- Queue expired, nSessionID: %d -- resetting\n", nSessionID);
         SetNull();
     }
 
     if (GetState() == POOL_STATE_SIGNING && GetTime() - nTimeStart >= COINJOIN_SIGNING_TIMEOUT) {
-        LogPrintf("CCoinJoinServer::CheckTimeout -- Signing timed out (%ds) -- resetting\n", COINJOIN_SIGNING_TIMEOUT);
+        LogPrintf("CCoinJoinServerSession::CheckTimeout -- Signing timed out (%ds), nSessionID: %d -- resetting\n", COINJOIN_SIGNING_TIMEOUT, nSessionID);
         // BanAbusive(connman);
         SetNull();
     }
@@ -510,7 +795,7 @@ void CCoinJoinServer::CheckTimeout(int nHeight)
     After receiving multiple cja messages, the queue will switch to "accepting entries"
     which is the active state right before merging the transaction
 */
-void CCoinJoinServer::CheckForCompleteQueue()
+void CCoinJoinServerSession::CheckForCompleteQueue()
 {
     if (!fMasternodeMode) return;
 
@@ -518,7 +803,7 @@ void CCoinJoinServer::CheckForCompleteQueue()
         nTimeStart = GetTime();
         SetState(POOL_STATE_ACCEPTING_ENTRIES);
         UpdateQueue(IsSessionFull() ? STATUS_FULL : STATUS_READY);
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::CheckForCompleteQueue -- queue is ready, updating and relaying...\n");
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::CheckForCompleteQueue -- queue is ready, updating and relaying...\n");
         return;
     }
 }
@@ -526,12 +811,12 @@ void CCoinJoinServer::CheckForCompleteQueue()
 //
 // Add a clients transaction to the pool
 //
-bool CCoinJoinServer::AddEntry(const CCoinJoinEntry& entryNew, PoolMessage& nMessageIDRet)
+bool CCoinJoinServerSession::AddEntry(const CCoinJoinEntry& entryNew, PoolMessage& nMessageIDRet)
 {
     if (!fMasternodeMode) return false;
 
     if (static_cast<unsigned int>(GetEntriesCount()) >= CCoinJoin::GetMaxPoolInputs() || GetState() != POOL_STATE_ACCEPTING_ENTRIES) {
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::AddEntry -- entries is full!\n");
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::AddEntry -- entries is full!\n");
         nMessageIDRet = ERR_ENTRIES_FULL;
         return false;
     }
@@ -539,7 +824,7 @@ bool CCoinJoinServer::AddEntry(const CCoinJoinEntry& entryNew, PoolMessage& nMes
     LOCK(cs_coinjoin);
     for (const auto& entry : vecEntries) {
         if (entry == entryNew) {
-            LogPrint(BCLog::CJOIN, "CCoinJoinServer::AddEntry -- adding entry\n");
+            LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::AddEntry -- adding entry\n");
             nMessageIDRet = ERR_ALREADY_HAVE;
             return false;
         }
@@ -547,25 +832,25 @@ bool CCoinJoinServer::AddEntry(const CCoinJoinEntry& entryNew, PoolMessage& nMes
 
     vecEntries.push_back(entryNew);
 
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::AddEntry -- adding entry\n");
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::AddEntry -- adding entry\n");
     nMessageIDRet = MSG_ENTRIES_ADDED;
 
     return true;
 }
 
-bool CCoinJoinServer::IsCompatibleTxOut(const CMutableTransaction mtx, CAmount& nMNfee)
+bool CCoinJoinServerSession::IsCompatibleTxOut(const CMutableTransaction mtx, CAmount& nMNfee)
 {
     CScript payee;
 
     if (mnpayments.GetBlockPayee(mtx.nLockTime, payee)) {
         CTxDestination address;
         ExtractDestination(payee, address);
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::IsCompatibleTxOut --- found masternode payee = %s\n", EncodeDestination(address));
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::IsCompatibleTxOut --- found masternode payee = %s\n", EncodeDestination(address));
     }
 
     for (const auto& entry : mtx.vout) {
         if (!CCoinJoin::IsDenominatedAmount(entry.nValue)) {
-            LogPrintf("CCoinJoinServer::IsCompatibleTxOut --- ERROR: non-denom output = %d\n", entry.nValue);
+            LogPrintf("CCoinJoinServerSession::IsCompatibleTxOut --- ERROR: non-denom output = %d\n", entry.nValue);
             return false;
         }
         if (entry.scriptPubKey == payee) nMNfee += entry.nValue;
@@ -574,50 +859,7 @@ bool CCoinJoinServer::IsCompatibleTxOut(const CMutableTransaction mtx, CAmount&
     return true;
 }
 
-bool CCoinJoinServer::CreateNewSession(const CAmount& nDenom, PoolMessage& nMessageIDRet, CConnman* connman)
-{
-    if (!fMasternodeMode || nSessionID != 0) return false;
-
-    LOCK(cs_coinjoin);
-
-    // new session can only be started in idle mode
-    if (GetState() != POOL_STATE_IDLE) {
-        nMessageIDRet = ERR_MODE;
-        LogPrintf("CCoinJoinServer::CreateNewSession -- incompatible mode: nState=%d\n", GetStateString());
-        return false;
-    }
-
-    if (!CCoinJoin::IsInDenomRange(nDenom)) {
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::%s -- denom not valid!\n", __func__);
-        nMessageIDRet = ERR_DENOM;
-        return false;
-    }
-
-    // start new session
-    nMessageIDRet = MSG_NOERR;
-    nSessionID = GetRandInt(999999)+1;
-    nSessionDenom = nDenom;
-
-    SetState(POOL_STATE_QUEUE);
-
-    if (!fUnitTest) {
-        //broadcast that I'm accepting entries, only if it's the first entry through
-        CCoinJoinQueue queue(nDenom, activeMasternode.outpoint, nCachedBlockHeight, STATUS_OPEN);
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::CreateNewSession -- signing and relaying new queue: %s\n", queue.ToString());
-        queue.Sign();
-        activeQueue = queue;
-        LOCK(cs_vecqueue);
-        vecCoinJoinQueue.push_back(queue);
-        queue.Relay(connman);
-    }
-
-    LogPrintf("CCoinJoinServer::CreateNewSession -- new session created, nSessionID: %d  nSessionDenom: %d (%s)  vecDenom.size(): %d\n",
-            nSessionID, nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom), vecDenom.size());
-
-    return true;
-}
-
-bool CCoinJoinServer::AddUserToExistingSession(const CAmount& nDenom, PoolMessage& nMessageIDRet)
+bool CCoinJoinServerSession::AddUserToExistingSession(const CAmount& nDenom, PoolMessage& nMessageIDRet)
 {
     if (!fMasternodeMode || nSessionID == 0) return false;
 
@@ -626,18 +868,18 @@ bool CCoinJoinServer::AddUserToExistingSession(const CAmount& nDenom, PoolMessag
     // we only add new users to an existing session when we are in queue mode
     if (GetState() != POOL_STATE_QUEUE && GetState() != POOL_STATE_ACCEPTING_ENTRIES) {
         nMessageIDRet = ERR_MODE;
-        LogPrintf("CCoinJoinServer::AddUserToExistingSession -- incompatible mode: nState=%d\n", GetStateString());
+        LogPrintf("CCoinJoinServerSession::AddUserToExistingSession -- incompatible mode: nState=%d\n", GetStateString());
         return false;
     }
 
     if (!CCoinJoin::IsInDenomRange(nDenom)) {
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::%s -- denom not valid!\n", __func__);
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::%s -- denom not valid!\n", __func__);
         nMessageIDRet = ERR_DENOM;
         return false;
     }
 
     if ((nSessionDenom ^ nDenom) == (nSessionDenom | nDenom)) {
-        LogPrintf("CCoinJoinServer::AddUserToExistingSession -- incompatible denom %d (%s) != nSessionDenom %d (%s)\n",
+        LogPrintf("CCoinJoinServerSession::AddUserToExistingSession -- incompatible denom %d (%s) != nSessionDenom %d (%s)\n",
                     nDenom, CCoinJoin::GetDenominationsToString(nDenom), nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom));
         nMessageIDRet = ERR_DENOM;
         return false;
@@ -648,15 +890,15 @@ bool CCoinJoinServer::AddUserToExistingSession(const CAmount& nDenom, PoolMessag
     nMessageIDRet = MSG_NOERR;
     nSessionDenom |= nDenom;
 
-    LogPrintf("CCoinJoinServer::AddUserToExistingSession -- new user accepted, nSessionID: %d  nSessionDenom: %d (%s)  vecDenom.size(): %d\n",
+    LogPrintf("CCoinJoinServerSession::AddUserToExistingSession -- new user accepted, nSessionID: %d  nSessionDenom: %d (%s)  vecDenom.size(): %d\n",
             nSessionID, nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom), vecDenom.size());
 
     return true;
 }
 
-void CCoinJoinServer::RelayFinalTransaction(const PartiallySignedTransaction& txFinal, CConnman* connman)
+void CCoinJoinServerSession::RelayFinalTransaction(const PartiallySignedTransaction& txFinal, CConnman* connman)
 {
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
             __func__, nSessionID, nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom));
 
     CCoinJoinBroadcastTx finalTx(nSessionID, txFinal, activeMasternode.outpoint, GetAdjustedTime());
@@ -672,7 +914,7 @@ void CCoinJoinServer::RelayFinalTransaction(const PartiallySignedTransaction& tx
         });
         if (!fOk) {
             // no such node? maybe this client disconnected or our own connection went down
-            LogPrintf("CCoinJoinServer::%s -- client(s) disconnected, removing entry: %s nSessionID: %d  nSessionDenom: %d (%s)\n",
+            LogPrintf("CCoinJoinServerSession::%s -- client(s) disconnected, removing entry: %s nSessionID: %d  nSessionDenom: %d (%s)\n",
                     __func__, it->addr.ToStringIPPort(), nSessionID, nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom));
             vecEntries.erase(it--);
             allOK = false;
@@ -684,14 +926,14 @@ void CCoinJoinServer::RelayFinalTransaction(const PartiallySignedTransaction& tx
     } else SetNull();
 }
 
-void CCoinJoinServer::PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman* connman)
+void CCoinJoinServerSession::PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman* connman)
 {
     if (!pnode) return;
     CNetMsgMaker msgMaker(pnode->GetSendVersion());
     connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CJSTATUSUPDATE, nSessionID, (int)nState, (int)vecEntries.size(), (int)nStatusUpdate, (int)nMessageID));
 }
 
-void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman* connman, PoolMessage nMessageID)
+void CCoinJoinServerSession::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman* connman, PoolMessage nMessageID)
 {
     // status updates should be relayed to mixing participants only
     for (std::vector<CCoinJoinEntry>::iterator it = vecEntries.begin(); it != vecEntries.end(); ++it) {
@@ -702,7 +944,7 @@ void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman* conn
         });
         if (!fOk) {
             // no such node? maybe this client disconnected or our own connection went down
-            LogPrintf("CCoinJoinServer::%s -- client(s) disconnected, removing entry: %s nSessionID: %d  nSessionDenom: %d (%s), size: %d\n",
+            LogPrintf("CCoinJoinServerSession::%s -- client(s) disconnected, removing entry: %s nSessionID: %d  nSessionDenom: %d (%s), size: %d\n",
                     __func__, it->addr.ToStringIPPort(), nSessionID, nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom), vecEntries.size());
             vecEntries.erase(it--);
         }
@@ -715,9 +957,9 @@ void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman* conn
     }
 }
 
-void CCoinJoinServer::RelayCompletedTransaction(PoolMessage nMessageID, CConnman* connman)
+void CCoinJoinServerSession::RelayCompletedTransaction(PoolMessage nMessageID, CConnman* connman)
 {
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
             __func__, nSessionID, nSessionDenom, CCoinJoin::GetDenominationsToString(nSessionDenom));
 
     // final mixing tx with empty signatures should be relayed to mixing participants only
@@ -730,31 +972,23 @@ void CCoinJoinServer::RelayCompletedTransaction(PoolMessage nMessageID, CConnman
     }
 }
 
-void CCoinJoinServer::SetState(PoolState nStateNew)
+void CCoinJoinServerSession::SetState(PoolState nStateNew)
 {
     if (!fMasternodeMode) return;
 
     if (nStateNew == POOL_STATE_ERROR || nStateNew == POOL_STATE_SUCCESS) {
-        LogPrint(BCLog::CJOIN, "CCoinJoinServer::SetState -- Can't set state to ERROR or SUCCESS as a Masternode. \n");
+        LogPrint(BCLog::CJOIN, "CCoinJoinServerSession::SetState -- Can't set state to ERROR or SUCCESS as a Masternode. \n");
         return;
     }
 
-    LogPrintf("CCoinJoinServer::SetState -- nState: %d, nStateNew: %d\n", GetStateString(), nStateNew);
+    LogPrintf("CCoinJoinServerSession::SetState -- nState: %d, nStateNew: %d\n", GetStateString(), nStateNew);
     nState = nStateNew;
 }
 
-void CCoinJoinServer::UpdatedBlockTip(const CBlockIndex *pindexNew) {
-    if (ShutdownRequested()) return;
-    if (fLiteMode) return; // disable all specific functionality
-    if (!fMasternodeMode) return; // only run on masternodes
-
-    nCachedBlockHeight = pindexNew->nHeight;
-    LogPrint(BCLog::CJOIN, "CCoinJoinServer::UpdatedBlockTip -- nCachedBlockHeight: %d\n", nCachedBlockHeight);
-
-    if (!masternodeSync.IsBlockchainSynced())
-        return;
+void CCoinJoinServerSession::UpdatedBlockTip(int nHeight, CConnman* connman)
+{
+    nCachedBlockHeight = nHeight;
 
     if (GetState() == POOL_STATE_QUEUE) CheckForCompleteQueue();
-    if (GetState() == POOL_STATE_ACCEPTING_ENTRIES) CheckPool(g_connman.get());
-    CheckTimeout(nCachedBlockHeight);
+    if (GetState() == POOL_STATE_ACCEPTING_ENTRIES) CheckPool(connman);
 }
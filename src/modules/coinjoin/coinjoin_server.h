@@ -8,72 +8,135 @@
 #include <net.h>
 #include <modules/coinjoin/coinjoin.h>
 
+#include <map>
+
 class CCoinJoinServer;
 
+//! default number of mixing sessions a masternode runs at the same time
+static const int DEFAULT_COINJOIN_SESSIONS = 4;
+
 // The main object for accessing mixing
 extern CCoinJoinServer coinJoinServer;
 
-/** Used to keep track of current status of mixing pool
+/** A single mixing pool run by this masternode
  */
-class CCoinJoinServer : public CCoinJoinBaseSession, public CCoinJoinBaseManager
+class CCoinJoinServerSession : public CCoinJoinBaseSession
 {
 private:
     std::vector<std::pair<CService, CAmount> > vecDenom;
     CCoinJoinQueue activeQueue;
 
-    bool fUnitTest;
+    // Outputs spent by the final transaction and which of its inputs had their signatures verified
+    std::vector<CTxOut> vecSpentOutputs;
+    std::vector<bool> vecInputChecked;
 
     // Keep track of current block height
     int nCachedBlockHeight;
 
-    /// Add a clients entry to the pool
-    bool AddEntry(const CCoinJoinEntry& entryNew, PoolMessage& nMessageIDRet);
-
-    /// Charge fees to bad actors (Charge clients a fee if they're abusive)
-    // void BanAbusive(CConnman* connman);
-
     /// Check for process
     void CheckPool(CConnman* connman);
 
-    /// Check Session
-    bool CheckSessionMessage(CNode* pnode, CConnman* connman);
-
     void CreateFinalTransaction(CConnman* connman);
+    /// Verify the inputs of the final transaction signed since the last call
+    bool CheckSignedInputs();
     void CommitFinalTransaction(CConnman* connman);
 
-    bool CreateNewSession(const CAmount& nDenom, PoolMessage &nMessageIDRet, CConnman* connman);
-    bool AddUserToExistingSession(const CAmount& nDenom, PoolMessage &nMessageIDRet);
-    /// Do we have enough users to take entries?
-    bool IsSessionReady() { return vecDenom.size() >= CCoinJoin::GetMinPoolInputs(); }
-    bool IsSessionClosed() { return vecDenom.size() >= CCoinJoin::GetMaxPoolInputs() - 1; }
-    bool IsSessionFull() { return vecDenom.size() >= CCoinJoin::GetMaxPoolInputs(); }
-
-    /// Are these outputs compatible with other client in the pool?
-    bool IsCompatibleTxOut(const CMutableTransaction mtx, CAmount& nMNfee);
-
     // Set the 'state' value, with some logging and capturing when the state changed
     void SetState(PoolState nStateNew);
 
     /// Relay mixing Messages
     void RelayFinalTransaction(const PartiallySignedTransaction &txFinal, CConnman* connman);
-    void PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman* connman);
     void RelayStatus(PoolStatusUpdate nStatusUpdate, CConnman* connman, PoolMessage nMessageID = MSG_NOERR);
     void RelayCompletedTransaction(PoolMessage nMessageID, CConnman* connman);
 
     void UpdateQueue(PoolStatusUpdate update);
-    void SetNull();
 
 public:
-    CCoinJoinServer() :
+    explicit CCoinJoinServerSession(int nHeight) :
         vecDenom(),
         activeQueue(),
+        vecSpentOutputs(),
+        vecInputChecked(),
+        nCachedBlockHeight(nHeight)
+        {}
+
+    /// Has this session been completed or reset?
+    bool IsFinished() const { return nSessionID == 0; }
+    bool HasUser(const CService& addr) const;
+
+    /// Do we have enough users to take entries?
+    bool IsSessionReady() const { return vecDenom.size() >= CCoinJoin::GetMinPoolInputs(); }
+    bool IsSessionClosed() const { return vecDenom.size() >= CCoinJoin::GetMaxPoolInputs() - 1; }
+    bool IsSessionFull() const { return vecDenom.size() >= CCoinJoin::GetMaxPoolInputs(); }
+
+    void Start(int nSessionIDIn, const CAmount& nDenom, const CCoinJoinQueue& queue);
+    bool AddUserToExistingSession(const CAmount& nDenom, PoolMessage &nMessageIDRet);
+    void AddUser(CNode* pnode, const CAmount& nDenom, PoolMessage nMessageID, CConnman* connman);
+
+    /// Check Session
+    bool CheckSessionMessage(CNode* pnode, CConnman* connman);
+    /// Add a clients entry to the pool
+    bool AddEntry(const CCoinJoinEntry& entryNew, PoolMessage& nMessageIDRet);
+    void ProcessEntry(CNode* pfrom, CCoinJoinEntry& entry, CConnman* connman);
+    void ProcessSignedFinalTransaction(const PartiallySignedTransaction& ptx, CConnman* connman);
+
+    /// Are these outputs compatible with other client in the pool?
+    bool IsCompatibleTxOut(const CMutableTransaction mtx, CAmount& nMNfee);
+
+    void PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman* connman);
+
+    void CheckTimeout();
+    void CheckForCompleteQueue();
+    void UpdatedBlockTip(int nHeight, CConnman* connman);
+    void SetNull();
+};
+
+/** Keeps track of all mixing pools of this masternode, several of them can run at the same time
+ */
+class CCoinJoinServer : public CCoinJoinBaseManager
+{
+private:
+    mutable CCriticalSection cs_sessions;
+
+    // Sessions in progress, keyed by their queue denomination and session id
+    std::map<std::pair<CAmount, int>, CCoinJoinServerSession> mapSessions GUARDED_BY(cs_sessions);
+
+    int nMaxSessions;
+
+    bool fUnitTest;
+
+    // Keep track of current block height
+    int nCachedBlockHeight;
+
+    CCoinJoinServerSession* CreateNewSession(const CAmount& nDenom, PoolMessage &nMessageIDRet, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
+    /// Session this user was accepted to, if any
+    CCoinJoinServerSession* GetSessionForUser(const CService& addr) EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
+    /// Session still taking users a new user with this denomination can join, if any
+    CCoinJoinServerSession* GetSessionForDenom(const CAmount& nDenom) EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
+    /// Drop completed and reset sessions together with their queues
+    void RemoveFinishedSessions() EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
+
+    /// Status update for users that are not part of any session
+    void PushStatus(CNode* pnode, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID, CConnman* connman);
+
+    void SetNull();
+
+public:
+    CCoinJoinServer() :
+        mapSessions(),
+        nMaxSessions(DEFAULT_COINJOIN_SESSIONS),
         fUnitTest(false),
         nCachedBlockHeight(0)
         { SetNull(); }
 
+    void SetMaxSessions(int nMaxSessionsIn);
+
+    int GetSessionCount() const;
+    int GetEntriesCount() const;
+    std::string GetStateString() const;
+
     void ProcessModuleMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
     void CheckTimeout(int nHeight);
-    void CheckForCompleteQueue();
     void UpdatedBlockTip(const CBlockIndex *pindexNew);
 };
 
@@ -5,6 +5,7 @@
 #include <modules/masternode/masternode_man.h>
 
 #include <addrman.h>
+#include <checkqueue.h>
 #include <clientversion.h>
 #include <init.h>
 #include <interfaces/chain.h>
@@ -28,17 +29,7 @@
 /** Masternode manager */
 CMasternodeMan mnodeman;
 
-const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-7";
-const int CMasternodeMan::LAST_PAID_SCAN_BLOCKS = 100;
-
-struct CompareLastPaidBlock
-{
-    bool operator()(const std::pair<int, const CMasternode*>& t1,
-                    const std::pair<int, const CMasternode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->outpoint < t2.second->outpoint);
-    }
-};
+const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-8";
 
 struct CompareScoreMN
 {
@@ -62,6 +53,11 @@ struct CompareByAddr
 CMasternodeMan::CMasternodeMan():
     cs(),
     mapMasternodes(),
+    pmapMasternodesSnapshot(),
+    nSnapshotTime(0),
+    fSnapshotStale(true),
+    setCacheDirtyMasternodes(),
+    fCacheStateDirty(false),
     mAskedUsForMasternodeList(),
     mWeAskedForMasternodeList(),
     mWeAskedForMasternodeListEntry(),
@@ -73,8 +69,18 @@ CMasternodeMan::CMasternodeMan():
     fMasternodesRemoved(false),
     vecDirtyGovernanceObjectHashes(),
     nLastSentinelPingTime(0),
+    mapPayeeLastPaid(),
+    hashLastPaidBlock(),
+    nLastPaidHeight(0),
+    fLastPaidVotesSynced(false),
+    listRankCache(),
+    setPaymentQueue(),
+    mapCollateralHeight(),
+    cs_mapSeenMessages(),
     mapSeenMasternodeBroadcast(),
-    mapSeenMasternodePing()
+    mapSeenMasternodePing(),
+    vecPendingMessages(),
+    nPendingMessagesTime(0)
 {}
 
 bool CMasternodeMan::Add(CMasternode &mn)
@@ -85,7 +91,16 @@ bool CMasternodeMan::Add(CMasternode &mn)
 
     LogPrint(BCLog::MNODE, "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     uiInterface.NotifyMasternodeChanged(mn.outpoint, CT_NEW);
-    mapMasternodes[mn.outpoint] = mn;
+    CMasternode& mnNew = mapMasternodes[mn.outpoint] = mn;
+    auto it = mapPayeeLastPaid.find(GetScriptForDestination(mn.collDest));
+    if (it != mapPayeeLastPaid.end()) {
+        mnNew.nBlockLastPaid = it->second.back().first;
+        mnNew.nTimeLastPaid = it->second.back().second;
+    }
+    setPaymentQueue.emplace(mnNew.nBlockLastPaid, mnNew.outpoint);
+    RankCacheAdd(mnNew);
+    setCacheDirtyMasternodes.insert(mn.outpoint);
+    fSnapshotStale = true;
     fMasternodesAdded = true;
     return true;
 }
@@ -117,6 +132,7 @@ void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman*
         LogPrintf("CMasternodeMan::AskForMN -- Asking peer %s for missing masternode entry for the first time: %s\n", addrSquashed.ToString(), outpoint.ToStringShort());
     }
     mWeAskedForMasternodeListEntry[outpoint][addrSquashed] = GetTime() + DSEG_UPDATE_SECONDS;
+    fCacheStateDirty = true;
 
     connman->PushMessage(pnode, msgMaker.Make(NetMsgType::DSEG, outpoint));
 }
@@ -129,6 +145,7 @@ bool CMasternodeMan::PoSeBan(const COutPoint &outpoint)
         return false;
     }
     pmn->PoSeBan();
+    setCacheDirtyMasternodes.insert(outpoint);
 
     return true;
 }
@@ -142,7 +159,21 @@ void CMasternodeMan::Check()
     for (auto& mnpair : mapMasternodes) {
         // NOTE: internally it checks only every MASTERNODE_CHECK_SECONDS seconds
         // since the last time, so expect some MNs to skip this
-        mnpair.second.Check();
+        CheckMasternode(mnpair.second);
+    }
+}
+
+void CMasternodeMan::CheckMasternode(CMasternode& mn, bool fForce)
+{
+    AssertLockHeld(cs);
+
+    int nActiveStatePrev = mn.nActiveState;
+    int nPoSeBanScorePrev = mn.nPoSeBanScore;
+    int nPoSeBanHeightPrev = mn.nPoSeBanHeight;
+    mn.Check(fForce);
+    // the time of the check alone is not worth a write, it is only used to space out checks
+    if (mn.nActiveState != nActiveStatePrev || mn.nPoSeBanScore != nPoSeBanScorePrev || mn.nPoSeBanHeight != nPoSeBanHeightPrev) {
+        setCacheDirtyMasternodes.insert(mn.outpoint);
     }
 }
 
@@ -172,13 +203,18 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
                 LogPrint(BCLog::MNODE, "CMasternodeMan::CheckAndRemove -- Removing Masternode: %s  addr=%s  %i now\n", it->second.GetStateString(), it->second.addr.ToString(), size() - 1);
 
                 // erase all of the broadcasts we've seen from this txin, ...
-                mapSeenMasternodeBroadcast.erase(hash);
+                RemoveSeenMasternodeBroadcast(hash);
                 mWeAskedForMasternodeListEntry.erase(it->first);
+                setCacheDirtyMasternodes.insert(it->first);
 
                 // and finally remove it from the list
                 it->second.FlagGovernanceItemsAsDirty();
                 uiInterface.NotifyMasternodeChanged(it->first, CT_DELETED);
+                RankCacheRemove(it->second);
+                setPaymentQueue.erase(std::make_pair(it->second.nBlockLastPaid, it->first));
+                mapCollateralHeight.erase(it->first);
                 mapMasternodes.erase(it++);
+                fSnapshotStale = true;
                 fMasternodesRemoved = true;
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
@@ -211,11 +247,14 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
                     }
                     // wait for mnb recovery replies for MNB_RECOVERY_WAIT_SECONDS seconds
                     mMnbRecoveryRequests[hash] = std::make_pair(GetTime() + MNB_RECOVERY_WAIT_SECONDS, setRequested);
+                    fCacheStateDirty = true;
                 }
                 ++it;
             }
         }
 
+        PruneLastPaid();
+
         // proces replies for MASTERNODE_NEW_START_REQUIRED masternodes
         LogPrint(BCLog::MNODE, "CMasternodeMan::CheckAndRemove -- mMnbRecoveryGoodReplies size=%d\n", (int)mMnbRecoveryGoodReplies.size());
         std::map<uint256, std::vector<CMasternodeBroadcast> >::iterator itMnbReplies = mMnbRecoveryGoodReplies.begin();
@@ -232,6 +271,7 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
                 }
                 LogPrint(BCLog::MNODE, "CMasternodeMan::CheckAndRemove -- removing mnb recovery reply, masternode=%s, size=%d\n", itMnbReplies->second[0].outpoint.ToStringShort(), (int)itMnbReplies->second.size());
                 mMnbRecoveryGoodReplies.erase(itMnbReplies++);
+                fCacheStateDirty = true;
             } else {
                 ++itMnbReplies;
             }
@@ -247,6 +287,7 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
             // if mn is still in MASTERNODE_NEW_START_REQUIRED state.
             if (GetTime() - itMnbRequest->second.first > MNB_RECOVERY_RETRY_SECONDS) {
                 mMnbRecoveryRequests.erase(itMnbRequest++);
+                fCacheStateDirty = true;
             } else {
                 ++itMnbRequest;
             }
@@ -257,6 +298,7 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
         while(it1 != mAskedUsForMasternodeList.end()){
             if ((*it1).second < GetTime()) {
                 mAskedUsForMasternodeList.erase(it1++);
+                fCacheStateDirty = true;
             } else {
                 ++it1;
             }
@@ -267,6 +309,7 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
         while(it1 != mWeAskedForMasternodeList.end()){
             if ((*it1).second < GetTime()){
                 mWeAskedForMasternodeList.erase(it1++);
+                fCacheStateDirty = true;
             } else {
                 ++it1;
             }
@@ -279,6 +322,7 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
             while(it3 != it2->second.end()){
                 if (it3->second < GetTime()){
                     it2->second.erase(it3++);
+                    fCacheStateDirty = true;
                 } else {
                     ++it3;
                 }
@@ -302,13 +346,17 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
         // NOTE: do not expire mapSeenMasternodeBroadcast entries here, clean them on mnb updates!
 
         // remove expired mapSeenMasternodePing
-        std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
-        while(it4 != mapSeenMasternodePing.end()){
-            if ((*it4).second.IsExpired()) {
-                LogPrint(BCLog::MNODE, "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", (*it4).second.GetHash().ToString());
-                mapSeenMasternodePing.erase(it4++);
-            } else {
-                ++it4;
+        {
+            LOCK(cs_mapSeenMessages);
+            std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
+            while(it4 != mapSeenMasternodePing.end()){
+                if ((*it4).second.IsExpired()) {
+                    LogPrint(BCLog::MNODE, "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", (*it4).second.GetHash().ToString());
+                    mapSeenMasternodePing.erase(it4++);
+                    fCacheStateDirty = true;
+                } else {
+                    ++it4;
+                }
             }
         }
 
@@ -333,14 +381,37 @@ void CMasternodeMan::CheckAndRemove(CConnman* connman)
 
 void CMasternodeMan::Clear()
 {
+    {
+        LOCK(cs_vecPendingMessages);
+        for (auto& msg : vecPendingMessages) {
+            msg.pfrom->Release();
+        }
+        vecPendingMessages.clear();
+    }
+
     LOCK(cs);
+    for (const auto& mnpair : mapMasternodes) {
+        setCacheDirtyMasternodes.insert(mnpair.first);
+    }
+    fCacheStateDirty = true;
     mapMasternodes.clear();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
-    mapSeenMasternodeBroadcast.clear();
-    mapSeenMasternodePing.clear();
+    {
+        LOCK(cs_mapSeenMessages);
+        mapSeenMasternodeBroadcast.clear();
+        mapSeenMasternodePing.clear();
+    }
     nLastSentinelPingTime = 0;
+    mapPayeeLastPaid.clear();
+    hashLastPaidBlock.SetNull();
+    nLastPaidHeight = 0;
+    fLastPaidVotesSynced = false;
+    listRankCache.clear();
+    setPaymentQueue.clear();
+    mapCollateralHeight.clear();
+    fSnapshotStale = true;
 }
 
 int CMasternodeMan::CountMasternodes(int nProtocolVersion)
@@ -406,6 +477,7 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman* connman)
 
     int64_t askAgain = GetTime() + DSEG_UPDATE_SECONDS;
     mWeAskedForMasternodeList[addrSquashed] = askAgain;
+    fCacheStateDirty = true;
 
     LogPrint(BCLog::MNODE, "CMasternodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
@@ -472,6 +544,26 @@ bool CMasternodeMan::Has(const COutPoint& outpoint)
     return mapMasternodes.find(outpoint) != mapMasternodes.end();
 }
 
+std::shared_ptr<const std::map<COutPoint, CMasternode> > CMasternodeMan::GetFullMasternodeMap()
+{
+    std::shared_ptr<const std::map<COutPoint, CMasternode> > pmapSnapshot = std::atomic_load(&pmapMasternodesSnapshot);
+    if (pmapSnapshot && !fSnapshotStale && GetTime() - nSnapshotTime < SNAPSHOT_MAX_AGE_SECONDS) {
+        return pmapSnapshot;
+    }
+
+    LOCK(cs);
+    // another reader may have refreshed it while we were waiting
+    pmapSnapshot = std::atomic_load(&pmapMasternodesSnapshot);
+    if (pmapSnapshot && !fSnapshotStale && GetTime() - nSnapshotTime < SNAPSHOT_MAX_AGE_SECONDS) {
+        return pmapSnapshot;
+    }
+    pmapSnapshot = std::make_shared<const std::map<COutPoint, CMasternode> >(mapMasternodes);
+    fSnapshotStale = false;
+    nSnapshotTime = GetTime();
+    std::atomic_store(&pmapMasternodesSnapshot, pmapSnapshot);
+    return pmapSnapshot;
+}
+
 bool CMasternodeMan::HasBlockHash(uint256& hashRet, int nBlockHeight)
 {
     if (chainActive.Tip() == nullptr) return false;
@@ -503,66 +595,75 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
     LOCK2(cs_main,cs);
 
-    std::vector<std::pair<int, const CMasternode*> > vecMasternodeLastPaid;
+    int nMnCount = CountMasternodes();
+    int nMinProtocol = mnpayments.GetMinMasternodePaymentsProto();
+    std::set<CScript> setScheduledPayees = mnpayments.GetScheduledPayees(nBlockHeight);
 
     /*
-        Make a vector with all of the last paid times
+        Walk the masternodes from the longest unpaid on. Only the first 1/10 of the network is scored,
+        the rest is just counted. Masternodes which are too new are only left out if enough remain,
+        so keep the candidates and count both with and without them.
     */
 
-    int nMnCount = CountMasternodes();
+    size_t nTenthNetwork = std::max(nMnCount/10, 1);
+    std::vector<const CMasternode*> vecCandidates, vecCandidatesNoSigTime;
+    int nCount = 0, nCountNoSigTime = 0;
 
-    for (const auto& mnpair : mapMasternodes) {
-        if (!mnpair.second.IsValidForPayment()) continue;
+    for (const auto& queuePair : setPaymentQueue) {
+        const CMasternode& mn = mapMasternodes.at(queuePair.second);
+
+        if (!mn.IsValidForPayment()) continue;
 
         //check protocol version
-        if (mnpair.second.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+        if (mn.nProtocolVersion < nMinProtocol) continue;
 
-        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if (mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+        //make sure it has at least as many confirmations as there are masternodes
+        int nCollateralHeight = GetCollateralHeight(mn.outpoint);
+        if (nCollateralHeight < 0 || (chainActive.Height() - nCollateralHeight + 1) < nMnCount) continue;
 
-        //it's too new, wait for a cycle
-        if (fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
+        if (!setScheduledPayees.empty() && setScheduledPayees.count(GetScriptForDestination(mn.collDest))) continue;
 
-        //check the output
-        Coin coin;
-        if (!pcoinsTip->GetCoin(mnpair.first, coin)) continue;
+        nCountNoSigTime++;
+        if (vecCandidatesNoSigTime.size() < nTenthNetwork) {
+            vecCandidatesNoSigTime.push_back(&mn);
+        }
 
-        //make sure it has at least as many confirmations as there are masternodes
-        if ((chainActive.Height() - coin.nHeight + 1) < nMnCount) continue;
+        //it's too new, wait for a cycle
+        if (fFilterSigTime && mn.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
+        nCount++;
+        if (vecCandidates.size() < nTenthNetwork) {
+            vecCandidates.push_back(&mn);
+        }
     }
 
-    nCountRet = (int)vecMasternodeLastPaid.size();
+    nCountRet = nCount;
 
     //when the network is in the process of upgrading, don't penalize nodes that recently restarted
-    if (fFilterSigTime && nCountRet < nMnCount/3)
-        return GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet);
-
-    // Sort them low to high
-    std::sort(vecMasternodeLastPaid.begin(), vecMasternodeLastPaid.end(), CompareLastPaidBlock());
+    if (fFilterSigTime && nCountRet < nMnCount/3) {
+        nCountRet = nCountNoSigTime;
+        vecCandidates.swap(vecCandidatesNoSigTime);
+    }
 
     uint256 blockHash;
     if (!HasBlockHash(blockHash, nBlockHeight - 101)) {
         LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
         return false;
     }
+
     // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
     //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = nMnCount/10;
-    int nCountTenth = 0;
     arith_uint256 nHighest = 0;
     const CMasternode *pBestMasternode = nullptr;
-    for (const auto& s : vecMasternodeLastPaid) {
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
+    for (const auto pmn : vecCandidates) {
+        arith_uint256 nScore = pmn->CalculateScore(blockHash);
         if (nScore > nHighest){
             nHighest = nScore;
-            pBestMasternode = s.second;
+            pBestMasternode = pmn;
         }
-        nCountTenth++;
-        if (nCountTenth >= nTenthNetwork) break;
     }
     if (pBestMasternode) {
         mnInfoRet = pBestMasternode->GetInfo();
@@ -570,6 +671,21 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     return mnInfoRet.fInfoValid;
 }
 
+int CMasternodeMan::GetCollateralHeight(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs);
+
+    auto it = mapCollateralHeight.find(outpoint);
+    if (it != mapCollateralHeight.end()) return it->second;
+
+    Coin coin;
+    if (!pcoinsTip->GetCoin(outpoint, coin)) return -1;
+
+    mapCollateralHeight.emplace(outpoint, (int)coin.nHeight);
+    return coin.nHeight;
+}
+
 masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion)
 {
     LOCK(cs);
@@ -612,27 +728,68 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     return masternode_info_t();
 }
 
-bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeMan::score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol)
+const CMasternodeMan::score_pair_vec_t* CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, int nMinProtocol)
 {
-    vecMasternodeScoresRet.clear();
-
     if (!masternodeSync.IsMasternodeListSynced())
-        return false;
+        return nullptr;
 
     AssertLockHeld(cs);
 
     if (mapMasternodes.empty())
-        return false;
+        return nullptr;
+
+    const auto key = std::make_pair(nBlockHash, nMinProtocol);
+    auto it = std::find_if(listRankCache.begin(), listRankCache.end(),
+                           [&key](const std::pair<std::pair<uint256, int>, score_pair_vec_t>& entry) { return entry.first == key; });
+    if (it != listRankCache.end()) {
+        // move to the front so the least recently used ranking is the one to go
+        listRankCache.splice(listRankCache.begin(), listRankCache, it);
+    } else {
+        // calculate scores
+        score_pair_vec_t vecMasternodeScores;
+        vecMasternodeScores.reserve(mapMasternodes.size());
+        for (const auto& mnpair : mapMasternodes) {
+            if (mnpair.second.nProtocolVersion >= nMinProtocol) {
+                vecMasternodeScores.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+            }
+        }
+        std::sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
 
-    // calculate scores
-    for (const auto& mnpair : mapMasternodes) {
-        if (mnpair.second.nProtocolVersion >= nMinProtocol) {
-            vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+        listRankCache.emplace_front(key, std::move(vecMasternodeScores));
+        if (listRankCache.size() > MAX_RANK_CACHE_SIZE) {
+            listRankCache.pop_back();
         }
     }
 
-    std::sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
-    return !vecMasternodeScoresRet.empty();
+    const score_pair_vec_t& vecMasternodeScores = listRankCache.front().second;
+    return vecMasternodeScores.empty() ? nullptr : &vecMasternodeScores;
+}
+
+void CMasternodeMan::RankCacheAdd(const CMasternode& mn)
+{
+    AssertLockHeld(cs);
+
+    for (auto& entry : listRankCache) {
+        if (mn.nProtocolVersion < entry.first.second) continue;
+        score_pair_t scorePair = std::make_pair(mn.CalculateScore(entry.first.first), &mn);
+        score_pair_vec_t& vecMasternodeScores = entry.second;
+        // rankings are sorted best first, i.e. in reverse CompareScoreMN order
+        auto pos = std::lower_bound(vecMasternodeScores.begin(), vecMasternodeScores.end(), scorePair,
+                                    [](const score_pair_t& a, const score_pair_t& b) { return CompareScoreMN()(b, a); });
+        vecMasternodeScores.insert(pos, scorePair);
+    }
+}
+
+void CMasternodeMan::RankCacheRemove(const CMasternode& mn)
+{
+    AssertLockHeld(cs);
+
+    for (auto& entry : listRankCache) {
+        score_pair_vec_t& vecMasternodeScores = entry.second;
+        vecMasternodeScores.erase(std::remove_if(vecMasternodeScores.begin(), vecMasternodeScores.end(),
+                                                 [&mn](const score_pair_t& scorePair) { return scorePair.second == &mn; }),
+                                  vecMasternodeScores.end());
+    }
 }
 
 bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
@@ -651,12 +808,12 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(blockHash, vecMasternodeScores, nMinProtocol))
+    const score_pair_vec_t* pvecMasternodeScores = GetMasternodeScores(blockHash, nMinProtocol);
+    if (!pvecMasternodeScores)
         return false;
 
     int nRank = 0;
-    for (const auto& scorePair : vecMasternodeScores) {
+    for (const auto& scorePair : *pvecMasternodeScores) {
         nRank++;
         if (scorePair.second->outpoint == outpoint) {
             nRankRet = nRank;
@@ -683,12 +840,13 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(blockHash, vecMasternodeScores, nMinProtocol))
+    const score_pair_vec_t* pvecMasternodeScores = GetMasternodeScores(blockHash, nMinProtocol);
+    if (!pvecMasternodeScores)
         return false;
 
+    vecMasternodeRanksRet.reserve(pvecMasternodeScores->size());
     int nRank = 0;
-    for (const auto& scorePair : vecMasternodeScores) {
+    for (const auto& scorePair : *pvecMasternodeScores) {
         nRank++;
         vecMasternodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
     }
@@ -798,76 +956,226 @@ void CMasternodeMan::ProcessPendingMnbRequests(CConnman* connman)
     LogPrint(BCLog::MNODE, "%s -- mapPendingMNB size: %d\n", __func__, mapPendingMNB.size());
 }
 
-void CMasternodeMan::ProcessModuleMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+namespace {
+/** Verify one signature of a masternode broadcast or ping, leaving the result in the hash signature cache */
+class CMasternodeSignatureCheck
 {
-    if (fLiteMode) return; // disable all Chaincoin specific functionality
+private:
+    uint256 hash;
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
 
-    if (strCommand == NetMsgType::MNANNOUNCE) { //Masternode Broadcast
+public:
+    CMasternodeSignatureCheck() {}
+    CMasternodeSignatureCheck(const uint256& hashIn, const CPubKey& pubkeyIn, const std::vector<unsigned char>& vchSigIn) :
+        hash(hashIn), pubkey(pubkeyIn), vchSig(vchSigIn) {}
 
-        CMasternodeBroadcast mnb;
-        vRecv >> mnb;
+    bool operator()()
+    {
+        std::string strError;
+        CHashSigner::VerifyHash(hash, pubkey, vchSig, strError);
+        // invalid signatures are reported when the message is processed, keep checking the rest
+        return true;
+    }
 
-        if (!masternodeSync.IsBlockchainSynced()) return;
+    void swap(CMasternodeSignatureCheck& check)
+    {
+        std::swap(hash, check.hash);
+        std::swap(pubkey, check.pubkey);
+        vchSig.swap(check.vchSig);
+    }
+};
 
-        LogPrint(BCLog::MNODE, "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.outpoint.ToStringShort());
+CCheckQueue<CMasternodeSignatureCheck> masternodeSignatureCheckQueue(16);
+} // namespace
 
-        int nDos = 0;
+void ThreadMasternodeSignatureCheck()
+{
+    RenameThread("chaincoin-mnsigch");
+    masternodeSignatureCheckQueue.Thread();
+}
 
-        if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
-            // use announced Masternode as a peer
-            std::vector<CAddress> vAddr;
-            vAddr.push_back(CAddress(mnb.addr, NODE_NETWORK));
-            connman->AddNewAddresses(vAddr, pfrom->addr, 2*60*60);
-        } else if (nDos > 0) {
-            LOCK(cs_main);
-            Misbehaving(pfrom->GetId(), nDos);
-        }
+void CMasternodeMan::ProcessMasternodeBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb, CConnman* connman)
+{
+    LogPrint(BCLog::MNODE, "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.outpoint.ToStringShort());
 
-        if (fMasternodesAdded) {
-            NotifyMasternodeUpdates(connman);
-        }
-    } else if (strCommand == NetMsgType::MNPING) { //Masternode Ping
+    int nDos = 0;
 
-        CMasternodePing mnp;
-        vRecv >> mnp;
+    if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
+        // use announced Masternode as a peer
+        std::vector<CAddress> vAddr;
+        vAddr.push_back(CAddress(mnb.addr, NODE_NETWORK));
+        connman->AddNewAddresses(vAddr, pfrom->addr, 2*60*60);
+    } else if (nDos > 0) {
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), nDos);
+    }
 
-        uint256 nHash = mnp.GetHash();
+    if (fMasternodesAdded) {
+        NotifyMasternodeUpdates(connman);
+    }
+}
 
-        if (!masternodeSync.IsBlockchainSynced()) return;
+void CMasternodeMan::ProcessMasternodePing(CNode* pfrom, CMasternodePing& mnp, CConnman* connman)
+{
+    LogPrint(BCLog::MNODE, "MNPING -- Masternode ping, masternode=%s\n", mnp.masternodeOutpoint.ToStringShort());
 
-        LogPrint(BCLog::MNODE, "MNPING -- Masternode ping, masternode=%s\n", mnp.masternodeOutpoint.ToStringShort());
+    // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
+    LOCK2(cs_main, cs);
 
-        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
-        LOCK2(cs_main, cs);
+    if (!AddSeenMasternodePing(mnp)) return; //seen
 
-        if (mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+    LogPrint(BCLog::MNODE, "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
+
+    // see if we have this Masternode
+    CMasternode* pmn = Find(mnp.masternodeOutpoint);
+
+    if (pmn && mnp.fSentinelIsCurrent)
+        UpdateLastSentinelPingTime();
+
+    // too late, new MNANNOUNCE is required
+    if (pmn && pmn->IsNewStartRequired()) return;
+
+    int nDos = 0;
+    bool fUpdated = mnp.CheckAndUpdate(pmn, false, nDos, connman);
+    // the ping may have been stored even when the masternode did not come out enabled
+    if (pmn) setCacheDirtyMasternodes.insert(pmn->outpoint);
+    if (fUpdated) return;
+
+    if (nDos > 0) {
+        // if anything significant failed, mark that node
+        Misbehaving(pfrom->GetId(), nDos);
+    } else if (pmn != nullptr) {
+        // nothing significant failed, mn is a known one too
+        return;
+    }
+
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.masternodeOutpoint, connman);
+}
+
+void CMasternodeMan::ProcessPendingMessages(CConnman* connman)
+{
+    LOCK(cs_processPendingMessages);
+
+    std::vector<CPendingMasternodeMessage> vecMessages;
+    {
+        LOCK(cs_vecPendingMessages);
+        vecMessages.swap(vecPendingMessages);
+    }
+    if (vecMessages.empty()) return;
+
+    // Collect the signatures of everything we have not seen yet. Pings are signed by the
+    // masternode key, which comes from the list or from a broadcast earlier in this batch.
+    std::vector<CMasternodeSignatureCheck> vChecks;
+    std::map<COutPoint, CPubKey> mapBatchPubKeys;
+    {
+        LOCK(cs);
+        for (const auto& msg : vecMessages) {
+            if (msg.fPing) {
+                if (HasSeenMasternodePing(msg.mnp.GetHash())) continue;
+                auto it = mapBatchPubKeys.find(msg.mnp.masternodeOutpoint);
+                if (it != mapBatchPubKeys.end()) {
+                    vChecks.emplace_back(msg.mnp.GetSignatureHash(), it->second, msg.mnp.vchSig);
+                } else if (const CMasternode* pmn = Find(msg.mnp.masternodeOutpoint)) {
+                    vChecks.emplace_back(msg.mnp.GetSignatureHash(), pmn->pubKeyMasternode, msg.mnp.vchSig);
+                }
+            } else {
+                if (HasSeenMasternodeBroadcast(msg.mnb.GetHash())) continue;
+                vChecks.emplace_back(msg.mnb.GetSignatureHash(), msg.mnb.pubKeyCollateralAddress, msg.mnb.vchSig);
+                if (msg.mnb.lastPing) {
+                    vChecks.emplace_back(msg.mnb.lastPing.GetSignatureHash(), msg.mnb.pubKeyMasternode, msg.mnb.lastPing.vchSig);
+                }
+                mapBatchPubKeys[msg.mnb.outpoint] = msg.mnb.pubKeyMasternode;
+            }
+        }
+    }
+
+    {
+        CCheckQueueControl<CMasternodeSignatureCheck> control(&masternodeSignatureCheckQueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    // Results are in the signature cache now, process the messages as they arrived
+    for (auto& msg : vecMessages) {
+        if (!msg.pfrom->fDisconnect) {
+            if (msg.fPing) {
+                ProcessMasternodePing(msg.pfrom, msg.mnp, connman);
+            } else {
+                ProcessMasternodeBroadcast(msg.pfrom, msg.mnb, connman);
+            }
+        }
+        msg.pfrom->Release();
+    }
+}
+
+void CMasternodeMan::ProcessPendingMessagesIfDue(CConnman* connman)
+{
+    {
+        LOCK(cs_vecPendingMessages);
+        if (vecPendingMessages.empty()) return;
+        if (vecPendingMessages.size() < PENDING_MESSAGES_BATCH && GetTimeMillis() - nPendingMessagesTime < PENDING_MESSAGES_MAX_WAIT_MS) return;
+    }
+    ProcessPendingMessages(connman);
+}
+
+void CMasternodeMan::ReleasePendingMessages(NodeId nodeid)
+{
+    LOCK(cs_vecPendingMessages);
+    auto itEnd = std::remove_if(vecPendingMessages.begin(), vecPendingMessages.end(), [nodeid](const CPendingMasternodeMessage& msg) {
+        if (msg.pfrom->GetId() != nodeid) return false;
+        msg.pfrom->Release();
+        return true;
+    });
+    vecPendingMessages.erase(itEnd, vecPendingMessages.end());
+}
 
-        LogPrint(BCLog::MNODE, "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
+void CMasternodeMan::ReleaseDisconnectedPendingMessages()
+{
+    LOCK(cs_vecPendingMessages);
+    auto itEnd = std::remove_if(vecPendingMessages.begin(), vecPendingMessages.end(), [](const CPendingMasternodeMessage& msg) {
+        if (!msg.pfrom->fDisconnect) return false;
+        msg.pfrom->Release();
+        return true;
+    });
+    vecPendingMessages.erase(itEnd, vecPendingMessages.end());
+}
 
-        // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.masternodeOutpoint);
+void CMasternodeMan::ProcessModuleMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+{
+    if (fLiteMode) return; // disable all Chaincoin specific functionality
 
-        if (pmn && mnp.fSentinelIsCurrent)
-            UpdateLastSentinelPingTime();
+    if (strCommand == NetMsgType::MNANNOUNCE || strCommand == NetMsgType::MNPING) {
 
-        // too late, new MNANNOUNCE is required
-        if (pmn && pmn->IsNewStartRequired()) return;
+        CPendingMasternodeMessage msg{pfrom, strCommand == NetMsgType::MNPING, CMasternodeBroadcast(), CMasternodePing()};
+        if (msg.fPing) {
+            vRecv >> msg.mnp;
+        } else {
+            vRecv >> msg.mnb;
+        }
 
-        int nDos = 0;
-        if (mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
+        if (!masternodeSync.IsBlockchainSynced()) return;
 
-        if (nDos > 0) {
-            // if anything significant failed, mark that node
-            Misbehaving(pfrom->GetId(), nDos);
-        } else if (pmn != nullptr) {
-            // nothing significant failed, mn is a known one too
+        // without signature check threads there is nothing to gain from batching
+        if (nScriptCheckThreads == 0) {
+            if (msg.fPing) {
+                ProcessMasternodePing(pfrom, msg.mnp, connman);
+            } else {
+                ProcessMasternodeBroadcast(pfrom, msg.mnb, connman);
+            }
             return;
         }
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.masternodeOutpoint, connman);
+        {
+            LOCK(cs_vecPendingMessages);
+            if (vecPendingMessages.empty()) nPendingMessagesTime = GetTimeMillis();
+            pfrom->AddRef();
+            vecPendingMessages.push_back(std::move(msg));
+        }
+        // partial batches are picked up by SendMessages once they waited long enough
+        ProcessPendingMessagesIfDue(connman);
 
     } else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
         // Ignore such requests until we are fully synced.
@@ -948,6 +1256,7 @@ void CMasternodeMan::SyncAll(CNode* pnode, CConnman* connman)
         }
         int64_t askAgain = GetTime() + DSEG_UPDATE_SECONDS;
         mAskedUsForMasternodeList[addrSquashed] = askAgain;
+        fCacheStateDirty = true;
     }
 
     int nInvCount = 0;
@@ -979,8 +1288,10 @@ void CMasternodeMan::PushDsegInvs(CNode* pnode, const CMasternode& mn)
     uint256 hashMNP = mnp.GetHash();
     pnode->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hashMNB));
     pnode->PushInventory(CInv(MSG_MASTERNODE_PING, hashMNP));
+    LOCK(cs_mapSeenMessages);
     mapSeenMasternodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb)));
     mapSeenMasternodePing.insert(std::make_pair(hashMNP, mnp));
+    fCacheStateDirty = true;
 }
 
 // Verification of masternodes via unique direct requests.
@@ -1109,9 +1420,11 @@ void CMasternodeMan::CheckSameAddr()
     }
 
     // ban duplicates
+    LOCK(cs);
     for (auto& pmn : vBan) {
         LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", pmn->outpoint.ToStringShort());
         pmn->IncreasePoSeBanScore();
+        setCacheDirtyMasternodes.insert(pmn->outpoint);
     }
 }
 
@@ -1268,6 +1581,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
                     prealMasternode = &mnpair.second;
                     if (!mnpair.second.IsPoSeVerified()) {
                         mnpair.second.DecreasePoSeBanScore();
+                        setCacheDirtyMasternodes.insert(mnpair.first);
                     }
                     netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done");
 
@@ -1314,6 +1628,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
         // increase ban score for everyone else
         for (const auto& pmn : vpMasternodesToBan) {
             pmn->IncreasePoSeBanScore();
+            setCacheDirtyMasternodes.insert(pmn->outpoint);
             LogPrint(BCLog::MNODE, "CMasternodeMan::ProcessVerifyReply -- increased PoSe ban score for %s addr %s, new score %d\n",
                         prealMasternode->outpoint.ToStringShort(), pnode->addr.ToString(), pmn->nPoSeBanScore);
         }
@@ -1407,6 +1722,7 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
 
         if (!pmn1->IsPoSeVerified()) {
             pmn1->DecreasePoSeBanScore();
+            setCacheDirtyMasternodes.insert(pmn1->outpoint);
         }
         mnv.Relay();
 
@@ -1418,6 +1734,7 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
         for (auto& mnpair : mapMasternodes) {
             if (mnpair.second.addr != mnv.addr || mnpair.first == mnv.masternodeOutpoint1) continue;
             mnpair.second.IncreasePoSeBanScore();
+            setCacheDirtyMasternodes.insert(mnpair.first);
             nCount++;
             LogPrint(BCLog::MNODE, "CMasternodeMan::ProcessVerifyBroadcast -- increased PoSe ban score for %s addr %s, new score %d\n",
                         mnpair.first.ToStringShort(), mnpair.second.addr.ToString(), mnpair.second.nPoSeBanScore);
@@ -1451,12 +1768,29 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         LogPrint(BCLog::MNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- masternode=%s\n", mnb.outpoint.ToStringShort());
 
         uint256 hash = mnb.GetHash();
-        if (mapSeenMasternodeBroadcast.count(hash) && !mnb.fRecovery) { //seen
+        CMasternodeBroadcast mnbSeen;
+        bool fBumpSeen = false;
+        bool fSeen;
+        {
+            LOCK(cs_mapSeenMessages);
+            auto itSeen = mapSeenMasternodeBroadcast.find(hash);
+            fSeen = itSeen != mapSeenMasternodeBroadcast.end();
+            if (fSeen && !mnb.fRecovery) {
+                mnbSeen = itSeen->second.second;
+                // less then 2 pings left before this MN goes into non-recoverable state, bump sync timeout
+                if (GetTime() - itSeen->second.first > MASTERNODE_NEW_START_REQUIRED_SECONDS - MASTERNODE_MIN_MNP_SECONDS * 2) {
+                    itSeen->second.first = GetTime();
+                    fBumpSeen = true;
+                }
+            } else {
+                mapSeenMasternodeBroadcast.insert(std::make_pair(hash, std::make_pair(GetTime(), mnb)));
+            }
+        }
+        if (fBumpSeen || !fSeen || mnb.fRecovery) fCacheStateDirty = true;
+        if (fSeen && !mnb.fRecovery) { //seen
             LogPrint(BCLog::MNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- masternode=%s seen\n", mnb.outpoint.ToStringShort());
-            // less then 2 pings left before this MN goes into non-recoverable state, bump sync timeout
-            if (GetTime() - mapSeenMasternodeBroadcast[hash].first > MASTERNODE_NEW_START_REQUIRED_SECONDS - MASTERNODE_MIN_MNP_SECONDS * 2) {
+            if (fBumpSeen) {
                 LogPrint(BCLog::MNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- masternode=%s seen update\n", mnb.outpoint.ToStringShort());
-                mapSeenMasternodeBroadcast[hash].first = GetTime();
                 masternodeSync.BumpAssetLastTime("CMasternodeMan::CheckMnbAndUpdateMasternodeList - seen");
             }
             // did we ask this node for it?
@@ -1466,8 +1800,9 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
                     LogPrint(BCLog::MNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- mnb=%s seen request, addr=%s\n", hash.ToString(), pfrom->addr.ToString());
                     // do not allow node to send same mnb multiple times in recovery mode
                     mMnbRecoveryRequests[hash].second.erase(pfrom->addr);
+                    fCacheStateDirty = true;
                     // does it have newer lastPing?
-                    if (mnb.lastPing.sigTime > mapSeenMasternodeBroadcast[hash].second.lastPing.sigTime) {
+                    if (mnb.lastPing.sigTime > mnbSeen.lastPing.sigTime) {
                         // simulate Check
                         CMasternode mnTemp = CMasternode(mnb);
                         mnTemp.Check();
@@ -1483,7 +1818,6 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
             uiInterface.NotifyMasternodeChanged(mnb.outpoint, CT_UPDATED);
             return true;
         }
-        mapSeenMasternodeBroadcast.insert(std::make_pair(hash, std::make_pair(GetTime(), mnb)));
 
         LogPrint(BCLog::MNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- masternode=%s new\n", mnb.outpoint.ToStringShort());
 
@@ -1495,13 +1829,22 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         // search Masternode list
         CMasternode* pmn = Find(mnb.outpoint);
         if (pmn) {
-            CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if (!mnb.Update(pmn, nDos, connman)) {
+            CMasternodeBroadcast mnbOld;
+            GetSeenMasternodeBroadcast(CMasternodeBroadcast(*pmn).GetHash(), mnbOld);
+            int nProtocolVersionOld = pmn->nProtocolVersion;
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            setCacheDirtyMasternodes.insert(pmn->outpoint);
+            if (pmn->nProtocolVersion != nProtocolVersionOld) {
+                // the protocol filter of the cached rankings may now include or exclude it
+                RankCacheRemove(*pmn);
+                RankCacheAdd(*pmn);
+            }
+            if (!fUpdated) {
                 LogPrint(BCLog::MNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.outpoint.ToStringShort());
                 return false;
             }
             if (hash != mnbOld.GetHash()) {
-                mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
+                RemoveSeenMasternodeBroadcast(mnbOld.GetHash());
             }
             return true;
         }
@@ -1533,33 +1876,302 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
     return true;
 }
 
-void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
+bool CMasternodeMan::HasSeenMasternodeBroadcast(const uint256& hash) const
 {
-    // Need LOCK2 here to ensure consistent locking order because code below locks cs_main
-    // in ReadBlockFromDisk
-    LOCK2(cs_main, cs);
+    LOCK(cs_mapSeenMessages);
+    return mapSeenMasternodeBroadcast.count(hash);
+}
+
+bool CMasternodeMan::GetSeenMasternodeBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet) const
+{
+    LOCK(cs_mapSeenMessages);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it == mapSeenMasternodeBroadcast.end()) {
+        return false;
+    }
+    mnbRet = it->second.second;
+    return true;
+}
+
+void CMasternodeMan::RemoveSeenMasternodeBroadcast(const uint256& hash)
+{
+    LOCK(cs_mapSeenMessages);
+    if (mapSeenMasternodeBroadcast.erase(hash)) fCacheStateDirty = true;
+}
+
+void CMasternodeMan::UpdateSeenMasternodeBroadcastPing(const uint256& hash, const CMasternodePing& mnp)
+{
+    LOCK(cs_mapSeenMessages);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it != mapSeenMasternodeBroadcast.end()) {
+        it->second.second.lastPing = mnp;
+        fCacheStateDirty = true;
+    }
+}
 
-    if (fLiteMode || !masternodeSync.IsWinnersListSynced() || mapMasternodes.empty()) return;
+bool CMasternodeMan::HasSeenMasternodePing(const uint256& hash) const
+{
+    LOCK(cs_mapSeenMessages);
+    return mapSeenMasternodePing.count(hash);
+}
 
-    static int nLastRunBlockHeight = 0;
-    // Scan at least LAST_PAID_SCAN_BLOCKS but no more than mnpayments.GetStorageLimit()
-    int nMaxBlocksToScanBack = std::max(LAST_PAID_SCAN_BLOCKS, nCachedBlockHeight - nLastRunBlockHeight);
-    nMaxBlocksToScanBack = std::min(nMaxBlocksToScanBack, mnpayments.GetStorageLimit());
+bool CMasternodeMan::GetSeenMasternodePing(const uint256& hash, CMasternodePing& mnpRet) const
+{
+    LOCK(cs_mapSeenMessages);
+    auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end()) {
+        return false;
+    }
+    mnpRet = it->second;
+    return true;
+}
 
-    LogPrint(BCLog::MNODEPAY, "CMasternodeMan::UpdateLastPaid -- nCachedBlockHeight=%d, nLastRunBlockHeight=%d, nMaxBlocksToScanBack=%d\n",
-                            nCachedBlockHeight, nLastRunBlockHeight, nMaxBlocksToScanBack);
+bool CMasternodeMan::AddSeenMasternodePing(const CMasternodePing& mnp)
+{
+    LOCK(cs_mapSeenMessages);
+    if (!mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp)).second) return false;
+    fCacheStateDirty = true;
+    return true;
+}
+
+void CMasternodeMan::SetLastPaid(const CTxDestination& dest, const CScript& payee)
+{
+    AssertLockHeld(cs);
 
+    int nHeight = 0;
+    int64_t nTime = 0;
+    auto it = mapPayeeLastPaid.find(payee);
+    if (it != mapPayeeLastPaid.end()) {
+        nHeight = it->second.back().first;
+        nTime = it->second.back().second;
+    }
     for (auto& mnpair : mapMasternodes) {
-        mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        if (mnpair.second.collDest == dest) {
+            SetMasternodeLastPaid(mnpair.second, nHeight, nTime);
+        }
+    }
+}
+
+void CMasternodeMan::SetMasternodeLastPaid(CMasternode& mn, int nHeight, int64_t nTime)
+{
+    AssertLockHeld(cs);
+
+    if (mn.nBlockLastPaid != nHeight) {
+        setPaymentQueue.erase(std::make_pair(mn.nBlockLastPaid, mn.outpoint));
+        setPaymentQueue.emplace(nHeight, mn.outpoint);
+        mn.nBlockLastPaid = nHeight;
+        setCacheDirtyMasternodes.insert(mn.outpoint);
     }
+    if (mn.nTimeLastPaid != nTime) {
+        mn.nTimeLastPaid = nTime;
+        setCacheDirtyMasternodes.insert(mn.outpoint);
+    }
+}
 
-    nLastRunBlockHeight = nCachedBlockHeight;
+void CMasternodeMan::ConnectLastPaid(const CBlock& block, const std::set<CScript>& setVoted, int nHeight, int64_t nTime)
+{
+    AssertLockHeld(cs);
+
+    const CTransactionRef& coinbase = block.vtx[0];
+    CAmount nMasternodePayment = GetMasternodePayment(nHeight, coinbase->GetValueOut());
+    for (const auto& txout : coinbase->vout) {
+        CTxDestination dest;
+        if (txout.nValue != nMasternodePayment || !setVoted.count(txout.scriptPubKey)) continue;
+        if (!ExtractDestination(txout.scriptPubKey, dest)) continue;
+
+        auto& vecPaid = mapPayeeLastPaid[txout.scriptPubKey];
+        if (!vecPaid.empty() && vecPaid.back().first >= nHeight) continue;
+        vecPaid.emplace_back(nHeight, nTime);
+        if (vecPaid.size() > (size_t)MAX_LAST_PAID_HISTORY) {
+            vecPaid.erase(vecPaid.begin());
+        }
+        SetLastPaid(dest, txout.scriptPubKey);
+        LogPrint(BCLog::MNODEPAY, "CMasternodeMan::ConnectLastPaid -- payment to %s at %d\n", EncodeDestination(dest), nHeight);
+    }
+    hashLastPaidBlock = block.GetHash();
+    nLastPaidHeight = nHeight;
+    fCacheStateDirty = true;
+}
+
+void CMasternodeMan::DisconnectLastPaid(const CBlock& block, int nHeight)
+{
+    AssertLockHeld(cs);
+
+    for (const auto& txout : block.vtx[0]->vout) {
+        auto it = mapPayeeLastPaid.find(txout.scriptPubKey);
+        if (it == mapPayeeLastPaid.end() || it->second.back().first != nHeight) continue;
+
+        it->second.pop_back();
+        if (it->second.empty()) {
+            mapPayeeLastPaid.erase(it);
+        }
+        CTxDestination dest;
+        if (ExtractDestination(txout.scriptPubKey, dest)) {
+            SetLastPaid(dest, txout.scriptPubKey);
+        }
+    }
+    hashLastPaidBlock = block.hashPrevBlock;
+    nLastPaidHeight = nHeight - 1;
+    fCacheStateDirty = true;
+}
+
+void CMasternodeMan::PruneLastPaid()
+{
+    AssertLockHeld(cs);
+
+    std::set<CScript> setPayees;
+    for (const auto& mnpair : mapMasternodes) {
+        setPayees.insert(GetScriptForDestination(mnpair.second.collDest));
+    }
+    int nPruneHeight = nLastPaidHeight - mnpayments.GetStorageLimit();
+    for (auto it = mapPayeeLastPaid.begin(); it != mapPayeeLastPaid.end();) {
+        if (it->second.back().first < nPruneHeight && !setPayees.count(it->first)) {
+            it = mapPayeeLastPaid.erase(it);
+            fCacheStateDirty = true;
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Payees of the coinbase outputs of block at nHeight which got at least
+ * LAST_PAID_MIN_VOTES payment votes. Only these count as paid, so that a miner
+ * paying the masternode amount to a payee of its choice does not move it in
+ * the payment queue.
+ */
+static std::set<CScript> GetVotedPayees(const CBlock& block, int nHeight)
+{
+    static const int LAST_PAID_MIN_VOTES = 2;
+
+    std::set<CScript> setVoted;
+    LOCK(cs_mapMasternodeBlocks);
+    auto it = mnpayments.mapMasternodeBlocks.find(nHeight);
+    if (it == mnpayments.mapMasternodeBlocks.end()) return setVoted;
+    for (const auto& txout : block.vtx[0]->vout) {
+        if (it->second.HasPayeeWithVotes(txout.scriptPubKey, LAST_PAID_MIN_VOTES)) {
+            setVoted.insert(txout.scriptPubKey);
+        }
+    }
+    return setVoted;
+}
+
+void CMasternodeMan::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    const std::set<CScript> setVoted = GetVotedPayees(block, pindex->nHeight);
+
+    LOCK(cs);
+
+    // Spent collaterals are no longer eligible for payment
+    if (!mapCollateralHeight.empty()) {
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const auto& txin : tx->vin) {
+                mapCollateralHeight.erase(txin.prevout);
+            }
+        }
+    }
+
+    // Blocks that do not extend the index are picked up by UpdateLastPaid
+    if (hashLastPaidBlock.IsNull() || block.hashPrevBlock != hashLastPaidBlock) return;
+    ConnectLastPaid(block, setVoted, pindex->nHeight, pindex->GetBlockTime());
+}
+
+void CMasternodeMan::BlockDisconnected(const CBlock& block)
+{
+    LOCK(cs);
+
+    // Collaterals may be confirmed at a different height or not at all on the new chain
+    mapCollateralHeight.clear();
+
+    if (hashLastPaidBlock.IsNull() || block.GetHash() != hashLastPaidBlock) return;
+    DisconnectLastPaid(block, nLastPaidHeight);
+}
+
+void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
+{
+    if (!pindex) return;
+
+    // Payments connected before the payment votes were synced could not be
+    // checked against them, so the window is counted again once they are
+    const bool fVotesSynced = masternodeSync.IsWinnersListSynced();
+
+    int nStartHeight;
+    {
+        LOCK2(cs_main, cs);
+        const bool fRecount = fVotesSynced && !fLastPaidVotesSynced;
+        if (hashLastPaidBlock == pindex->GetBlockHash() && !fRecount) return;
+        fLastPaidVotesSynced = fVotesSynced;
+
+        // Drop payments above the point where the index left the chain of pindex
+        const CBlockIndex* pindexLast = (fRecount || hashLastPaidBlock.IsNull()) ? nullptr : LookupBlockIndex(hashLastPaidBlock);
+        const CBlockIndex* pindexFork = pindexLast ? LastCommonAncestor(pindexLast, pindex) : nullptr;
+        int nForkHeight = pindexFork ? pindexFork->nHeight : -1;
+        if (!pindexFork) {
+            mapPayeeLastPaid.clear();
+        } else if (pindexFork != pindexLast) {
+            for (auto it = mapPayeeLastPaid.begin(); it != mapPayeeLastPaid.end();) {
+                auto& vecPaid = it->second;
+                while (!vecPaid.empty() && vecPaid.back().first > nForkHeight) {
+                    vecPaid.pop_back();
+                }
+                it = vecPaid.empty() ? mapPayeeLastPaid.erase(it) : std::next(it);
+            }
+        }
+
+        // Scan the missing blocks, but no more than mnpayments.GetStorageLimit()
+        nStartHeight = std::max(nForkHeight + 1, pindex->nHeight - mnpayments.GetStorageLimit() + 1);
+        nStartHeight = std::max(nStartHeight, 0);
+
+        LogPrint(BCLog::MNODEPAY, "CMasternodeMan::UpdateLastPaid -- nLastPaidHeight=%d, nForkHeight=%d, scanning %d..%d\n",
+                                nLastPaidHeight, nForkHeight, nStartHeight, pindex->nHeight);
+
+        // The index continues from the block before the scan, BlockConnected
+        // leaves it alone until the scan caught up
+        const CBlockIndex* pindexPrev = nStartHeight > 0 ? pindex->GetAncestor(nStartHeight - 1) : nullptr;
+        hashLastPaidBlock = pindexPrev ? pindexPrev->GetBlockHash() : uint256();
+        nLastPaidHeight = nStartHeight - 1;
+        fCacheStateDirty = true;
+    }
+
+    for (int nHeight = nStartHeight; nHeight <= pindex->nHeight; nHeight++) {
+        const CBlockIndex* pindexBlock = pindex->GetAncestor(nHeight);
+        CBlock block;
+        bool fRead = ReadBlockFromDisk(block, pindexBlock, Params().GetConsensus());
+        if (!fRead) {
+            LogPrintf("CMasternodeMan::UpdateLastPaid -- failed to read block %s\n", pindexBlock->GetBlockHash().ToString());
+        }
+        const std::set<CScript> setVoted = fRead ? GetVotedPayees(block, nHeight) : std::set<CScript>();
+
+        LOCK(cs);
+        const uint256 hashPrev = pindexBlock->pprev ? pindexBlock->pprev->GetBlockHash() : uint256();
+        // Another update moved the index meanwhile, it is left to the next one
+        if (hashLastPaidBlock != hashPrev) return;
+        if (fRead) {
+            ConnectLastPaid(block, setVoted, nHeight, pindexBlock->GetBlockTime());
+        } else {
+            hashLastPaidBlock = pindexBlock->GetBlockHash();
+            nLastPaidHeight = nHeight;
+        }
+    }
+
+    // The payments dropped above may belong to any masternode
+    LOCK(cs);
+    for (auto& mnpair : mapMasternodes) {
+        auto it = mapPayeeLastPaid.find(GetScriptForDestination(mnpair.second.collDest));
+        if (it != mapPayeeLastPaid.end()) {
+            SetMasternodeLastPaid(mnpair.second, it->second.back().first, it->second.back().second);
+        } else {
+            SetMasternodeLastPaid(mnpair.second, 0, 0);
+        }
+    }
 }
 
 void CMasternodeMan::UpdateLastSentinelPingTime()
 {
     LOCK(cs);
     nLastSentinelPingTime = GetTime();
+    fCacheStateDirty = true;
 }
 
 bool CMasternodeMan::IsSentinelPingActive()
@@ -1577,6 +2189,7 @@ bool CMasternodeMan::AddGovernanceVote(const COutPoint& outpoint, uint256 nGover
         return false;
     }
     pmn->AddGovernanceVote(nGovernanceObjectHash);
+    setCacheDirtyMasternodes.insert(outpoint);
     return true;
 }
 
@@ -1584,7 +2197,9 @@ void CMasternodeMan::RemoveGovernanceObject(uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
     for(auto& mnpair : mapMasternodes) {
+        if (!mnpair.second.mapGovernanceObjectsVotedOn.count(nGovernanceObjectHash)) continue;
         mnpair.second.RemoveGovernanceObject(nGovernanceObjectHash);
+        setCacheDirtyMasternodes.insert(mnpair.first);
     }
 }
 
@@ -1593,7 +2208,7 @@ void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForc
     LOCK2(cs_main, cs);
     for (auto& mnpair : mapMasternodes) {
         if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnpair.second.Check(fForce);
+            CheckMasternode(mnpair.second, fForce);
             return;
         }
     }
@@ -1614,16 +2229,12 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
         return;
     }
     pmn->lastPing = mnp;
+    setCacheDirtyMasternodes.insert(outpoint);
     if (mnp.fSentinelIsCurrent) {
         UpdateLastSentinelPingTime();
     }
-    mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
-
-    CMasternodeBroadcast mnb(*pmn);
-    uint256 hash = mnb.GetHash();
-    if (mapSeenMasternodeBroadcast.count(hash)) {
-        mapSeenMasternodeBroadcast[hash].second.lastPing = mnp;
-    }
+    AddSeenMasternodePing(mnp);
+    UpdateSeenMasternodeBroadcastPing(CMasternodeBroadcast(*pmn).GetHash(), mnp);
 }
 
 void CMasternodeMan::UpdatedBlockTip(const CBlockIndex *pindexNew)
@@ -1633,10 +2244,8 @@ void CMasternodeMan::UpdatedBlockTip(const CBlockIndex *pindexNew)
 
     CheckSameAddr();
 
-    if (fMasternodeMode) {
-        // normal wallet does not need to update this every block, doing update on rpc call should be enough
-        UpdateLastPaid(pindexNew);
-    }
+    // Normally a no-op as BlockConnected already advanced the index
+    UpdateLastPaid(pindexNew);
 }
 
 static void AlertNotify(const std::string& strMessage)
@@ -1736,6 +2345,9 @@ void CMasternodeMan::ClientTask(CConnman* connman)
 
     nTick++;
 
+    // queued messages are processed by the message handler, but must not keep disconnected nodes alive
+    mnodeman.ReleaseDisconnectedPendingMessages();
+
     // make sure to check all masternodes first
     mnodeman.Check();
 
@@ -9,11 +9,26 @@
 #include <modules/masternode/masternode.h>
 #include <sync.h>
 
+#include <atomic>
+#include <memory>
+
 class CMasternodeMan;
 class CConnman;
 
 extern CMasternodeMan mnodeman;
 
+/** Worker thread verifying signatures of queued masternode broadcasts and pings */
+void ThreadMasternodeSignatureCheck();
+
+/** A masternode broadcast or ping received from pfrom, queued until its signature is checked */
+struct CPendingMasternodeMessage
+{
+    CNode* pfrom;
+    bool fPing;
+    CMasternodeBroadcast mnb;
+    CMasternodePing mnp;
+};
+
 class CMasternodeMan
 {
 public:
@@ -22,12 +37,19 @@ public:
     typedef std::pair<int, const CMasternode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
 
-private:
+protected:
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int DSEG_UPDATE_SECONDS        = 3 * 60 * 60;
 
-    static const int LAST_PAID_SCAN_BLOCKS;
+    static const int MAX_LAST_PAID_HISTORY      = 10;
+
+    static const int MAX_RANK_CACHE_SIZE        = 10;
+
+    static const int SNAPSHOT_MAX_AGE_SECONDS   = 1;
+
+    static const size_t PENDING_MESSAGES_BATCH  = 64;
+    static const int64_t PENDING_MESSAGES_MAX_WAIT_MS = 1000;
 
     static const int MIN_POSE_PROTO_VERSION     = 70015;
     static const int MAX_POSE_CONNECTIONS       = 10;
@@ -49,6 +71,15 @@ private:
 
     // map to hold all MNs
     std::map<COutPoint, CMasternode> mapMasternodes;
+    // read-only copy of mapMasternodes handed out by GetFullMasternodeMap(), replaced as a whole
+    std::shared_ptr<const std::map<COutPoint, CMasternode> > pmapMasternodesSnapshot;
+    std::atomic<int64_t> nSnapshotTime;
+    // set when masternodes are added or removed so the next reader does not get a stale list
+    std::atomic<bool> fSnapshotStale;
+    // masternodes added, changed or removed since CModuleCacheDB last wrote them
+    std::set<COutPoint> setCacheDirtyMasternodes;
+    // set when the state written to CModuleCacheDB besides the masternodes changed
+    std::atomic<bool> fCacheStateDirty;
     // who's asked for the Masternode list and the last time
     std::map<CService, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -77,11 +108,69 @@ private:
 
     int64_t nLastSentinelPingTime;
 
+    // payee script -> (height, time) of its most recent masternode payments, oldest first,
+    // kept up to date from the coinbase of every connected and disconnected block
+    std::map<CScript, std::vector<std::pair<int, int64_t> > > mapPayeeLastPaid;
+    // the last block applied to mapPayeeLastPaid
+    uint256 hashLastPaidBlock;
+    int nLastPaidHeight;
+    // memory only: set once mapPayeeLastPaid was rebuilt with the payment votes synced
+    bool fLastPaidVotesSynced;
+
+    // score rankings of recently asked for (block hash, min protocol) pairs, most recently used first.
+    // The pointers reference mapMasternodes, every addition and removal is applied to all entries.
+    std::list<std::pair<std::pair<uint256, int>, score_pair_vec_t> > listRankCache;
+
+    // (last paid block, outpoint) of every masternode, i.e. the order in which they are due for payment
+    std::set<std::pair<int, COutPoint> > setPaymentQueue;
+    // height of the block confirming the collateral of a masternode, looked up once in pcoinsTip
+    // and forgotten when the collateral is spent or blocks are disconnected
+    std::map<COutPoint, int> mapCollateralHeight;
+
+    // protects mapSeenMasternodeBroadcast and mapSeenMasternodePing only, always taken after cs and held briefly
+    mutable CCriticalSection cs_mapSeenMessages;
+    // Keep track of all broadcasts I've seen
+    std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
+    // Keep track of all pings I've seen
+    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+
+    // broadcasts and pings in order of arrival, the nodes they came from are referenced
+    std::vector<CPendingMasternodeMessage> vecPendingMessages;
+    // time the first message of vecPendingMessages was queued
+    int64_t nPendingMessagesTime;
+    CCriticalSection cs_vecPendingMessages;
+    // held while a batch is verified and applied, so batches are applied in order
+    CCriticalSection cs_processPendingMessages;
+
     friend class CMasternodeSync;
+    friend class CModuleCacheDB;
     /// Find an entry
     CMasternode* Find(const COutPoint& outpoint);
-
-    bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    /// Check an entry, marking it for the module cache if its state changed
+    void CheckMasternode(CMasternode& mn, bool fForce = false);
+
+    /// Apply the masternode payments of a connected or disconnected block to mapPayeeLastPaid,
+    /// only payments to the payees in setVoted are counted when connecting
+    void ConnectLastPaid(const CBlock& block, const std::set<CScript>& setVoted, int nHeight, int64_t nTime);
+    void DisconnectLastPaid(const CBlock& block, int nHeight);
+    /// Forget the payments of payees no masternode pays to, once they fell out of the payment window
+    void PruneLastPaid();
+    /// Copy the indexed last payment of a payee into the masternodes paying to it
+    void SetLastPaid(const CTxDestination& dest, const CScript& payee);
+    /// Change the last payment of a masternode, keeping its place in setPaymentQueue
+    void SetMasternodeLastPaid(CMasternode& mn, int nHeight, int64_t nTime);
+    /// Height of the block confirming the collateral at outpoint, -1 if it is not in the UTXO set
+    int GetCollateralHeight(const COutPoint& outpoint);
+
+    /// Masternodes sorted by score for nBlockHash, best first, or nullptr if there are none.
+    /// The result is cached and stays valid until cs is released.
+    const score_pair_vec_t* GetMasternodeScores(const uint256& nBlockHash, int nMinProtocol = 0);
+    /// Keep listRankCache in step with mapMasternodes
+    void RankCacheAdd(const CMasternode& mn);
+    void RankCacheRemove(const CMasternode& mn);
+
+    void ProcessMasternodeBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb, CConnman* connman);
+    void ProcessMasternodePing(CNode* pfrom, CMasternodePing& mnp, CConnman* connman);
 
     void SyncSingle(CNode* pnode, const COutPoint& outpoint);
     void SyncAll(CNode* pnode, CConnman* connman);
@@ -89,10 +178,6 @@ private:
     void PushDsegInvs(CNode* pnode, const CMasternode& mn);
 
 public:
-    // Keep track of all broadcasts I've seen
-    std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
     // Keep track of all verifications I've seen
     std::map<uint256, CMasternodeVerification> mapSeenMasternodeVerification;
 
@@ -110,7 +195,25 @@ public:
             READWRITE(strVersion);
         }
 
-        READWRITE(mapMasternodes);
+        if (!(s.GetType() & SER_MODULECACHE)) {
+            READWRITE(mapMasternodes);
+        }
+        if (ser_action.ForRead()) {
+            fSnapshotStale = true;
+            listRankCache.clear();
+            setPaymentQueue.clear();
+            for (const auto& mnpair : mapMasternodes) {
+                setPaymentQueue.emplace(mnpair.second.nBlockLastPaid, mnpair.first);
+            }
+            mapCollateralHeight.clear();
+            // everything read from mncache.dat goes to the module cache on the next flush
+            if (!(s.GetType() & SER_MODULECACHE)) {
+                for (const auto& mnpair : mapMasternodes) {
+                    setCacheDirtyMasternodes.insert(mnpair.first);
+                }
+                fCacheStateDirty = true;
+            }
+        }
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -118,8 +221,14 @@ public:
         READWRITE(mMnbRecoveryGoodReplies);
         READWRITE(nLastSentinelPingTime);
 
-        READWRITE(mapSeenMasternodeBroadcast);
-        READWRITE(mapSeenMasternodePing);
+        {
+            LOCK(cs_mapSeenMessages);
+            READWRITE(mapSeenMasternodeBroadcast);
+            READWRITE(mapSeenMasternodePing);
+        }
+        READWRITE(mapPayeeLastPaid);
+        READWRITE(hashLastPaidBlock);
+        READWRITE(nLastPaidHeight);
         if (ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
@@ -175,7 +284,9 @@ public:
     /// Find a random entry
     masternode_info_t FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion = -1);
 
-    std::map<COutPoint, CMasternode> GetFullMasternodeMap() { return mapMasternodes; }
+    /// Consistent copy of all masternodes, at most SNAPSHOT_MAX_AGE_SECONDS old. Shared between
+    /// readers, so it is only copied again after it has aged or masternodes were added or removed.
+    std::shared_ptr<const std::map<COutPoint, CMasternode> > GetFullMasternodeMap();
 
     bool GetMasternodeRanks(rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
     bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
@@ -201,6 +312,19 @@ public:
     bool CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBroadcast mnb, int& nDos, CConnman* connman);
     bool IsMnbRecoveryRequested(const uint256& hash) { return mMnbRecoveryRequests.count(hash); }
 
+    /// Access to the broadcasts and pings we have seen, safe to use without holding cs
+    bool HasSeenMasternodeBroadcast(const uint256& hash) const;
+    bool GetSeenMasternodeBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet) const;
+    void RemoveSeenMasternodeBroadcast(const uint256& hash);
+    /// Replace the ping stored with a seen broadcast, which is probably outdated
+    void UpdateSeenMasternodeBroadcastPing(const uint256& hash, const CMasternodePing& mnp);
+    bool HasSeenMasternodePing(const uint256& hash) const;
+    bool GetSeenMasternodePing(const uint256& hash, CMasternodePing& mnpRet) const;
+    /// Returns false if the ping was already known
+    bool AddSeenMasternodePing(const CMasternodePing& mnp);
+
+    /// Bring the last paid index up to pindex, rescanning blocks it missed while not running.
+    /// Blocks are read and voted payees looked up without holding cs_main or cs.
     void UpdateLastPaid(const CBlockIndex* pindex);
 
     void AddDirtyGovernanceObjectHash(const uint256& nHash)
@@ -236,7 +360,18 @@ public:
     void NotifyMasternodeUpdates(CConnman* connman);
 
     void ProcessModuleMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
+    /// Verify the signatures of all queued broadcasts and pings in parallel, then process them in order.
+    /// Message handler thread only.
+    void ProcessPendingMessages(CConnman* connman);
+    /// Same as above, once a full batch is queued or the oldest message waited PENDING_MESSAGES_MAX_WAIT_MS
+    void ProcessPendingMessagesIfDue(CConnman* connman);
+    /// Drop the queued messages of the node, releasing the references held on it
+    void ReleasePendingMessages(NodeId nodeid);
+    /// Drop the queued messages of disconnected nodes, so they can be deleted
+    void ReleaseDisconnectedPendingMessages();
     void UpdatedBlockTip(const CBlockIndex *pindexNew);
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block);
 
     void ClientTask(CConnman* connman);
     void Controller(CScheduler& scheduler, CConnman* connman);
@@ -188,7 +188,14 @@ std::string GetRequiredPaymentsString(int nBlockHeight)
 void CMasternodePayments::Clear()
 {
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+    for (const auto& p : mapMasternodeBlocks) {
+        setCacheDirtyBlocks.insert(p.first);
+    }
+    for (const auto& p : mapMasternodePaymentVotes) {
+        setCacheDirtyVotes.insert(p.first);
+    }
     mapMasternodeBlocks.clear();
+    setLowDataHeights.clear();
     mapMasternodePaymentVotes.clear();
 }
 
@@ -304,6 +311,7 @@ void CMasternodePayments::ProcessModuleMessage(CNode* pfrom, const std::string&
             // Mark vote as non-verified when it's seen for the first time,
             // AddOrUpdatePaymentVote() below should take care of it if vote is actually ok
             res.first->second.MarkAsNotVerified();
+            setCacheDirtyVotes.insert(nHash);
         }
 
         int nFirstBlock = nCachedBlockHeight - GetStorageLimit();
@@ -427,6 +435,24 @@ bool CMasternodePayments::IsScheduled(const masternode_info_t& mnInfo, int nNotB
     return false;
 }
 
+std::set<CScript> CMasternodePayments::GetScheduledPayees(int nNotBlockHeight) const
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    std::set<CScript> setPayees;
+    if (!masternodeSync.IsMasternodeListSynced()) return setPayees;
+
+    CScript payee;
+    for(int64_t h = nCachedBlockHeight; h <= nCachedBlockHeight + 8; h++){
+        if (h == nNotBlockHeight) continue;
+        if (GetBlockPayee(h, payee)) {
+            setPayees.insert(payee);
+        }
+    }
+
+    return setPayees;
+}
+
 bool CMasternodePayments::AddOrUpdatePaymentVote(const CMasternodePaymentVote& vote)
 {
     uint256 blockHash = uint256();
@@ -439,9 +465,16 @@ bool CMasternodePayments::AddOrUpdatePaymentVote(const CMasternodePaymentVote& v
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
 
     mapMasternodePaymentVotes[nVoteHash] = vote;
+    setCacheDirtyVotes.insert(nVoteHash);
 
     auto it = mapMasternodeBlocks.emplace(vote.nBlockHeight, CMasternodeBlockPayees(vote.nBlockHeight)).first;
     it->second.AddPayee(vote);
+    setCacheDirtyBlocks.insert(vote.nBlockHeight);
+    if (it->second.IsLowData()) {
+        setLowDataHeights.insert(vote.nBlockHeight);
+    } else {
+        setLowDataHeights.erase(vote.nBlockHeight);
+    }
 
     LogPrint(BCLog::MNODEPAY, "CMasternodePayments::AddOrUpdatePaymentVote -- added, hash=%s\n", nVoteHash.ToString());
 
@@ -461,43 +494,51 @@ void CMasternodeBlockPayees::AddPayee(const CMasternodePaymentVote& vote)
 
     uint256 nVoteHash = vote.GetHash();
 
-    for (auto& payee : vecPayees) {
-        if (payee.GetPayee() == vote.payee) {
-            payee.AddVoteHash(nVoteHash);
+    nTotalVotes++;
+    for (size_t i = 0; i < vecPayees.size(); i++) {
+        if (vecPayees[i].GetPayee() == vote.payee) {
+            vecPayees[i].AddVoteHash(nVoteHash);
+            UpdateTallies(i);
             return;
         }
     }
     CMasternodePayee payeeNew(vote.payee, nVoteHash);
     vecPayees.push_back(payeeNew);
+    UpdateTallies(vecPayees.size() - 1);
+}
+
+void CMasternodeBlockPayees::UpdateTallies(int nPayee)
+{
+    // the earliest payee wins a tie, as it always has
+    int nVotes = vecPayees[nPayee].GetVoteCount();
+    if (nBestPayee == -1 || nVotes > nBestVotes || (nVotes == nBestVotes && nPayee < nBestPayee)) {
+        nBestVotes = nVotes;
+        nBestPayee = nPayee;
+    }
 }
 
 bool CMasternodeBlockPayees::GetBestPayee(CScript& payeeRet) const
 {
     LOCK(cs_vecPayees);
 
-    if (vecPayees.empty()) {
+    if (nBestPayee == -1) {
         LogPrint(BCLog::MNODEPAY, "CMasternodeBlockPayees::GetBestPayee -- ERROR: couldn't find any payee\n");
         return false;
     }
 
-    int nVotes = -1;
-    for (const auto& payee : vecPayees) {
-        if (payee.GetVoteCount() > nVotes) {
-            payeeRet = payee.GetPayee();
-            nVotes = payee.GetVoteCount();
-        }
-    }
-
-    return (nVotes > -1);
+    payeeRet = vecPayees[nBestPayee].GetPayee();
+    return true;
 }
 
 bool CMasternodeBlockPayees::HasPayeeWithVotes(const CScript& payeeIn, int nVotesReq) const
 {
     LOCK(cs_vecPayees);
 
-    for (const auto& payee : vecPayees) {
-        if (payee.GetVoteCount() >= nVotesReq && payee.GetPayee() == payeeIn) {
-            return true;
+    if (nBestVotes >= nVotesReq) {
+        for (const auto& payee : vecPayees) {
+            if (payee.GetVoteCount() >= nVotesReq && payee.GetPayee() == payeeIn) {
+                return true;
+            }
         }
     }
 
@@ -509,21 +550,14 @@ bool CMasternodeBlockPayees::IsTransactionValid(const CTransactionRef& txNew) co
 {
     LOCK(cs_vecPayees);
 
-    int nMaxSignatures = 0;
     std::string strPayeesPossible = "";
 
-    CAmount nMasternodePayment = GetMasternodePayment(nBlockHeight, txNew->GetValueOut());
-
     //require at least MNPAYMENTS_SIGNATURES_REQUIRED signatures
 
-    for (const auto& payee : vecPayees) {
-        if (payee.GetVoteCount() >= nMaxSignatures) {
-            nMaxSignatures = payee.GetVoteCount();
-        }
-    }
-
     // if we don't have at least MNPAYMENTS_SIGNATURES_REQUIRED signatures on a payee, approve whichever is the longest chain
-    if (nMaxSignatures < MNPAYMENTS_SIGNATURES_REQUIRED) return true;
+    if (!HasClearWinner()) return true;
+
+    CAmount nMasternodePayment = GetMasternodePayment(nBlockHeight, txNew->GetValueOut());
 
     for (const auto& payee : vecPayees) {
         if (payee.GetVoteCount() >= MNPAYMENTS_SIGNATURES_REQUIRED) {
@@ -602,8 +636,12 @@ void CMasternodePayments::CheckAndRemove()
 
         if (nCachedBlockHeight - vote.nBlockHeight > nLimit) {
             LogPrint(BCLog::MNODEPAY, "CMasternodePayments::CheckAndRemove -- Removing old Masternode payment: nBlockHeight=%d\n", vote.nBlockHeight);
+            setCacheDirtyVotes.insert(it->first);
             mapMasternodePaymentVotes.erase(it++);
-            mapMasternodeBlocks.erase(vote.nBlockHeight);
+            if (mapMasternodeBlocks.erase(vote.nBlockHeight)) {
+                setCacheDirtyBlocks.insert(vote.nBlockHeight);
+            }
+            setLowDataHeights.erase(vote.nBlockHeight);
         } else {
             ++it;
         }
@@ -740,33 +778,30 @@ void CMasternodePayments::CheckBlockVotes(int nBlockHeight)
 
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
 
-    int i{0};
-    for (const auto& mn : mns) {
-        CScript payee;
-        bool found = false;
-
-        const auto it = mapMasternodeBlocks.find(nBlockHeight);
-        if (it != mapMasternodeBlocks.end()) {
-            for (const auto& p : it->second.vecPayees) {
-                for (const auto& voteHash : p.GetVoteHashes()) {
-                    const auto itVote = mapMasternodePaymentVotes.find(voteHash);
-                    if (itVote == mapMasternodePaymentVotes.end()) {
-                        debugStr += strprintf("    - could not find vote %s\n",
-                                              voteHash.ToString());
-                        continue;
-                    }
-                    if (itVote->second.masternodeOutpoint == mn.second.outpoint) {
-                        payee = itVote->second.payee;
-                        found = true;
-                        break;
-                    }
+    // who voted for whom at this height, looked up once instead of for every expected voter
+    std::map<COutPoint, CScript> mapVoters;
+    const auto it = mapMasternodeBlocks.find(nBlockHeight);
+    if (it != mapMasternodeBlocks.end()) {
+        for (const auto& p : it->second.vecPayees) {
+            for (const auto& voteHash : p.GetVoteHashes()) {
+                const auto itVote = mapMasternodePaymentVotes.find(voteHash);
+                if (itVote == mapMasternodePaymentVotes.end()) {
+                    debugStr += strprintf("    - could not find vote %s\n",
+                                          voteHash.ToString());
+                    continue;
                 }
+                mapVoters.emplace(itVote->second.masternodeOutpoint, itVote->second.payee);
             }
         }
+    }
+
+    int i{0};
+    for (const auto& mn : mns) {
+        const auto itVoter = mapVoters.find(mn.second.outpoint);
 
-        if (found) {
+        if (itVoter != mapVoters.end()) {
             CTxDestination address;
-            ExtractDestination(payee, address);
+            ExtractDestination(itVoter->second, address);
 
             debugStr += strprintf("    - %s - voted for %s\n",
                                   mn.second.outpoint.ToStringShort(), EncodeDestination(address));
@@ -897,25 +932,9 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman* co
         pindex = pindex->pprev;
     }
 
-    for (auto& mnBlockPayees : mapMasternodeBlocks) {
-        int nBlockHeight = mnBlockPayees.first;
-        int nTotalVotes = 0;
-        bool fFound = false;
-        for (const auto& payee : mnBlockPayees.second.vecPayees) {
-            if (payee.GetVoteCount() >= MNPAYMENTS_SIGNATURES_REQUIRED) {
-                fFound = true;
-                break;
-            }
-            nTotalVotes += payee.GetVoteCount();
-        }
-        // A clear winner (MNPAYMENTS_SIGNATURES_REQUIRED+ votes) was found
-        // or no clear winner was found but there are at least avg number of votes
-        if (fFound || nTotalVotes >= (MNPAYMENTS_SIGNATURES_TOTAL + MNPAYMENTS_SIGNATURES_REQUIRED)/2) {
-            // so just move to the next block
-            continue;
-        }
-
-        // Low data block found, let's try to sync it
+    // Blocks with neither a clear winner (MNPAYMENTS_SIGNATURES_REQUIRED+ votes)
+    // nor at least the avg number of votes, let's try to sync them
+    for (const int nBlockHeight : setLowDataHeights) {
         uint256 hash;
         if (mnodeman.HasBlockHash(hash, nBlockHeight)) {
             vToFetch.push_back(CInv(MSG_MASTERNODE_PAYMENT_BLOCK, hash));
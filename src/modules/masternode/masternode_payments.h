@@ -25,6 +25,7 @@ static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION = 70015;
 
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
+extern CCriticalSection cs_mapMasternodePaymentVotes;
 
 extern CMasternodePayments mnpayments;
 
@@ -71,15 +72,30 @@ public:
 // Keep track of votes for payees from masternodes
 class CMasternodeBlockPayees
 {
+private:
+    // Vote tallies, kept up to date by AddPayee so lookups don't rescan vecPayees
+    int nTotalVotes;
+    int nBestVotes;
+    // index into vecPayees of the first payee with nBestVotes votes, -1 if there are none
+    int nBestPayee;
+
+    void UpdateTallies(int nPayee);
+
 public:
     int nBlockHeight;
     std::vector<CMasternodePayee> vecPayees;
 
     CMasternodeBlockPayees() :
+        nTotalVotes(0),
+        nBestVotes(0),
+        nBestPayee(-1),
         nBlockHeight(0),
         vecPayees()
         {}
     CMasternodeBlockPayees(int nBlockHeightIn) :
+        nTotalVotes(0),
+        nBestVotes(0),
+        nBestPayee(-1),
         nBlockHeight(nBlockHeightIn),
         vecPayees()
         {}
@@ -90,12 +106,27 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action) {
         READWRITE(nBlockHeight);
         READWRITE(vecPayees);
+        if (ser_action.ForRead()) {
+            nTotalVotes = 0;
+            nBestVotes = 0;
+            nBestPayee = -1;
+            for (size_t i = 0; i < vecPayees.size(); i++) {
+                nTotalVotes += vecPayees[i].GetVoteCount();
+                UpdateTallies(i);
+            }
+        }
     }
 
     void AddPayee(const CMasternodePaymentVote& vote);
     bool GetBestPayee(CScript& payeeRet) const;
     bool HasPayeeWithVotes(const CScript& payeeIn, int nVotesReq) const;
 
+    int GetTotalVotes() const { return nTotalVotes; }
+    /// Some payee has MNPAYMENTS_SIGNATURES_REQUIRED or more votes
+    bool HasClearWinner() const { return nBestVotes >= MNPAYMENTS_SIGNATURES_REQUIRED; }
+    /// No clear winner and fewer votes than an average block, worth asking peers for more
+    bool IsLowData() const { return !HasClearWinner() && nTotalVotes < (MNPAYMENTS_SIGNATURES_TOTAL + MNPAYMENTS_SIGNATURES_REQUIRED) / 2; }
+
     bool IsTransactionValid(const CTransactionRef &txNew) const;
 
     std::string GetRequiredPaymentsString() const;
@@ -173,6 +204,12 @@ public:
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
     std::map<COutPoint, int> mapMasternodesLastVote;
     std::map<COutPoint, int> mapMasternodesDidNotVote;
+    // heights in mapMasternodeBlocks which are IsLowData(), guarded by cs_mapMasternodeBlocks
+    std::set<int> setLowDataHeights;
+    // votes and blocks added, changed or removed since CModuleCacheDB last wrote them,
+    // guarded by cs_mapMasternodePaymentVotes and cs_mapMasternodeBlocks
+    std::set<uint256> setCacheDirtyVotes;
+    std::set<int> setCacheDirtyBlocks;
 
     CMasternodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(5000) {}
 
@@ -180,8 +217,25 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(mapMasternodePaymentVotes);
-        READWRITE(mapMasternodeBlocks);
+        if (!(s.GetType() & SER_MODULECACHE)) {
+            READWRITE(mapMasternodePaymentVotes);
+            READWRITE(mapMasternodeBlocks);
+        }
+        if (ser_action.ForRead()) {
+            setLowDataHeights.clear();
+            for (const auto& p : mapMasternodeBlocks) {
+                if (p.second.IsLowData()) setLowDataHeights.insert(p.first);
+            }
+            // everything read from mnpayments.dat goes to the module cache on the next flush
+            if (!(s.GetType() & SER_MODULECACHE)) {
+                for (const auto& p : mapMasternodePaymentVotes) {
+                    setCacheDirtyVotes.insert(p.first);
+                }
+                for (const auto& p : mapMasternodeBlocks) {
+                    setCacheDirtyBlocks.insert(p.first);
+                }
+            }
+        }
     }
 
     void Clear();
@@ -198,6 +252,8 @@ public:
     bool GetBlockPayee(int nBlockHeight, CScript& payeeRet) const;
     bool IsTransactionValid(const CTransactionRef& txNew, int nBlockHeight) const;
     bool IsScheduled(const masternode_info_t& mnInfo, int nNotBlockHeight) const;
+    /// Payees IsScheduled() would match, to test many masternodes at once
+    std::set<CScript> GetScheduledPayees(int nNotBlockHeight) const;
 
     bool UpdateLastVote(const CMasternodePaymentVote& vote);
 
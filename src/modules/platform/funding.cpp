@@ -23,7 +23,7 @@ CGovernanceManager funding;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-12";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-13";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60*60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 
@@ -31,6 +31,9 @@ CGovernanceManager::CGovernanceManager()
     : nTimeLastDiff(0),
       nCachedBlockHeight(0),
       mapObjects(),
+      setCacheDirtyObjects(),
+      setCacheErasedVotes(),
+      fCacheStateDirty(false),
       mapErasedGovernanceObjects(),
       mapMasternodeOrphanObjects(),
       cmapVoteToObject(MAX_CACHE_SIZE),
@@ -112,6 +115,10 @@ void CGovernanceManager::ProcessModuleMessage(CNode* pfrom, const std::string& s
 
         if(nProp == uint256()) {
             SyncAll(pfrom, connman);
+        } else if(pfrom->GetSendVersion() >= GOVERNANCE_VOTE_FILTER_VERSION) {
+            CGovernanceVoteFilter filter;
+            vRecv >> filter;
+            SyncSingleObjAndItsVotes(pfrom, nProp, filter, connman);
         } else {
             CBloomFilter filter;
             vRecv >> filter;
@@ -274,6 +281,7 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
         }
         if(fRemove) {
             cmmapOrphanVotes.Erase(nHash, pairVote);
+            fCacheStateDirty = true;
         }
     }
 }
@@ -307,6 +315,7 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         LogPrintf("CGovernanceManager::AddGovernanceObject -- already have funding object %s\n", nHash.ToString());
         return;
     }
+    setCacheDirtyObjects.insert(nHash);
 
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANANGERS?
 
@@ -353,8 +362,20 @@ void CGovernanceManager::UpdateCachesAndClean()
         if(it == mapObjects.end()) {
             continue;
         }
-        it->second.ClearMasternodeVotes();
+        const auto itVoteHashes = mapObjectVoteHashes.find(it->first);
+        std::vector<uint256> vecDiskRemoved;
+        for (const auto& nHashVote : it->second.ClearMasternodeVotes(vecDiskRemoved)) {
+            cmapVoteToObject.Erase(nHashVote);
+            if (itVoteHashes != mapObjectVoteHashes.end()) {
+                itVoteHashes->second.erase(nHashVote);
+            }
+        }
+        if (itVoteHashes != mapObjectVoteHashes.end() && itVoteHashes->second.empty()) {
+            mapObjectVoteHashes.erase(itVoteHashes);
+        }
+        setCacheErasedVotes.insert(vecDiskRemoved.begin(), vecDiskRemoved.end());
         it->second.fDirtyCache = true;
+        setCacheDirtyObjects.insert(it->first);
     }
 
     ScopedLockBool guard(cs, fRateChecksEnabled, false);
@@ -383,7 +404,11 @@ void CGovernanceManager::UpdateCachesAndClean()
             pObj->UpdateLocalValidity();
 
             // UPDATE SENTINEL SIGNALING VARIABLES
+            int64_t nDeletionTimePrev = pObj->nDeletionTime;
             pObj->UpdateSentinelVariables();
+            if (pObj->nDeletionTime != nDeletionTimePrev) {
+                setCacheDirtyObjects.insert(nHash);
+            }
         }
 
         // IF DELETE=TRUE, THEN CLEAN THE MESS UP!
@@ -397,19 +422,17 @@ void CGovernanceManager::UpdateCachesAndClean()
            (nTimeSinceDeletion >= GOVERNANCE_DELETION_DELAY)) {
             LogPrintf("CGovernanceManager::UpdateCachesAndClean -- erase obj %s\n", (*it).first.ToString());
             mnodeman.RemoveGovernanceObject(pObj->GetHash());
+            for (const auto& nHashVote : pObj->fileVotes.GetDiskVoteHashes()) {
+                setCacheErasedVotes.insert(nHashVote);
+            }
 
             // Remove vote references
-            const CacheMap<uint256, CGovernanceObject*>::list_t& listItems = cmapVoteToObject.GetItemList();
-            CacheMap<uint256, CGovernanceObject*>::list_cit lit = listItems.begin();
-            while(lit != listItems.end()) {
-                if(lit->value == pObj) {
-                    uint256 nKey = lit->key;
-                    ++lit;
-                    cmapVoteToObject.Erase(nKey);
-                }
-                else {
-                    ++lit;
+            const auto itVoteHashes = mapObjectVoteHashes.find(nHash);
+            if(itVoteHashes != mapObjectVoteHashes.end()) {
+                for(const auto& nHashVote : itVoteHashes->second) {
+                    cmapVoteToObject.Erase(nHashVote);
                 }
+                mapObjectVoteHashes.erase(itVoteHashes);
             }
 
             int64_t nTimeExpired{0};
@@ -425,6 +448,8 @@ void CGovernanceManager::UpdateCachesAndClean()
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
             mapObjects.erase(it++);
+            setCacheDirtyObjects.insert(nHash);
+            fCacheStateDirty = true;
         } else {
             // NOTE: triggers are handled via triggerman
             if (pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
@@ -434,6 +459,7 @@ void CGovernanceManager::UpdateCachesAndClean()
                     pObj->fCachedDelete = true;
                     if (pObj->nDeletionTime == 0) {
                         pObj->nDeletionTime = nNow;
+                        setCacheDirtyObjects.insert(nHash);
                     }
                 }
             }
@@ -444,9 +470,10 @@ void CGovernanceManager::UpdateCachesAndClean()
     // forget about expired deleted objects
     std::map<uint256, int64_t>::const_iterator s_it = mapErasedGovernanceObjects.begin();
     while(s_it != mapErasedGovernanceObjects.end()) {
-        if(s_it->second < nNow)
+        if(s_it->second < nNow) {
             mapErasedGovernanceObjects.erase(s_it++);
-        else
+            fCacheStateDirty = true;
+        } else
             ++s_it;
     }
 
@@ -486,27 +513,28 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     if(it == mapObjects.end()) return vecResult;
     const CGovernanceObject& govobj = it->second;
 
-    CMasternode mn;
-    std::map<COutPoint, CMasternode> mapMasternodes;
-    if(mnCollateralOutpointFilter.IsNull()) {
-        mapMasternodes = mnodeman.GetFullMasternodeMap();
-    } else if (mnodeman.Get(mnCollateralOutpointFilter, mn)) {
-        mapMasternodes[mnCollateralOutpointFilter] = mn;
+    // Only the masternodes which voted on the object are looked up
+    CGovernanceObject::vote_m_t mapVotes;
+    if (mnCollateralOutpointFilter.IsNull()) {
+        mapVotes = govobj.GetCurrentMNVotes();
+    } else {
+        vote_rec_t voteRecord;
+        if (govobj.GetCurrentMNVotes(mnCollateralOutpointFilter, voteRecord)) {
+            mapVotes.emplace(mnCollateralOutpointFilter, voteRecord);
+        }
     }
 
     // Loop thru each MN collateral outpoint and get the votes for the `nParentHash` funding object
-    for (const auto& mnpair : mapMasternodes)
+    for (const auto& votepair : mapVotes)
     {
-        // get a vote_rec_t from the govobj
-        vote_rec_t voteRecord;
-        if (!govobj.GetCurrentMNVotes(mnpair.first, voteRecord)) continue;
+        if (!mnodeman.Has(votepair.first)) continue;
 
-        for (const auto& voteInstancePair : voteRecord.mapInstances) {
+        for (const auto& voteInstancePair : votepair.second.mapInstances) {
             int signal = voteInstancePair.first;
             int outcome = voteInstancePair.second.eOutcome;
             int64_t nCreationTime = voteInstancePair.second.nCreationTime;
 
-            CGovernanceVote vote = CGovernanceVote(mnpair.first, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
+            CGovernanceVote vote = CGovernanceVote(votepair.first, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
             vote.SetTime(nCreationTime);
 
             vecResult.push_back(vote);
@@ -618,6 +646,27 @@ bool CGovernanceManager::ConfirmInventoryRequest(const CInv& inv)
 }
 
 void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, CConnman* connman)
+{
+    SyncObjectAndMissingVotes(pnode, nProp, [&filter](const std::vector<uint256>& vecVoteHashes) {
+        std::vector<uint256> vecMissing;
+        for (const auto& nVoteHash : vecVoteHashes) {
+            if(!filter.contains(nVoteHash)) {
+                vecMissing.push_back(nVoteHash);
+            }
+        }
+        return vecMissing;
+    }, connman);
+}
+
+void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CGovernanceVoteFilter& filter, CConnman* connman)
+{
+    SyncObjectAndMissingVotes(pnode, nProp, [&filter](const std::vector<uint256>& vecVoteHashes) {
+        return filter.GetMissing(vecVoteHashes);
+    }, connman);
+}
+
+void CGovernanceManager::SyncObjectAndMissingVotes(CNode* pnode, const uint256& nProp,
+                                                   const std::function<std::vector<uint256>(const std::vector<uint256>&)>& fnMissing, CConnman* connman)
 {
     // do not provide any data until our node is synced
     if(!masternodeSync.IsSynced()) return;
@@ -651,11 +700,17 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
     LogPrint(BCLog::GOV, "CGovernanceManager::%s -- syncing govobj: %s, peer=%d\n", __func__, strHash, pnode->GetId());
     pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
 
-    auto fileVotes = govobj.GetVoteFile();
+    const auto& fileVotes = govobj.GetVoteFile();
 
-    for (const auto& vote : fileVotes.GetVotes()) {
-        uint256 nVoteHash = vote.GetHash();
-        if(filter.contains(nVoteHash) || !vote.IsValid(true)) {
+    // only the votes the peer is missing are read, each spilled one is a read from the module cache database
+    for (const auto& nVoteHash : fnMissing(fileVotes.GetVoteHashes())) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        if(!fileVotes.SerializeVoteToStream(nVoteHash, ss)) {
+            continue;
+        }
+        CGovernanceVote vote;
+        ss >> vote;
+        if(!vote.IsValid(true)) {
             continue;
         }
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
@@ -737,6 +792,7 @@ void CGovernanceManager::MasternodeRateUpdate(const CGovernanceObject& govobj)
     }
 
     it->second.fStatusOK = true;
+    fCacheStateDirty = true;
 }
 
 bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, bool fUpdateFailStatus)
@@ -807,8 +863,10 @@ bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, bo
     LogPrintf("CGovernanceManager::MasternodeRateCheck -- Rate too high: object hash = %s, masternode = %s, object timestamp = %d, rate = %f, max rate = %f\n",
               strHash, masternodeOutpoint.ToStringShort(), nTimestamp, dRate, dMaxRate);
 
-    if (fUpdateFailStatus)
+    if (fUpdateFailStatus) {
         it->second.fStatusOK = false;
+        fCacheStateDirty = true;
+    }
 
     return false;
 }
@@ -843,6 +901,7 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
              + vote.GetMasternodeOutpoint().ToStringShort());
         exception = CGovernanceException(strResult, GOVERNANCE_EXCEPTION_WARNING);
         if(cmmapOrphanVotes.Insert(nHashGovobj, vote_time_pair_t(vote, GetAdjustedTime() + GOVERNANCE_ORPHAN_EXPIRATION_TIME))) {
+            fCacheStateDirty = true;
             LEAVE_CRITICAL_SECTION(cs);
             RequestGovernanceObject(pfrom, nHashGovobj, connman);
             LogPrintf("%s\n", strResult);
@@ -862,8 +921,9 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         return false;
     }
 
-    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && CacheVoteToObject(nHashVote, nHashGovobj, govobj);
     if (fOk) {
+        setCacheDirtyObjects.insert(nHashGovobj);
         uiInterface.NotifyProposalChanged(govobj.GetHash(), CT_UPDATED);
     }
     LEAVE_CRITICAL_SECTION(cs);
@@ -877,7 +937,11 @@ void CGovernanceManager::CheckMasternodeOrphanVotes(CConnman* connman)
     ScopedLockBool guard(cs, fRateChecksEnabled, false);
 
     for (auto& objPair : mapObjects) {
+        int nVoteCountPrev = objPair.second.GetVoteFile().GetVoteCount();
         objPair.second.CheckOrphanVotes(connman);
+        if (objPair.second.GetVoteFile().GetVoteCount() != nVoteCountPrev) {
+            setCacheDirtyObjects.insert(objPair.first);
+        }
     }
 }
 
@@ -994,25 +1058,39 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
     CNetMsgMaker msgMaker(pfrom->GetSendVersion());
 
-    CBloomFilter filter;
-    filter.clear();
-
-    int nVoteCount = 0;
+    bool fHaveObject = false;
+    std::vector<uint256> vecVoteHashes;
     if(fUseFilter) {
         LOCK(cs);
         CGovernanceObject* pObj = FindGovernanceObject(nHash);
 
         if(pObj) {
-            filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            nVoteCount = vecVotes.size();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                filter.insert(vecVotes[i].GetHash());
-            }
+            fHaveObject = true;
+            vecVoteHashes = pObj->GetVoteFile().GetVoteHashes();
+        }
+    }
+
+    LogPrint(BCLog::GOV, "CGovernanceManager::RequestGovernanceObject -- nHash %s nVoteCount %d peer=%d\n", nHash.ToString(), vecVoteHashes.size(), pfrom->GetId());
+
+    if(pfrom->GetSendVersion() >= GOVERNANCE_VOTE_FILTER_VERSION) {
+        CGovernanceVoteFilter filter;
+        if(fHaveObject) {
+            filter = CGovernanceVoteFilter(vecVoteHashes);
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCESYNC, nHash, filter));
+        return;
+    }
+
+    CBloomFilter filter;
+    filter.clear();
+
+    if(fHaveObject) {
+        filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
+        for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+            filter.insert(vecVoteHashes[i]);
         }
     }
 
-    LogPrint(BCLog::GOV, "CGovernanceManager::RequestGovernanceObject -- nHash %s nVoteCount %d peer=%d\n", nHash.ToString(), nVoteCount, pfrom->GetId());
     connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCESYNC, nHash, filter));
 }
 
@@ -1026,8 +1104,6 @@ int CGovernanceManager::RequestGovernanceObjectVotes(CNode* pnode, CConnman* con
 
 int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman* connman)
 {
-    static std::map<uint256, std::map<CService, int64_t> > mapAskedRecently;
-
     if(vNodesCopy.empty()) return -1;
 
     int64_t nNow = GetTime();
@@ -1053,19 +1129,12 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
 
         if(mapObjects.empty()) return -2;
 
+        ExpireAskedRecently(nNow);
+
         for (const auto& objPair : mapObjects) {
             uint256 nHash = objPair.first;
-            if (mapAskedRecently.count(nHash)) {
-                auto it = mapAskedRecently[nHash].begin();
-                while (it != mapAskedRecently[nHash].end()) {
-                    if (it->second < nNow) {
-                        mapAskedRecently[nHash].erase(it++);
-                    } else {
-                        ++it;
-                    }
-                }
-                if (mapAskedRecently[nHash].size() >= nPeersPerHashMax) continue;
-            }
+            const auto it = mapAskedRecently.find(nHash);
+            if (it != mapAskedRecently.end() && it->second.size() >= nPeersPerHashMax) continue;
 
             if (objPair.second.nObjectType == GOVERNANCE_OBJECT_TRIGGER) {
                 vTriggerObjHashes.push_back(nHash);
@@ -1075,52 +1144,88 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
         }
     }
 
-    LogPrint(BCLog::GOV, "CGovernanceManager::RequestGovernanceObjectVotes -- start: vTriggerObjHashes %d vOtherObjHashes %d mapAskedRecently %d\n",
-                vTriggerObjHashes.size(), vOtherObjHashes.size(), mapAskedRecently.size());
+    // the requests are sent after releasing cs, they build their filters under it themselves
+    std::vector<std::pair<CNode*, uint256> > vecRequests;
+    int nRemaining;
+    {
+        LOCK(cs);
 
-    Shuffle(vTriggerObjHashes.begin(), vTriggerObjHashes.end(), FastRandomContext());
-    Shuffle(vOtherObjHashes.begin(), vOtherObjHashes.end(), FastRandomContext());
+        LogPrint(BCLog::GOV, "CGovernanceManager::RequestGovernanceObjectVotes -- start: vTriggerObjHashes %d vOtherObjHashes %d mapAskedRecently %d\n",
+                    vTriggerObjHashes.size(), vOtherObjHashes.size(), mapAskedRecently.size());
 
-    for (int i = 0; i < nMaxObjRequestsPerNode; ++i) {
-        uint256 nHashGovobj;
+        Shuffle(vTriggerObjHashes.begin(), vTriggerObjHashes.end(), FastRandomContext());
+        Shuffle(vOtherObjHashes.begin(), vOtherObjHashes.end(), FastRandomContext());
 
-        // ask for triggers first
-        if(vTriggerObjHashes.size()) {
-            nHashGovobj = vTriggerObjHashes.back();
-        } else {
-            if(vOtherObjHashes.empty()) break;
-            nHashGovobj = vOtherObjHashes.back();
-        }
-        bool fAsked = false;
-        for (const auto& pnode : vNodesCopy) {
-            // Only use regular peers, don't try to ask from outbound "masternode" connections -
-            // they stay connected for a short period of time and it's possible that we won't get everything we should.
-            // Only use outbound connections - inbound connection could be a "masternode" connection
-            // initiated from another node, so skip it too.
-            if(pnode->fMasternode || (fMasternodeMode && pnode->fInbound)) continue;
-            // only use up to date peers
-            if(pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) continue;
-            // to early to ask the same node
-            if(mapAskedRecently[nHashGovobj].count(pnode->addr)) continue;
-
-            RequestGovernanceObject(pnode, nHashGovobj, connman, true);
-            mapAskedRecently[nHashGovobj][pnode->addr] = nNow + nTimeout;
-            fAsked = true;
-            // stop loop if max number of peers per obj was asked
-            if(mapAskedRecently[nHashGovobj].size() >= nPeersPerHashMax) break;
-        }
-        // NOTE: this should match `if` above (the one before `while`)
-        if(vTriggerObjHashes.size()) {
-            vTriggerObjHashes.pop_back();
-        } else {
-            vOtherObjHashes.pop_back();
+        for (int i = 0; i < nMaxObjRequestsPerNode; ++i) {
+            uint256 nHashGovobj;
+
+            // ask for triggers first
+            if(vTriggerObjHashes.size()) {
+                nHashGovobj = vTriggerObjHashes.back();
+            } else {
+                if(vOtherObjHashes.empty()) break;
+                nHashGovobj = vOtherObjHashes.back();
+            }
+            bool fAsked = false;
+            for (const auto& pnode : vNodesCopy) {
+                // Only use regular peers, don't try to ask from outbound "masternode" connections -
+                // they stay connected for a short period of time and it's possible that we won't get everything we should.
+                // Only use outbound connections - inbound connection could be a "masternode" connection
+                // initiated from another node, so skip it too.
+                if(pnode->fMasternode || (fMasternodeMode && pnode->fInbound)) continue;
+                // only use up to date peers
+                if(pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) continue;
+                // to early to ask the same node
+                const auto itAsked = mapAskedRecently.find(nHashGovobj);
+                if(itAsked != mapAskedRecently.end() && itAsked->second.count(pnode->addr)) continue;
+
+                vecRequests.emplace_back(pnode, nHashGovobj);
+                std::map<CService, int64_t>& mapAsked = mapAskedRecently[nHashGovobj];
+                mapAsked[pnode->addr] = nNow + nTimeout;
+                mapAskedRecentlyExpiry.emplace(nNow + nTimeout, std::make_pair(nHashGovobj, pnode->addr));
+                fAsked = true;
+                // stop loop if max number of peers per obj was asked
+                if(mapAsked.size() >= nPeersPerHashMax) break;
+            }
+            // NOTE: this should match `if` above (the one before `while`)
+            if(vTriggerObjHashes.size()) {
+                vTriggerObjHashes.pop_back();
+            } else {
+                vOtherObjHashes.pop_back();
+            }
+            if(!fAsked) i--;
         }
-        if(!fAsked) i--;
+        LogPrint(BCLog::GOV, "CGovernanceManager::RequestGovernanceObjectVotes -- end: vTriggerObjHashes %d vOtherObjHashes %d mapAskedRecently %d\n",
+                    vTriggerObjHashes.size(), vOtherObjHashes.size(), mapAskedRecently.size());
+
+        nRemaining = int(vTriggerObjHashes.size() + vOtherObjHashes.size());
+    }
+
+    for (const auto& request : vecRequests) {
+        RequestGovernanceObject(request.first, request.second, connman, true);
     }
-    LogPrint(BCLog::GOV, "CGovernanceManager::RequestGovernanceObjectVotes -- end: vTriggerObjHashes %d vOtherObjHashes %d mapAskedRecently %d\n",
-                vTriggerObjHashes.size(), vOtherObjHashes.size(), mapAskedRecently.size());
 
-    return int(vTriggerObjHashes.size() + vOtherObjHashes.size());
+    return nRemaining;
+}
+
+void CGovernanceManager::ExpireAskedRecently(int64_t nNow)
+{
+    AssertLockHeld(cs);
+
+    auto it = mapAskedRecentlyExpiry.begin();
+    while(it != mapAskedRecentlyExpiry.end() && it->first < nNow) {
+        const auto itAsked = mapAskedRecently.find(it->second.first);
+        if(itAsked != mapAskedRecently.end()) {
+            const auto itPeer = itAsked->second.find(it->second.second);
+            if(itPeer != itAsked->second.end() && itPeer->second == it->first) {
+                itAsked->second.erase(itPeer);
+            }
+            if(itAsked->second.empty()) {
+                mapAskedRecently.erase(itAsked);
+            }
+        }
+        mapAskedRecentlyExpiry.erase(it++);
+    }
 }
 
 bool CGovernanceManager::VoteWithAll(const uint256& hash, const std::pair<std::string, std::string>& strVoteSignal, std::pair<int, int>& nResult, CConnman* connman)
@@ -1201,15 +1306,41 @@ void CGovernanceManager::RebuildIndexes()
     LOCK(cs);
 
     cmapVoteToObject.Clear();
+    mapObjectVoteHashes.clear();
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for(size_t i = 0; i < vecVotes.size(); ++i) {
-            cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+        for(const auto& nHashVote : govobj.GetVoteFile().GetVoteHashes()) {
+            CacheVoteToObject(nHashVote, objPair.first, govobj);
         }
     }
 }
 
+bool CGovernanceManager::CacheVoteToObject(const uint256& nHashVote, const uint256& nHashGovobj, CGovernanceObject& govobj)
+{
+    AssertLockHeld(cs);
+
+    if (cmapVoteToObject.HasKey(nHashVote)) {
+        return false;
+    }
+
+    // a full cache evicts its oldest vote on insert, which must leave the object's vote hashes too
+    const auto& listItems = cmapVoteToObject.GetItemList();
+    if (!listItems.empty() && cmapVoteToObject.GetSize() >= cmapVoteToObject.GetMaxSize()) {
+        const auto& itemEvicted = listItems.back();
+        auto it = mapObjectVoteHashes.find(itemEvicted.value->GetHash());
+        if (it != mapObjectVoteHashes.end()) {
+            it->second.erase(itemEvicted.key);
+            if (it->second.empty()) {
+                mapObjectVoteHashes.erase(it);
+            }
+        }
+    }
+
+    cmapVoteToObject.Insert(nHashVote, &govobj);
+    mapObjectVoteHashes[nHashGovobj].insert(nHashVote);
+    return true;
+}
+
 void CGovernanceManager::AddCachedTriggers()
 {
     LOCK(cs);
@@ -1225,6 +1356,7 @@ void CGovernanceManager::AddCachedTriggers()
             govobj.fCachedDelete = true;
             if (govobj.nDeletionTime == 0) {
                 govobj.nDeletionTime = GetAdjustedTime();
+                setCacheDirtyObjects.insert(objpair.first);
             }
         }
     }
@@ -1360,6 +1492,7 @@ void CGovernanceManager::CleanOrphanObjects()
         const auto& pairVote = prevIt->value;
         if(pairVote.second < nNow) {
             cmmapOrphanVotes.Erase(prevIt->key, prevIt->value);
+            fCacheStateDirty = true;
         }
     }
 }
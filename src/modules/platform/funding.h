@@ -17,6 +17,8 @@
 #include <timedata.h>
 #include <univalue.h>
 
+#include <functional>
+
 #include <boost/signals2/signal.hpp>
 
 class CGovernanceManager;
@@ -148,6 +150,7 @@ public:
 class CGovernanceManager
 {
     friend class CGovernanceObject;
+    friend class CModuleCacheDB;
 
 public: // Types
     struct last_object_rec {
@@ -185,6 +188,13 @@ private:
     // keep track of the scanning errors
     std::map<uint256, CGovernanceObject> mapObjects;
 
+    // objects added, changed or removed since CModuleCacheDB last wrote them
+    std::set<uint256> setCacheDirtyObjects;
+    // spilled votes of removed votes and objects, CModuleCacheDB erases them with the next flush
+    std::set<uint256> setCacheErasedVotes;
+    // set when the state written to CModuleCacheDB besides the objects changed
+    bool fCacheStateDirty;
+
     // mapErasedGovernanceObjects contains key-value pairs, where
     //   key   - funding object's hash
     //   value - expiration time for deleted objects
@@ -198,6 +208,9 @@ private:
 
     CacheMap<uint256, CGovernanceObject*> cmapVoteToObject;
 
+    // hashes of the votes in cmapVoteToObject by object hash, so erasing an object doesn't scan all votes
+    std::map<uint256, std::set<uint256> > mapObjectVoteHashes;
+
     CacheMap<uint256, CGovernanceVote> cmapInvalidVotes;
 
     CacheMultiMap<uint256, vote_time_pair_t> cmmapOrphanVotes;
@@ -208,6 +221,12 @@ private:
 
     std::set<uint256> setRequestedVotes;
 
+    // peers recently asked for an object's votes, by object hash, with the time each request expires
+    std::map<uint256, std::map<CService, int64_t> > mapAskedRecently;
+
+    // the same requests ordered by expiry time, so expired ones are dropped without scanning every object
+    std::multimap<int64_t, std::pair<uint256, CService> > mapAskedRecentlyExpiry;
+
     bool fRateChecksEnabled;
 
     class ScopedLockBool
@@ -245,6 +264,7 @@ public:
     bool ConfirmInventoryRequest(const CInv& inv);
 
     void SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, CConnman* connman);
+    void SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CGovernanceVoteFilter& filter, CConnman* connman);
     void SyncAll(CNode* pnode, CConnman* connman) const;
 
     void ClientTask(CConnman* connman);
@@ -271,12 +291,22 @@ public:
         LOCK(cs);
 
         LogPrint(BCLog::GOV, "Governance object manager was cleared\n");
+        for (const auto& objPair : mapObjects) {
+            setCacheDirtyObjects.insert(objPair.first);
+            for (const auto& nHashVote : objPair.second.GetVoteFile().GetDiskVoteHashes()) {
+                setCacheErasedVotes.insert(nHashVote);
+            }
+        }
+        fCacheStateDirty = true;
         mapObjects.clear();
         mapErasedGovernanceObjects.clear();
         cmapVoteToObject.Clear();
+        mapObjectVoteHashes.clear();
         cmapInvalidVotes.Clear();
         cmmapOrphanVotes.Clear();
         mapLastMasternodeObject.clear();
+        mapAskedRecently.clear();
+        mapAskedRecentlyExpiry.clear();
     }
 
     std::string ToString() const;
@@ -298,12 +328,21 @@ public:
         READWRITE(mapErasedGovernanceObjects);
         READWRITE(cmapInvalidVotes);
         READWRITE(cmmapOrphanVotes);
-        READWRITE(mapObjects);
+        if (!(s.GetType() & SER_MODULECACHE)) {
+            READWRITE(mapObjects);
+        }
         READWRITE(mapLastMasternodeObject);
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
             return;
         }
+        // everything read from funding.dat goes to the module cache on the next flush
+        if (ser_action.ForRead() && !(s.GetType() & SER_MODULECACHE)) {
+            for (const auto& objPair : mapObjects) {
+                setCacheDirtyObjects.insert(objPair.first);
+            }
+            fCacheStateDirty = true;
+        }
     }
 
     int64_t GetLastDiffTime() const { return nTimeLastDiff; }
@@ -364,17 +403,33 @@ public:
 
     bool VoteWithAll(const uint256& hash, const std::pair<std::string, std::string>& strVoteSignal, std::pair<int, int>& nResult, CConnman* connman);
 
+    /// Mark an object changed from outside the manager, so the module cache writes it on the next flush
+    void SetObjectCacheDirty(const uint256& nHash)
+    {
+        AssertLockHeld(cs);
+        setCacheDirtyObjects.insert(nHash);
+    }
+
 private:
     void RequestGovernanceObject(CNode* pfrom, const uint256& nHash, CConnman* connman, bool fUseFilter = false);
 
+    /// Announce the object and those of its votes fnMissing picks out of all the vote hashes
+    void SyncObjectAndMissingVotes(CNode* pnode, const uint256& nProp,
+                                   const std::function<std::vector<uint256>(const std::vector<uint256>&)>& fnMissing, CConnman* connman);
+
+    /// Drop asked recently entries that expired by nNow
+    void ExpireAskedRecently(int64_t nNow);
+
     void AddInvalidVote(const CGovernanceVote& vote)
     {
         cmapInvalidVotes.Insert(vote.GetHash(), vote);
+        fCacheStateDirty = true;
     }
 
     void AddOrphanVote(const CGovernanceVote& vote)
     {
         cmmapOrphanVotes.Insert(vote.GetHash(), vote_time_pair_t(vote, GetAdjustedTime() + GOVERNANCE_ORPHAN_EXPIRATION_TIME));
+        fCacheStateDirty = true;
     }
 
     bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman* connman);
@@ -389,6 +444,9 @@ private:
 
     void CheckOrphanVotes(CGovernanceObject& govobj, CGovernanceException& exception, CConnman* connman);
 
+    /// Map a vote to its object in cmapVoteToObject and mapObjectVoteHashes, dropping the vote the cache evicts from both
+    bool CacheVoteToObject(const uint256& nHashVote, const uint256& nHashGovobj, CGovernanceObject& govobj);
+
     void RebuildIndexes();
 
     void AddCachedTriggers();
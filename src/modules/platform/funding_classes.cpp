@@ -162,6 +162,7 @@ void CGovernanceTriggerManager::CleanAndRemove()
                 pObj->fCachedDelete = true;
                 if (pObj->nDeletionTime == 0) {
                     pObj->nDeletionTime = GetAdjustedTime();
+                    funding.SetObjectCacheDirty(pObj->GetHash());
                 }
             }
             // delete the trigger
@@ -643,6 +644,7 @@ bool CSuperblock::IsExpired()
             LogPrint(BCLog::GOV, "CSuperblock::IsExpired -- Expiring outdated object: %s\n", pgovobj->GetHash().ToString());
             pgovobj->fExpired = true;
             pgovobj->nDeletionTime = GetAdjustedTime();
+            funding.SetObjectCacheDirty(pgovobj->GetHash());
         }
     }
 
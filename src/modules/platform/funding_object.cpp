@@ -34,6 +34,7 @@ CGovernanceObject::CGovernanceObject():
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    arrVoteCounts(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -62,6 +63,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    arrVoteCounts(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -90,6 +92,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other):
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    arrVoteCounts(other.arrVoteCounts),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
     fileVotes(other.fileVotes)
 {}
@@ -191,26 +194,35 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    CountVote(eSignal, voteInstanceRef.eOutcome, -1);
+    CountVote(eSignal, vote.GetOutcome(), 1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
     fileVotes.AddVote(vote);
     fDirtyCache = true;
     return true;
 }
 
-void CGovernanceObject::ClearMasternodeVotes()
+std::vector<uint256> CGovernanceObject::ClearMasternodeVotes(std::vector<uint256>& vecDiskRemoved)
 {
     LOCK(cs_fobject);
 
+    std::set<COutPoint> setRemoved;
     vote_m_it it = mapCurrentMNVotes.begin();
     while(it != mapCurrentMNVotes.end()) {
         if (!mnodeman.Has(it->first)) {
-            fileVotes.RemoveVotesFromMasternode(it->first);
+            for (const auto& instancePair : it->second.mapInstances) {
+                CountVote(instancePair.first, instancePair.second.eOutcome, -1);
+            }
+            setRemoved.insert(it->first);
             mapCurrentMNVotes.erase(it++);
         }
         else {
             ++it;
         }
     }
+
+    if (setRemoved.empty()) return std::vector<uint256>();
+    return fileVotes.RemoveVotesFromMasternodes(setRemoved, vecDiskRemoved);
 }
 
 std::string CGovernanceObject::GetSignatureMessage() const
@@ -542,7 +554,40 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
     return true;
 }
 
+void CGovernanceObject::CountVote(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+{
+    // only real outcomes of supported signals are counted, anything else is recounted on request
+    if (nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) return;
+    if (eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) return;
+    arrVoteCounts[nSignal][eOutcome] += nDelta;
+}
+
+void CGovernanceObject::RebuildVoteCounts()
+{
+    LOCK(cs_fobject);
+    arrVoteCounts = {};
+    for (const auto& votepair : mapCurrentMNVotes) {
+        for (const auto& instancePair : votepair.second.mapInstances) {
+            CountVote(instancePair.first, instancePair.second.eOutcome, 1);
+        }
+    }
+}
+
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
+{
+    LOCK(cs_fobject);
+    if (eVoteSignalIn <= VOTE_SIGNAL_NONE || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL ||
+        eVoteOutcomeIn <= VOTE_OUTCOME_NONE || eVoteOutcomeIn > VOTE_OUTCOME_ABSTAIN) {
+        return RecountMatchingVotes(eVoteSignalIn, eVoteOutcomeIn);
+    }
+    int nCount = arrVoteCounts[eVoteSignalIn][eVoteOutcomeIn];
+#ifdef DEBUG_GOVERNANCE
+    assert(nCount == RecountMatchingVotes(eVoteSignalIn, eVoteOutcomeIn));
+#endif
+    return nCount;
+}
+
+int CGovernanceObject::RecountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
     LOCK(cs_fobject);
     int nCount = 0;
@@ -597,6 +642,12 @@ bool CGovernanceObject::GetCurrentMNVotes(const COutPoint& mnCollateralOutpoint,
     return  true;
 }
 
+CGovernanceObject::vote_m_t CGovernanceObject::GetCurrentMNVotes() const
+{
+    LOCK(cs_fobject);
+    return mapCurrentMNVotes;
+}
+
 void CGovernanceObject::Relay(CConnman* connman)
 {
     // Do not relay until fully synced
@@ -14,6 +14,7 @@
 
 #include <univalue.h>
 
+#include <array>
 #include <string>
 
 class CGovernanceManager;
@@ -24,6 +25,8 @@ class CNode;
 
 static const int MAX_GOVERNANCE_OBJECT_DATA_SIZE = 16 * 1024;
 static const int MIN_GOVERNANCE_PEER_PROTO_VERSION = 70015;
+//! vote sync requests carry a CGovernanceVoteFilter instead of a bloom filter starting with this version
+static const int GOVERNANCE_VOTE_FILTER_VERSION = 70018;
 
 static const double GOVERNANCE_FILTER_FP_RATE = 0.001;
 
@@ -109,6 +112,7 @@ class CGovernanceObject
     friend class CGovernanceManager;
     friend class CGovernanceTriggerManager;
     friend class CSuperblock;
+    friend class CModuleCacheDB;
 
 public: // Types
     typedef std::map<COutPoint, vote_rec_t> vote_m_t;
@@ -177,6 +181,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Number of current masternode votes by signal and outcome, kept in step with mapCurrentMNVotes
+    std::array<std::array<int, VOTE_OUTCOME_ABSTAIN + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> arrVoteCounts;
+
     /// Limited map of votes orphaned by MN
     CacheMultiMap<COutPoint, vote_time_pair_t> cmmapOrphanVotes;
 
@@ -280,6 +287,8 @@ public:
     int GetAbstainCount(vote_signal_enum_t eVoteSignalIn) const;
 
     bool GetCurrentMNVotes(const COutPoint& mnCollateralOutpoint, vote_rec_t& voteRecord) const;
+    /// Copy of the current vote records of all masternodes which voted on this object
+    vote_m_t GetCurrentMNVotes() const;
 
     // FUNCTIONS FOR DEALING WITH DATA STRING
 
@@ -310,6 +319,9 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
+            if (ser_action.ForRead()) {
+                RebuildVoteCounts();
+            }
             READWRITE(fileVotes);
             LogPrint(BCLog::GOV, "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
@@ -326,8 +338,13 @@ private:
                      CGovernanceException& exception,
                      CConnman* connman);
 
-    /// Called when MN's which have voted on this object have been removed
-    void ClearMasternodeVotes();
+    void CountVote(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+    void RebuildVoteCounts();
+    int RecountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const;
+
+    /// Called when MN's which have voted on this object have been removed, returns the hashes of the removed votes
+    /// and adds those of removed votes spilled to disk to vecDiskRemoved
+    std::vector<uint256> ClearMasternodeVotes(std::vector<uint256>& vecDiskRemoved);
 
     void CheckOrphanVotes(CConnman* connman);
 
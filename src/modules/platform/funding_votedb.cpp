@@ -4,16 +4,28 @@
 
 #include <modules/platform/funding_votedb.h>
 
+#include <blockfilter.h>
+#include <cachedb.h>
+#include <hash.h>
+#include <random.h>
+
+#include <algorithm>
+#include <limits>
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
     : nMemoryVotes(0),
       listVotes(),
-      mapVoteIndex()
+      mapVoteIndex(),
+      mapDiskVotes(),
+      mapSpillVotes()
 {}
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
     : nMemoryVotes(other.nMemoryVotes),
       listVotes(other.listVotes),
-      mapVoteIndex()
+      mapVoteIndex(),
+      mapDiskVotes(other.mapDiskVotes),
+      mapSpillVotes(other.mapSpillVotes)
 {
     RebuildIndex();
 }
@@ -31,17 +43,30 @@ void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
-    return mapVoteIndex.find(nHash) != mapVoteIndex.end();
+    return mapVoteIndex.find(nHash) != mapVoteIndex.end() || mapDiskVotes.count(nHash);
 }
 
 bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const
 {
     vote_m_cit it = mapVoteIndex.find(nHash);
-    if(it == mapVoteIndex.end()) {
+    if(it != mapVoteIndex.end()) {
+        ss << *(it->second);
+        return true;
+    }
+    if(!mapDiskVotes.count(nHash)) {
         return false;
     }
-    ss << *(it->second);
-    return true;
+    const auto itSpill = mapSpillVotes.find(nHash);
+    if(itSpill != mapSpillVotes.end()) {
+        ss << itSpill->second;
+        return true;
+    }
+    CGovernanceVote vote;
+    if(g_modulecachedb && g_modulecachedb->ReadGovernanceVote(nHash, vote)) {
+        ss << vote;
+        return true;
+    }
+    return false;
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
@@ -50,22 +75,87 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
     for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
         vecResult.push_back(*it);
     }
+    CGovernanceVote vote;
+    for(const auto& diskPair : mapDiskVotes) {
+        const auto itSpill = mapSpillVotes.find(diskPair.first);
+        if(itSpill != mapSpillVotes.end()) {
+            vecResult.push_back(itSpill->second);
+        } else if(g_modulecachedb && g_modulecachedb->ReadGovernanceVote(diskPair.first, vote)) {
+            vecResult.push_back(vote);
+        }
+    }
+    return vecResult;
+}
+
+std::vector<uint256> CGovernanceObjectVoteFile::GetVoteHashes() const
+{
+    std::vector<uint256> vecResult;
+    vecResult.reserve(mapVoteIndex.size() + mapDiskVotes.size());
+    for(const auto& indexPair : mapVoteIndex) {
+        vecResult.push_back(indexPair.first);
+    }
+    for(const auto& diskPair : mapDiskVotes) {
+        vecResult.push_back(diskPair.first);
+    }
     return vecResult;
 }
 
-void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
+std::vector<uint256> CGovernanceObjectVoteFile::GetDiskVoteHashes() const
 {
+    std::vector<uint256> vecResult;
+    vecResult.reserve(mapDiskVotes.size());
+    for(const auto& diskPair : mapDiskVotes) {
+        vecResult.push_back(diskPair.first);
+    }
+    return vecResult;
+}
+
+std::vector<uint256> CGovernanceObjectVoteFile::RemoveVotesFromMasternodes(const std::set<COutPoint>& setOutpoints, std::vector<uint256>& vecDiskRemoved)
+{
+    std::vector<uint256> vecRemoved;
     vote_l_it it = listVotes.begin();
     while(it != listVotes.end()) {
-        if(it->GetMasternodeOutpoint() == outpointMasternode) {
+        if(setOutpoints.count(it->GetMasternodeOutpoint())) {
+            uint256 nHash = it->GetHash();
             --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
+            mapVoteIndex.erase(nHash);
             listVotes.erase(it++);
+            vecRemoved.push_back(nHash);
         }
         else {
             ++it;
         }
     }
+
+    vote_disk_m_t::iterator itDisk = mapDiskVotes.begin();
+    while(itDisk != mapDiskVotes.end()) {
+        if(setOutpoints.count(itDisk->second)) {
+            vecRemoved.push_back(itDisk->first);
+            vecDiskRemoved.push_back(itDisk->first);
+            mapSpillVotes.erase(itDisk->first);
+            mapDiskVotes.erase(itDisk++);
+        }
+        else {
+            ++itDisk;
+        }
+    }
+
+    return vecRemoved;
+}
+
+const std::map<uint256, CGovernanceVote>& CGovernanceObjectVoteFile::SpillVotes()
+{
+    // the list is newest first
+    while(nMemoryVotes > MAX_MEMORY_VOTES) {
+        const CGovernanceVote& vote = listVotes.back();
+        uint256 nHash = vote.GetHash();
+        mapDiskVotes.emplace(nHash, vote.GetMasternodeOutpoint());
+        mapSpillVotes.emplace(nHash, vote);
+        mapVoteIndex.erase(nHash);
+        listVotes.pop_back();
+        --nMemoryVotes;
+    }
+    return mapSpillVotes;
 }
 
 void CGovernanceObjectVoteFile::RebuildIndex()
@@ -86,3 +176,66 @@ void CGovernanceObjectVoteFile::RebuildIndex()
         }
     }
 }
+
+CGovernanceVoteFilter::CGovernanceVoteFilter()
+    : fVotes(false),
+      hashDigest(),
+      nKey0(0),
+      nKey1(0),
+      vchFilter()
+{}
+
+CGovernanceVoteFilter::CGovernanceVoteFilter(const std::vector<uint256>& vecVoteHashes)
+    : fVotes(true),
+      hashDigest(GetDigest(vecVoteHashes)),
+      nKey0(GetRand(std::numeric_limits<uint64_t>::max())),
+      nKey1(GetRand(std::numeric_limits<uint64_t>::max())),
+      vchFilter()
+{
+    GCSFilter::ElementSet elements;
+    for(const auto& nHash : vecVoteHashes) {
+        elements.emplace(nHash.begin(), nHash.end());
+    }
+    vchFilter = GCSFilter(GCSFilter::Params(nKey0, nKey1, FILTER_P, FILTER_M), elements).GetEncoded();
+}
+
+uint256 CGovernanceVoteFilter::GetDigest(std::vector<uint256> vecVoteHashes)
+{
+    std::sort(vecVoteHashes.begin(), vecVoteHashes.end());
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << vecVoteHashes;
+    return ss.GetHash();
+}
+
+std::vector<uint256> CGovernanceVoteFilter::GetMissing(const std::vector<uint256>& vecVoteHashes) const
+{
+    if(!fVotes) {
+        return vecVoteHashes;
+    }
+    if(GetDigest(vecVoteHashes) == hashDigest) {
+        return std::vector<uint256>();
+    }
+
+    GCSFilter filter;
+    try {
+        filter = GCSFilter(GCSFilter::Params(nKey0, nKey1, FILTER_P, FILTER_M), vchFilter);
+    } catch (const std::ios_base::failure&) {
+        // treat a malformed filter as an empty one
+        return vecVoteHashes;
+    }
+
+    std::vector<GCSFilter::Element> elements;
+    elements.reserve(vecVoteHashes.size());
+    for(const auto& nHash : vecVoteHashes) {
+        elements.emplace_back(nHash.begin(), nHash.end());
+    }
+
+    std::vector<uint256> vecResult;
+    std::vector<bool> vecMatches = filter.MatchEach(elements);
+    for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+        if(!vecMatches[i]) {
+            vecResult.push_back(vecVoteHashes[i]);
+        }
+    }
+    return vecResult;
+}
@@ -7,6 +7,7 @@
 
 #include <list>
 #include <map>
+#include <set>
 
 #include <modules/platform/funding_vote.h>
 #include <serialize.h>
@@ -16,10 +17,10 @@
 /**
  * Represents the collection of votes associated with a given CGovernanceObject
  * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
- *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * which the module cache database spills older votes to disk when it flushes the
+ * object, in the same batch. Only the hashes and masternodes of spilled votes stay
+ * in memory. Without a module cache database (e.g. in lite mode) all votes are kept
+ * in memory.
  */
 class CGovernanceObjectVoteFile
 {
@@ -36,8 +37,10 @@ public: // Types
 
     typedef vote_m_t::const_iterator vote_m_cit;
 
+    typedef std::map<uint256,COutPoint> vote_disk_m_t;
+
 private:
-    static const int MAX_MEMORY_VOTES = -1;
+    static const int MAX_MEMORY_VOTES = 1000;
 
     int nMemoryVotes;
 
@@ -45,6 +48,12 @@ private:
 
     vote_m_t mapVoteIndex;
 
+    /// Votes spilled to disk, by hash, with the masternode that cast them
+    vote_disk_m_t mapDiskVotes;
+
+    /// Spilled votes until the batch writing them to disk succeeded
+    std::map<uint256, CGovernanceVote> mapSpillVotes;
+
 public:
     CGovernanceObjectVoteFile();
 
@@ -56,22 +65,50 @@ public:
     void AddVote(const CGovernanceVote& vote);
 
     /**
-     * Return true if the vote with this hash is currently cached in memory
+     * Return true if the vote with this hash is in the file, in memory or on disk
      */
     bool HasVote(const uint256& nHash) const;
 
     /**
-     * Retrieve a vote cached in memory
+     * Retrieve a vote from memory or disk, a spilled vote is read from the module cache database
      */
     bool SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const;
 
-    int GetVoteCount() {
-        return nMemoryVotes;
+    int GetVoteCount() const {
+        return nMemoryVotes + mapDiskVotes.size();
     }
 
+    /**
+     * All votes, note that this reads every spilled vote from the module cache database
+     */
     std::vector<CGovernanceVote> GetVotes() const;
 
-    void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
+    /**
+     * Hashes of all votes, without reading spilled votes from disk
+     */
+    std::vector<uint256> GetVoteHashes() const;
+
+    /**
+     * Hashes of the spilled votes, to erase them from disk with the object
+     */
+    std::vector<uint256> GetDiskVoteHashes() const;
+
+    /**
+     * Remove the votes of these masternodes in a single pass, returns the hashes of the removed votes.
+     * The hashes of removed spilled votes are added to vecDiskRemoved too, to erase them from disk.
+     */
+    std::vector<uint256> RemoveVotesFromMasternodes(const std::set<COutPoint>& setOutpoints, std::vector<uint256>& vecDiskRemoved);
+
+    /**
+     * Move the oldest votes over MAX_MEMORY_VOTES out of memory, returns the spilled votes
+     * that still have to be written to disk along with the object
+     */
+    const std::map<uint256, CGovernanceVote>& SpillVotes();
+
+    /**
+     * The votes returned by SpillVotes are on disk
+     */
+    void SpillWritten() { mapSpillVotes.clear(); }
 
     ADD_SERIALIZE_METHODS;
 
@@ -80,6 +117,7 @@ public:
     {
         READWRITE(nMemoryVotes);
         READWRITE(listVotes);
+        READWRITE(mapDiskVotes);
         if(ser_action.ForRead()) {
             RebuildIndex();
         }
@@ -89,4 +127,58 @@ private:
 
 };
 
+/**
+ * Summary of the votes we hold for one funding object, sent with a vote sync
+ * request so the peer only announces the votes we are missing. A digest of the
+ * whole set lets the peer skip an object we are already in sync on, and a
+ * Golomb-coded set of the vote hashes filters the rest in a fraction of the
+ * space of a bloom filter, however many votes the object has.
+ */
+class CGovernanceVoteFilter
+{
+private:
+    static const uint8_t FILTER_P = 12;
+    static const uint32_t FILTER_M = 4096;
+
+    bool fVotes;
+    uint256 hashDigest;
+    uint64_t nKey0;
+    uint64_t nKey1;
+    std::vector<unsigned char> vchFilter;
+
+public:
+    /**
+     * Request the object with all of its votes, as an empty bloom filter does
+     */
+    CGovernanceVoteFilter();
+
+    /**
+     * Request the votes not in vecVoteHashes, under fresh random filter keys so
+     * false positives differ between requests
+     */
+    explicit CGovernanceVoteFilter(const std::vector<uint256>& vecVoteHashes);
+
+    /**
+     * Digest of a set of vote hashes, independent of their order
+     */
+    static uint256 GetDigest(std::vector<uint256> vecVoteHashes);
+
+    /**
+     * Return the hashes from vecVoteHashes the requesting peer doesn't have
+     */
+    std::vector<uint256> GetMissing(const std::vector<uint256>& vecVoteHashes) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(fVotes);
+        READWRITE(hashDigest);
+        READWRITE(nKey0);
+        READWRITE(nKey1);
+        READWRITE(vchFilter);
+    }
+};
+
 #endif
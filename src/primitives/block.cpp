@@ -11,9 +11,140 @@
 #include <util/strencodings.h>
 #include <crypto/common.h>
 
+#include <assert.h>
+#include <string.h>
+
+
+CBlockHeader& CBlockHeader::operator=(const CBlockHeader& other)
+{
+    if (this == &other) return *this;
+
+    nVersion       = other.nVersion;
+    hashPrevBlock  = other.hashPrevBlock;
+    hashMerkleRoot = other.hashMerkleRoot;
+    nTime          = other.nTime;
+    nBits          = other.nBits;
+    nNonce         = other.nNonce;
+
+    // Copy the other header's cache only if it is not being read or written
+    // right now, otherwise the copy just starts without one
+    fHashCached.store(false, std::memory_order_relaxed);
+    if (other.fHashCached.load(std::memory_order_acquire) && !other.fHashBusy.exchange(true, std::memory_order_acquire)) {
+        if (other.fHashCached.load(std::memory_order_relaxed)) {
+            memcpy(vchHashedHeader, other.vchHashedHeader, HASHED_HEADER_SIZE);
+            hashCached = other.hashCached;
+            fHashCached.store(true, std::memory_order_relaxed);
+        }
+        other.fHashBusy.store(false, std::memory_order_release);
+    }
+    return *this;
+}
+
+bool CBlockHeader::GetCachedHash(uint256& hash) const
+{
+    if (!fHashCached.load(std::memory_order_acquire)) return false;
+    if (fHashBusy.exchange(true, std::memory_order_acquire)) return false;
+    bool fFound = fHashCached.load(std::memory_order_relaxed) && memcmp(vchHashedHeader, &nVersion, HASHED_HEADER_SIZE) == 0;
+    if (fFound) hash = hashCached;
+    fHashBusy.store(false, std::memory_order_release);
+    return fFound;
+}
+
+void CBlockHeader::SetCachedHash(const uint256& hash) const
+{
+    if (fHashBusy.exchange(true, std::memory_order_acquire)) return;
+    memcpy(vchHashedHeader, &nVersion, HASHED_HEADER_SIZE);
+    hashCached = hash;
+    fHashCached.store(true, std::memory_order_relaxed);
+    fHashBusy.store(false, std::memory_order_release);
+}
+
 uint256 CBlockHeader::GetHash() const
 {
-    return HashC11((char*)&(nVersion), (char*)&((&(nNonce))[1]));
+    const unsigned char* pbegin = (const unsigned char*)&(nVersion);
+    const unsigned char* pend = (const unsigned char*)&((&(nNonce))[1]);
+    assert(pend - pbegin == (ptrdiff_t)HASHED_HEADER_SIZE);
+
+    uint256 hash;
+    if (GetCachedHash(hash)) {
+        return hash;
+    }
+
+    // Concurrent callers at worst compute the hash twice
+    hash = HashC11(pbegin, pend);
+    SetCachedHash(hash);
+    return hash;
+}
+
+namespace {
+
+/** Number of headers pushed through each C11 stage together, the widest CubeHash512_64 implementation. */
+static const size_t C11_BATCH_LANES = 8;
+
+/** Hash up to C11_BATCH_LANES headers stage by stage, storing each result in out[idx[l]]. */
+void HashC11Lanes(const CBlockHeader* headers, const size_t* idx, size_t lanes, uint256* out)
+{
+    static const size_t SIZE = CHashC11::OUTPUT_SIZE;
+    unsigned char buf[C11_BATCH_LANES * SIZE];
+    unsigned char tmp[C11_BATCH_LANES * SIZE];
+
+    // Run each stage over all lanes before moving on to the next one, so that
+    // CubeHash gets all lanes in one call. The other stages have no multi-lane
+    // implementation and reuse one context across the lanes.
+    CBLAKE512 ctx_blake;
+    for (size_t l = 0; l < lanes; l++) {
+        const CBlockHeader& header = headers[idx[l]];
+        const unsigned char* pbegin = (const unsigned char*)&header.nVersion;
+        const unsigned char* pend = (const unsigned char*)&((&header.nNonce)[1]);
+        ctx_blake.Write(pbegin, pend - pbegin).Finalize(buf + l * SIZE);
+    }
+    CBMW512 ctx_bmw;
+    for (size_t l = 0; l < lanes; l++) ctx_bmw.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CGROESTL512 ctx_groestl;
+    for (size_t l = 0; l < lanes; l++) ctx_groestl.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CJH512 ctx_jh;
+    for (size_t l = 0; l < lanes; l++) ctx_jh.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CKECCAK512 ctx_keccak;
+    for (size_t l = 0; l < lanes; l++) ctx_keccak.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CSKEIN512 ctx_skein;
+    for (size_t l = 0; l < lanes; l++) ctx_skein.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CLUFFA512 ctx_luffa;
+    for (size_t l = 0; l < lanes; l++) ctx_luffa.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CubeHash512_64(tmp, buf, lanes);
+    CSHAVITE512 ctx_shavite;
+    for (size_t l = 0; l < lanes; l++) ctx_shavite.Write(tmp + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CSIMD512 ctx_simd;
+    for (size_t l = 0; l < lanes; l++) ctx_simd.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+    CECHO512 ctx_echo;
+    for (size_t l = 0; l < lanes; l++) ctx_echo.Write(buf + l * SIZE, SIZE).Finalize(buf + l * SIZE);
+
+    for (size_t l = 0; l < lanes; l++) {
+        // Like HashC11, keep the first 256 bits of the final stage
+        memcpy(out[idx[l]].begin(), buf + l * SIZE, out[idx[l]].size());
+    }
+}
+
+} // namespace
+
+void HashC11Batch(const CBlockHeader* headers, size_t n, uint256* out)
+{
+    size_t idx[C11_BATCH_LANES];
+    size_t lanes = 0;
+    auto flush = [&]() {
+        HashC11Lanes(headers, idx, lanes, out);
+        for (size_t l = 0; l < lanes; l++) {
+            headers[idx[l]].SetCachedHash(out[idx[l]]);
+        }
+        lanes = 0;
+    };
+
+    // Only headers without a valid cached hash take a lane
+    for (size_t i = 0; i < n; i++) {
+        if (headers[i].GetCachedHash(out[i])) continue;
+        idx[lanes++] = i;
+        if (lanes == C11_BATCH_LANES) flush();
+    }
+    if (lanes > 0) flush();
 }
 
 std::string CBlock::ToString() const
@@ -10,6 +10,8 @@
 #include <serialize.h>
 #include <uint256.h>
 
+#include <atomic>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -28,11 +30,39 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
-    CBlockHeader()
+private:
+    //! Number of header bytes (nVersion through nNonce) fed to the C11 hash
+    static const size_t HASHED_HEADER_SIZE = 80;
+
+    // memory only: the last computed C11 hash together with the header bytes
+    // it was computed from, so that direct writes to the public fields above
+    // are detected and never return a stale hash. fHashBusy is taken with a
+    // single exchange and never waited on: a thread that finds it set simply
+    // hashes without the cache.
+    mutable std::atomic<bool> fHashBusy;
+    mutable std::atomic<bool> fHashCached;
+    mutable unsigned char vchHashedHeader[HASHED_HEADER_SIZE];
+    mutable uint256 hashCached;
+
+    /** Fetch the cached hash if it still matches the header fields. */
+    bool GetCachedHash(uint256& hash) const;
+    void SetCachedHash(const uint256& hash) const;
+
+    friend void HashC11Batch(const CBlockHeader* headers, size_t n, uint256* out);
+
+public:
+    CBlockHeader() : fHashBusy(false), fHashCached(false)
     {
         SetNull();
     }
 
+    CBlockHeader(const CBlockHeader& other) : fHashBusy(false), fHashCached(false)
+    {
+        *this = other;
+    }
+
+    CBlockHeader& operator=(const CBlockHeader& other);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -43,6 +73,9 @@ public:
         READWRITE(nTime);
         READWRITE(nBits);
         READWRITE(nNonce);
+        if (ser_action.ForRead()) {
+            InvalidateHash();
+        }
     }
 
     void SetNull()
@@ -53,6 +86,13 @@ public:
         nTime = 0;
         nBits = 0;
         nNonce = 0;
+        InvalidateHash();
+    }
+
+    /** Drop the cached hash, forcing the next GetHash() to recompute it. */
+    void InvalidateHash() const
+    {
+        fHashCached.store(false, std::memory_order_release);
     }
 
     bool IsNull() const
@@ -60,6 +100,7 @@ public:
         return (nBits == 0);
     }
 
+    /** Return the C11 hash of this header, computing it at most once per set of header values. */
     uint256 GetHash() const;
 
     int64_t GetBlockTime() const
@@ -68,6 +109,13 @@ public:
     }
 };
 
+/** Compute the C11 hashes of n block headers at once, filling their hash caches.
+ *  Headers with a valid cached hash are skipped, the others are pushed through
+ *  each C11 stage together. Only the CubeHash stage hashes several headers per
+ *  call (see CubeHash512_64), the other stages hash them one after the other.
+ */
+void HashC11Batch(const CBlockHeader* headers, size_t n, uint256* out);
+
 
 class CBlock : public CBlockHeader
 {
@@ -110,14 +158,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        return block;
+        // Slice off the header, carrying over its cached hash
+        return *this;
     }
 
     std::string ToString() const;
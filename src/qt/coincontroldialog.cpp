@@ -416,7 +416,7 @@ void CoinControlDialog::viewItemChanged(QTreeWidgetItem* item, int column)
             item->setCheckState(COLUMN_CHECKBOX, Qt::Unchecked);
         else {
             coinControl()->Select(outpt);
-            int nDepth = model->node().analyzeCoin(outpt);
+            int nDepth = model->node().analyzeCoin(outpt, item->data(COLUMN_AMOUNT, Qt::UserRole).toLongLong());
             if (coinControl()->fUseCoinJoin && nDepth < model->wallet().getCJDepth()) {
                 QMessageBox::warning(this, windowTitle(),
                     tr("Non-anonymized input selected. <b>CoinJoin will be disabled.</b><br><br>If you still want to use CoinJoin, please deselect all non-nonymized inputs first and then check CoinJoin checkbox again."),
@@ -737,7 +737,7 @@ void CoinControlDialog::updateView()
             itemOutput->setData(COLUMN_DATE, Qt::UserRole, QVariant((qlonglong)out.time));
 
             // CoinJoin rounds
-            int nDepth = model->node().analyzeCoin(output);
+            int nDepth = model->node().analyzeCoin(output, out.txout.nValue);
 
             if (nDepth >= 0) itemOutput->setText(COLUMN_COINJOIN_ROUNDS, QString::number(nDepth));
             else itemOutput->setText(COLUMN_COINJOIN_ROUNDS, QString::fromStdString("n/a"));
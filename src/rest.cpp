@@ -8,7 +8,9 @@
 #include <chainparams.h>
 #include <core_io.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/txindex.h>
+#include <key_io.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
@@ -621,6 +623,67 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+static bool rest_address(HTTPRequest* req,
+                         const std::string& str_uri_part)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, str_uri_part);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2 && path.size() != 4) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Use /rest/address/<balance|utxos|txids>/<address>[/<start>/<end>].<ext>.");
+    }
+
+    int32_t start_height = 0;
+    int32_t end_height = std::numeric_limits<int32_t>::max();
+    if (path.size() == 4) {
+        if (path[0] == "balance") {
+            return RESTERR(req, HTTP_BAD_REQUEST, "A height range cannot be used with the balance of an address");
+        }
+        if (!ParseInt32(path[2], &start_height) || !ParseInt32(path[3], &end_height) ||
+            start_height < 0 || end_height < start_height) {
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height range: " + SanitizeString(path[2]) + "/" + SanitizeString(path[3]));
+        }
+    }
+
+    if (!g_addressindex) {
+        return RESTERR(req, HTTP_NOT_FOUND, "Address index not enabled. Use -addressindex to enable address queries");
+    }
+    if (!IsValidDestinationString(path[1])) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(path[1]));
+    }
+
+    UniValue result;
+    try {
+        if (path[0] == "balance") {
+            result = addressBalanceToJSON({path[1]});
+        } else if (path[0] == "utxos") {
+            result = addressUtxosToJSON({path[1]}, start_height, end_height);
+        } else if (path[0] == "txids") {
+            result = addressTxidsToJSON({path[1]}, start_height, end_height);
+        } else {
+            return RESTERR(req, HTTP_NOT_FOUND, "Unknown address query: " + SanitizeString(path[0]));
+        }
+    } catch (const UniValue& objError) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, find_value(objError, "message").get_str());
+    }
+
+    switch (rf) {
+    case RetFormat::JSON: {
+        std::string str_json = result.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, str_json);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -634,6 +697,7 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/address/", rest_address},
 };
 
 void StartREST()
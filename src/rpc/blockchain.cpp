@@ -7,6 +7,7 @@
 
 #include <amount.h>
 #include <base58.h>
+#include <blockfilter.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -14,6 +15,9 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <policy/feerate.h>
@@ -23,6 +27,7 @@
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <script/standard.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -2295,6 +2300,362 @@ UniValue scantxoutset(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getblockfilter",
+                "\nRetrieve a BIP 157 content filter for a particular block.\n",
+                {
+                    {"blockhash", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The hash of the block"},
+                    {"filtertype", RPCArg::Type::STR, /* default */ "basic", "The type name of the filter"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"filter\" : (string) the hex-encoded filter data\n"
+            "  \"header\" : (string) the hex-encoded filter header\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+                },
+            }.ToString());
+
+    uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    std::string filtertype_name = "basic";
+    if (!request.params[1].isNull()) {
+        filtertype_name = request.params[1].get_str();
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    BlockFilterIndex* index = GetBlockFilterIndex(filtertype);
+    if (!index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = index->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!index->LookupFilter(block_index, filter) ||
+        !index->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
+/** Scripts of the given addresses, checking that they can be looked up in the address index */
+static std::vector<CScript> GetAddressIndexScripts(const std::vector<std::string>& addresses)
+{
+    if (!g_addressindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled. Use -addressindex to enable address queries");
+    }
+
+    std::vector<CScript> scripts;
+    scripts.reserve(addresses.size());
+    for (const std::string& address : addresses) {
+        CTxDestination dest = DecodeDestination(address);
+        if (!IsValidDestination(dest)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + address);
+        }
+        scripts.push_back(GetScriptForDestination(dest));
+    }
+
+    g_addressindex->BlockUntilSyncedToCurrentChain();
+    return scripts;
+}
+
+static void CheckAddressIndexRange(int start_height, int end_height)
+{
+    if (start_height < 0 || end_height < start_height) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid height range");
+    }
+}
+
+UniValue addressBalanceToJSON(const std::vector<std::string>& addresses)
+{
+    std::vector<CScript> scripts = GetAddressIndexScripts(addresses);
+
+    CAmount balance = 0;
+    CAmount received = 0;
+    for (const CScript& script : scripts) {
+        std::vector<AddressDelta> deltas;
+        if (!g_addressindex->LookupDeltas(script, 0, std::numeric_limits<int>::max(), deltas)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        }
+        for (const AddressDelta& delta : deltas) {
+            balance += delta.amount;
+            if (!delta.spending) received += delta.amount;
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("balance", ValueFromAmount(balance));
+    result.pushKV("received", ValueFromAmount(received));
+    return result;
+}
+
+UniValue addressUtxosToJSON(const std::vector<std::string>& addresses, int start_height, int end_height)
+{
+    CheckAddressIndexRange(start_height, end_height);
+    std::vector<CScript> scripts = GetAddressIndexScripts(addresses);
+
+    std::vector<std::tuple<int, size_t, AddressUnspent>> utxos;
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        std::vector<AddressUnspent> unspent;
+        if (!g_addressindex->LookupUnspent(scripts[i], start_height, end_height, unspent)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        }
+        for (const AddressUnspent& utxo : unspent) {
+            utxos.emplace_back(utxo.height, i, utxo);
+        }
+    }
+    // several addresses are merged by height, keeping the order of each one within a height
+    std::stable_sort(utxos.begin(), utxos.end(), [](const std::tuple<int, size_t, AddressUnspent>& a,
+                                                    const std::tuple<int, size_t, AddressUnspent>& b) {
+        return std::get<0>(a) < std::get<0>(b);
+    });
+
+    UniValue result(UniValue::VARR);
+    for (const auto& entry : utxos) {
+        const size_t i = std::get<1>(entry);
+        const AddressUnspent& utxo = std::get<2>(entry);
+        UniValue unspent(UniValue::VOBJ);
+        unspent.pushKV("address", addresses[i]);
+        unspent.pushKV("txid", utxo.outpoint.hash.GetHex());
+        unspent.pushKV("vout", (int32_t)utxo.outpoint.n);
+        unspent.pushKV("scriptPubKey", HexStr(scripts[i].begin(), scripts[i].end()));
+        unspent.pushKV("amount", ValueFromAmount(utxo.amount));
+        unspent.pushKV("height", utxo.height);
+        result.push_back(unspent);
+    }
+    return result;
+}
+
+UniValue addressTxidsToJSON(const std::vector<std::string>& addresses, int start_height, int end_height)
+{
+    CheckAddressIndexRange(start_height, end_height);
+    std::vector<CScript> scripts = GetAddressIndexScripts(addresses);
+
+    std::vector<std::tuple<int, uint32_t, uint256>> txids;
+    for (const CScript& script : scripts) {
+        std::vector<AddressDelta> deltas;
+        if (!g_addressindex->LookupDeltas(script, start_height, end_height, deltas)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        }
+        for (const AddressDelta& delta : deltas) {
+            txids.emplace_back(delta.height, delta.tx_pos, delta.txid);
+        }
+    }
+    std::sort(txids.begin(), txids.end());
+    txids.erase(std::unique(txids.begin(), txids.end()), txids.end());
+
+    UniValue result(UniValue::VARR);
+    for (const auto& entry : txids) {
+        result.push_back(std::get<2>(entry).GetHex());
+    }
+    return result;
+}
+
+static std::vector<std::string> ParseAddresses(const UniValue& param)
+{
+    std::vector<std::string> addresses;
+    for (const UniValue& address : param.get_array().getValues()) {
+        addresses.push_back(address.get_str());
+    }
+    return addresses;
+}
+
+static UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddressbalance",
+                "\nReturns the balance of the given addresses and the total amount they received.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The addresses",
+                        {
+                            {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The address"},
+                        },
+                    },
+                },
+                RPCResult{
+            "{\n"
+            "  \"balance\" : x.xxx,     (numeric) the current balance in " + CURRENCY_UNIT + "\n"
+            "  \"received\" : x.xxx,    (numeric) the total amount received in " + CURRENCY_UNIT + ", change included\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressbalance", "'[\"CPSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]'")
+            + HelpExampleRpc("getaddressbalance", "[\"CPSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]")
+                },
+            }.ToString());
+
+    return addressBalanceToJSON(ParseAddresses(request.params[0]));
+}
+
+static UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddressutxos",
+                "\nReturns the unspent outputs of the given addresses created within a range of block heights.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The addresses",
+                        {
+                            {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The address"},
+                        },
+                    },
+                    {"start", RPCArg::Type::NUM, /* default */ "0", "The first block height to include"},
+                    {"end", RPCArg::Type::NUM, /* default */ "the chain tip", "The last block height to include"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"address\" : \"address\",    (string) the address\n"
+            "    \"txid\" : \"hash\",          (string) the transaction id\n"
+            "    \"vout\" : n,               (numeric) the output index\n"
+            "    \"scriptPubKey\" : \"hex\",   (string) the script\n"
+            "    \"amount\" : x.xxx,         (numeric) the amount in " + CURRENCY_UNIT + "\n"
+            "    \"height\" : n,             (numeric) the height of the block the output was created in\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressutxos", "'[\"CPSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]' 1000 2000")
+            + HelpExampleRpc("getaddressutxos", "[\"CPSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"], 1000, 2000")
+                },
+            }.ToString());
+
+    int start_height = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    int end_height = request.params[2].isNull() ? std::numeric_limits<int>::max() : request.params[2].get_int();
+    return addressUtxosToJSON(ParseAddresses(request.params[0]), start_height, end_height);
+}
+
+static UniValue getaddresstxids(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddresstxids",
+                "\nReturns the ids of the transactions spending from or paying to the given addresses within a\n"
+                "range of block heights, in the order they appear in the chain.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The addresses",
+                        {
+                            {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The address"},
+                        },
+                    },
+                    {"start", RPCArg::Type::NUM, /* default */ "0", "The first block height to include"},
+                    {"end", RPCArg::Type::NUM, /* default */ "the chain tip", "The last block height to include"},
+                },
+                RPCResult{
+            "[\n"
+            "  \"txid\"    (string) the transaction id\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddresstxids", "'[\"CPSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]' 1000 2000")
+            + HelpExampleRpc("getaddresstxids", "[\"CPSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"], 1000, 2000")
+                },
+            }.ToString());
+
+    int start_height = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    int end_height = request.params[2].isNull() ? std::numeric_limits<int>::max() : request.params[2].get_int();
+    return addressTxidsToJSON(ParseAddresses(request.params[0]), start_height, end_height);
+}
+
+static UniValue getspentinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getspentinfo",
+                "\nReturns the transaction input that spent an output in the active chain.\n"
+                "Requires -spentindex.\n",
+                {
+                    {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The id of the transaction that created the output"},
+                    {"n", RPCArg::Type::NUM, RPCArg::Optional::NO, "The output index"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"txid\" : \"hash\",     (string) the id of the spending transaction\n"
+            "  \"vin\" : n,           (numeric) the index of the spending input\n"
+            "  \"height\" : n,        (numeric) the height of the block the output was spent in\n"
+            "  \"amount\" : x.xxx,    (numeric) the value of the spent output in " + CURRENCY_UNIT + "\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getspentinfo", "\"mytxid\" 0")
+            + HelpExampleRpc("getspentinfo", "\"mytxid\", 0")
+                },
+            }.ToString());
+
+    uint256 txid = ParseHashV(request.params[0], "txid");
+    int n = request.params[1].get_int();
+    if (n < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, vout must be positive");
+    }
+
+    if (!g_spentindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index not enabled. Use -spentindex to enable spent output queries");
+    }
+    bool index_ready = g_spentindex->BlockUntilSyncedToCurrentChain();
+
+    SpentInfo info;
+    if (!g_spentindex->LookupSpent(COutPoint(txid, n), info)) {
+        std::string errmsg = "Output not spent in the active chain";
+        if (!index_ready) {
+            errmsg += ", or not indexed yet because the spent index is still syncing";
+        }
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, errmsg);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("txid", info.txid.GetHex());
+    result.pushKV("vin", (int64_t)info.input_index);
+    result.pushKV("height", info.height);
+    result.pushKV("amount", ValueFromAmount(info.amount));
+    return result;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2322,6 +2683,11 @@ static const CRPCCommand commands[] =
 
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "getaddressbalance",      &getaddressbalance,      {"addresses"} },
+    { "blockchain",         "getaddressutxos",        &getaddressutxos,        {"addresses", "start", "end"} },
+    { "blockchain",         "getaddresstxids",        &getaddresstxids,        {"addresses", "start", "end"} },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           {"txid", "n"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
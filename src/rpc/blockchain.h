@@ -5,6 +5,7 @@
 #ifndef BITCOIN_RPC_BLOCKCHAIN_H
 #define BITCOIN_RPC_BLOCKCHAIN_H
 
+#include <string>
 #include <vector>
 #include <stdint.h>
 #include <amount.h>
@@ -38,6 +39,12 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex);
 
+/** Address index balance, unspent outputs and transaction ids to JSON, throws a JSONRPCError if
+ *  -addressindex is off or an address is invalid */
+UniValue addressBalanceToJSON(const std::vector<std::string>& addresses);
+UniValue addressUtxosToJSON(const std::vector<std::string>& addresses, int start_height, int end_height);
+UniValue addressTxidsToJSON(const std::vector<std::string>& addresses, int start_height, int end_height);
+
 /** Used by getblockstats to get feerates at different percentiles by weight  */
 void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
 
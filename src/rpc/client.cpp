@@ -36,6 +36,14 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "generatetoaddress", 2, "maxtries" },
     { "getnetworkhashps", 0, "nblocks" },
     { "getnetworkhashps", 1, "height" },
+    { "getaddressbalance", 0, "addresses" },
+    { "getaddressutxos", 0, "addresses" },
+    { "getaddressutxos", 1, "start" },
+    { "getaddressutxos", 2, "end" },
+    { "getaddresstxids", 0, "addresses" },
+    { "getaddresstxids", 1, "start" },
+    { "getaddresstxids", 2, "end" },
+    { "getspentinfo", 1, "n" },
     { "sendtoaddress", 1, "amount" },
     { "sendtoaddress", 4, "subtractfeefromamount" },
     { "sendtoaddress", 5 , "replaceable" },
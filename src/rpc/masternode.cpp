@@ -33,6 +33,7 @@ UniValue getqueueinfo(const JSONRPCRequest& request)
 
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("state",             coinJoinServer.GetStateString());
+    obj.pushKV("sessions",          coinJoinServer.GetSessionCount());
     obj.pushKV("queue",             coinJoinServer.GetQueueSize());
     obj.pushKV("entries",           coinJoinServer.GetEntriesCount());
     return obj;
@@ -133,7 +134,6 @@ UniValue masternode(const JSONRPCRequest& request)
             pindex = chainActive.Tip();
         }
         nHeight = pindex->nHeight + (strCommand == "current" ? 1 : 10);
-        mnodeman.UpdateLastPaid(pindex);
 
         if(!mnodeman.GetNextMasternodeInQueueForPayment(nHeight, true, nCount, mnInfo))
             return "unknown";
@@ -387,15 +387,6 @@ UniValue masternodelist(const JSONRPCRequest& request)
                 );
     }
 
-    if (strMode == "full" || strMode == "json" || strMode == "lastpaidtime" || strMode == "lastpaidblock") {
-        CBlockIndex* pindex = nullptr;
-        {
-            LOCK(cs_main);
-            pindex = chainActive.Tip();
-        }
-        mnodeman.UpdateLastPaid(pindex);
-    }
-
     UniValue obj(UniValue::VOBJ);
     if (strMode == "rank") {
         CMasternodeMan::rank_pair_vec_t vMasternodeRanks;
@@ -406,9 +397,9 @@ UniValue masternodelist(const JSONRPCRequest& request)
             obj.pushKV(strOutpoint, rankpair.first);
         }
     } else {
-        std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
-        for (const auto& mnpair : mapMasternodes) {
-            CMasternode mn = mnpair.second;
+        std::shared_ptr<const std::map<COutPoint, CMasternode> > pmapMasternodes = mnodeman.GetFullMasternodeMap();
+        for (const auto& mnpair : *pmapMasternodes) {
+            const CMasternode& mn = mnpair.second;
             std::string strOutpoint = mnpair.first.ToStringShort();
             if (strMode == "activeseconds") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
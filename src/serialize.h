@@ -176,6 +176,9 @@ enum
     SER_NETWORK         = (1 << 0),
     SER_DISK            = (1 << 1),
     SER_GETHASH         = (1 << 2),
+
+    // module cache state, without the maps CModuleCacheDB stores entry by entry
+    SER_MODULECACHE     = (1 << 3),
 };
 
 //! Convert the reference base type to X, without changing constness or reference type.
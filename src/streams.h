@@ -845,6 +845,8 @@ public:
     //! search for a given byte in the stream, and remain positioned on it
     void FindByte(char ch) {
         while (true) {
+            if (nReadPos == nReadLimit)
+                throw std::ios_base::failure("Find attempted past buffer limit");
             if (nReadPos == nSrcPos)
                 Fill();
             if (vchBuf[nReadPos % vchBuf.size()] == ch)
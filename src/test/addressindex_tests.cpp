@@ -0,0 +1,269 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/addressindex.h>
+#include <script/standard.h>
+#include <test/test_chaincoin.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+void WaitForSync(AddressIndex& addressindex)
+{
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addressindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+    // blocks disconnected at the tip don't keep BlockUntilSyncedToCurrentChain waiting
+    SyncWithValidationInterfaceQueue();
+}
+
+/** Balance of a script from its deltas, checked against its unspent outputs */
+CAmount GetBalance(const AddressIndex& addressindex, const CScript& script)
+{
+    std::vector<AddressDelta> deltas;
+    std::vector<AddressUnspent> unspent;
+    BOOST_CHECK(addressindex.LookupDeltas(script, 0, std::numeric_limits<int>::max(), deltas));
+    BOOST_CHECK(addressindex.LookupUnspent(script, 0, std::numeric_limits<int>::max(), unspent));
+
+    CAmount balance = 0, unspent_total = 0;
+    for (const auto& delta : deltas) balance += delta.amount;
+    for (const auto& out : unspent) unspent_total += out.amount;
+    BOOST_CHECK_EQUAL(balance, unspent_total);
+    return balance;
+}
+
+bool IsUnspent(const AddressIndex& addressindex, const CScript& script, const COutPoint& outpoint)
+{
+    std::vector<AddressUnspent> unspent;
+    BOOST_CHECK(addressindex.LookupUnspent(script, 0, std::numeric_limits<int>::max(), unspent));
+    for (const auto& out : unspent) {
+        if (out.outpoint == outpoint) return true;
+    }
+    return false;
+}
+
+/** Every delta and unspent output of the scripts, in index order */
+std::string DumpScripts(const AddressIndex& addressindex, const std::vector<CScript>& scripts)
+{
+    std::string dump;
+    for (const CScript& script : scripts) {
+        std::vector<AddressDelta> deltas;
+        std::vector<AddressUnspent> unspent;
+        BOOST_CHECK(addressindex.LookupDeltas(script, 0, std::numeric_limits<int>::max(), deltas));
+        BOOST_CHECK(addressindex.LookupUnspent(script, 0, std::numeric_limits<int>::max(), unspent));
+        for (const auto& delta : deltas) {
+            dump += strprintf("delta %d %u %s %u %d %d\n", delta.height, delta.tx_pos, delta.txid.ToString(),
+                              delta.index, delta.spending, delta.amount);
+        }
+        for (const auto& out : unspent) {
+            dump += strprintf("unspent %s %d %d\n", out.outpoint.ToString(), out.height, out.amount);
+        }
+    }
+    return dump;
+}
+
+/** A transaction paying the first output of a coinbase paying to key to script */
+CMutableTransaction SpendCoinbase(const CKey& key, const CTransactionRef& coinbase, const CScript& script)
+{
+    const CScript coinbase_script = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.emplace_back(coinbase->GetHash(), 0);
+    spend.vout.emplace_back(coinbase->vout[0].nValue - CENT, script);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbase_script, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    return spend;
+}
+
+CScript NewScript()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return GetScriptForDestination(key.GetPubKey().GetID());
+}
+
+void DisconnectTip()
+{
+    CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    CValidationState state;
+    BOOST_REQUIRE(InvalidateBlock(state, Params(), tip));
+    BOOST_REQUIRE(ActivateBestChain(state, Params()));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(addressindex_connect_disconnect, TestChain100Setup)
+{
+    std::unique_ptr<AddressIndex> addressindex = MakeUnique<AddressIndex>(1 << 20, false, true);
+    addressindex->Start();
+    WaitForSync(*addressindex);
+
+    CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CKey key;
+    key.MakeNewKey(true);
+    CScript dest_script = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // The coinbase outputs of the initial chain are indexed
+    const CAmount coinbase_value = m_coinbase_txns[0]->vout[0].nValue;
+    const COutPoint coinbase_outpoint(m_coinbase_txns[0]->GetHash(), 0);
+    const CAmount initial_balance = GetBalance(*addressindex, coinbase_script);
+    BOOST_CHECK_GE(initial_balance, 100 * coinbase_value);
+    BOOST_CHECK(IsUnspent(*addressindex, coinbase_script, coinbase_outpoint));
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, dest_script), 0);
+
+    // Spend the first coinbase output to another script
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.emplace_back(coinbase_outpoint);
+    spend.vout.emplace_back(5 * COIN, dest_script);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbase_script, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script = GetScriptForDestination(other_key.GetPubKey().GetID());
+    CreateAndProcessBlock({spend}, other_script);
+    WaitForSync(*addressindex);
+
+    std::vector<AddressDelta> deltas;
+    BOOST_CHECK(addressindex->LookupDeltas(dest_script, 0, std::numeric_limits<int>::max(), deltas));
+    BOOST_REQUIRE_EQUAL(deltas.size(), 1U);
+    BOOST_CHECK_EQUAL(deltas[0].height, 101);
+    BOOST_CHECK_EQUAL(deltas[0].tx_pos, 1U);
+    BOOST_CHECK(deltas[0].txid == spend.GetHash());
+    BOOST_CHECK(!deltas[0].spending);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, dest_script), 5 * COIN);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, coinbase_script), initial_balance - coinbase_value);
+    BOOST_CHECK(!IsUnspent(*addressindex, coinbase_script, coinbase_outpoint));
+
+    // Disconnecting the block removes its entries and restores the spent output
+    DisconnectTip();
+    WaitForSync(*addressindex);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, dest_script), 0);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, coinbase_script), initial_balance);
+    BOOST_CHECK(IsUnspent(*addressindex, coinbase_script, coinbase_outpoint));
+
+    // Connect it again in another block, then restart the index
+    CKey miner_key;
+    miner_key.MakeNewKey(true);
+    CreateAndProcessBlock({spend}, GetScriptForDestination(miner_key.GetPubKey().GetID()));
+    WaitForSync(*addressindex);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, dest_script), 5 * COIN);
+
+    addressindex->Stop();
+    addressindex.reset();
+    addressindex = MakeUnique<AddressIndex>(1 << 20, false, false);
+    addressindex->Start();
+    WaitForSync(*addressindex);
+
+    // The index resumes from the last block it wrote, without adding it twice
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, dest_script), 5 * COIN);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, coinbase_script), initial_balance - coinbase_value);
+    BOOST_CHECK(!IsUnspent(*addressindex, coinbase_script, coinbase_outpoint));
+
+    // Blocks disconnected while the index is stopped are removed when it starts again
+    addressindex->Stop();
+    addressindex.reset();
+    DisconnectTip();
+    CreateAndProcessBlock({}, other_script);
+    addressindex = MakeUnique<AddressIndex>(1 << 20, false, false);
+    addressindex->Start();
+    WaitForSync(*addressindex);
+
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, dest_script), 0);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, coinbase_script), initial_balance);
+    BOOST_CHECK(IsUnspent(*addressindex, coinbase_script, coinbase_outpoint));
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex->Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_pipelined_sync, TestChain100Setup)
+{
+    const CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CScript dest_script = NewScript();
+    const CScript reorg_script = NewScript();
+    std::vector<CScript> miner_scripts;
+
+    // Blocks spending the initial coinbase outputs
+    for (int i = 0; i < 10; i++) {
+        miner_scripts.push_back(NewScript());
+        CreateAndProcessBlock({SpendCoinbase(coinbaseKey, m_coinbase_txns[i], dest_script)}, miner_scripts.back());
+    }
+
+    // Sync with read-ahead workers, which build the entries of the blocks
+    gArgs.ForceSetArg("-indexsyncworkers", "4");
+    std::unique_ptr<AddressIndex> addressindex = MakeUnique<AddressIndex>(1 << 20, false, true);
+    addressindex->Start();
+    WaitForSync(*addressindex);
+    addressindex->Stop();
+    addressindex.reset();
+
+    // Reorganize the chain while the index is stopped: the disconnected spends are replaced by others
+    for (int i = 0; i < 3; i++) {
+        DisconnectTip();
+    }
+    for (int i = 7; i < 11; i++) {
+        miner_scripts.push_back(NewScript());
+        CreateAndProcessBlock({SpendCoinbase(coinbaseKey, m_coinbase_txns[i], reorg_script)}, miner_scripts.back());
+    }
+    addressindex = MakeUnique<AddressIndex>(1 << 20, false, false);
+    addressindex->Start();
+    WaitForSync(*addressindex);
+
+    std::vector<CScript> scripts{coinbase_script, dest_script, reorg_script};
+    scripts.insert(scripts.end(), miner_scripts.begin(), miner_scripts.end());
+    const std::string dump_pipelined = DumpScripts(*addressindex, scripts);
+    addressindex->Stop();
+    addressindex.reset();
+
+    // Sync from scratch on the index thread alone
+    gArgs.ForceSetArg("-indexsyncworkers", "0");
+    addressindex = MakeUnique<AddressIndex>(1 << 20, false, true);
+    addressindex->Start();
+    WaitForSync(*addressindex);
+    const std::string dump_sequential = DumpScripts(*addressindex, scripts);
+
+    // Both syncs index the same entries, without those of the disconnected blocks
+    BOOST_CHECK_EQUAL(dump_pipelined, dump_sequential);
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, dest_script), 7 * (m_coinbase_txns[0]->vout[0].nValue - CENT));
+    BOOST_CHECK_EQUAL(GetBalance(*addressindex, reorg_script), 4 * (m_coinbase_txns[0]->vout[0].nValue - CENT));
+    for (int i = 7; i < 10; i++) {
+        BOOST_CHECK_EQUAL(GetBalance(*addressindex, miner_scripts[i]), 0);
+    }
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex->Stop();
+    gArgs.ForceSetArg("-indexsyncworkers", std::to_string(std::min(GetNumCores(), MAX_INDEX_SYNC_WORKERS)));
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <modules/coinjoin/coinjoin.h>
+#include <streams.h>
+
+#include <test/test_chaincoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+class TestCoinJoinManager : public CCoinJoinBaseManager
+{
+public:
+    void AddQueue(const CCoinJoinQueue& queue)
+    {
+        LOCK(cs_vecqueue);
+        vecCoinJoinQueue.push_back(queue);
+    }
+
+    using CCoinJoinBaseManager::RemoveQueue;
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(coinjoin_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(queue_sessions)
+{
+    // a masternode running two sessions with the same denomination
+    const COutPoint outpoint(InsecureRand256(), 0);
+    CCoinJoinQueue queue1(COINJOIN_BASE_DENOM, outpoint, 100, STATUS_OPEN, 1);
+    CCoinJoinQueue queue2(COINJOIN_BASE_DENOM, outpoint, 101, STATUS_OPEN, 2);
+
+    // The queues are neither duplicates nor updates of each other
+    BOOST_CHECK(!(queue1 == queue2));
+    BOOST_CHECK(!(queue1 != queue2));
+
+    // Status updates only match the queue of their own session
+    CCoinJoinQueue queue1Full(queue1);
+    queue1Full.status = STATUS_FULL;
+    BOOST_CHECK(queue1Full != queue1);
+    BOOST_CHECK(!(queue1Full != queue2));
+
+    // The session id is relayed and signed with the queue
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << queue2;
+    CCoinJoinQueue queueReceived;
+    ss >> queueReceived;
+    BOOST_CHECK(queueReceived == queue2);
+    queueReceived.nSessionID = 1;
+    BOOST_CHECK(queueReceived.GetSignatureHash() != queue2.GetSignatureHash());
+
+    // Finishing one session drops its queue only, whatever the order the queues came in
+    TestCoinJoinManager manager;
+    manager.AddQueue(queue1);
+    manager.AddQueue(queue2);
+    manager.RemoveQueue(CCoinJoinQueue(COINJOIN_BASE_DENOM, outpoint, 0, STATUS_CLOSED, 2));
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 1);
+    manager.RemoveQueue(CCoinJoinQueue(COINJOIN_BASE_DENOM, outpoint, 0, STATUS_CLOSED, 2));
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 1);
+
+    CCoinJoinQueue queueLeft;
+    BOOST_CHECK(manager.GetQueueItem(queueLeft));
+    BOOST_CHECK(queueLeft == queue1);
+
+    manager.RemoveQueue(queue1Full);
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <consensus/validation.h>
+#include <index/coinjoinindex.h>
+#include <modules/coinjoin/coinjoin.h>
+#include <script/sign.h>
+#include <test/test_chaincoin.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** A transaction spending outputs paid to key, paying values to the same script */
+CMutableTransaction CreateSpend(const CKey& key, const std::vector<COutPoint>& vecPrevouts, const std::vector<CAmount>& vecValues)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction mtx;
+    mtx.nVersion = 1;
+    for (const auto& prevout : vecPrevouts) {
+        mtx.vin.emplace_back(prevout);
+    }
+    for (const auto& value : vecValues) {
+        mtx.vout.emplace_back(value, scriptPubKey);
+    }
+    for (size_t i = 0; i < mtx.vin.size(); i++) {
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, mtx, i, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(key.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        mtx.vin[i].scriptSig << vchSig;
+    }
+    return mtx;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(coinjoinindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(coinjoinindex_depths, TestChain100Setup)
+{
+    CoinJoinIndex coinjoinindex(1 << 20, true);
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    // mature the second coinbase output
+    CreateAndProcessBlock({}, scriptPubKey);
+
+    // denominated outputs next to a non-denominated one, and only denominated outputs
+    CMutableTransaction txMixed = CreateSpend(coinbaseKey, {COutPoint(m_coinbase_txns[0]->GetHash(), 0)},
+                                              {COINJOIN_BASE_DENOM, COINJOIN_BASE_DENOM, COIN});
+    CMutableTransaction txDenoms = CreateSpend(coinbaseKey, {COutPoint(m_coinbase_txns[1]->GetHash(), 0)},
+                                               {COINJOIN_BASE_DENOM, COINJOIN_BASE_DENOM, COINJOIN_BASE_DENOM << 1});
+    CreateAndProcessBlock({txMixed, txDenoms}, scriptPubKey);
+
+    coinjoinindex.Start();
+
+    // Allow coinjoin index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!coinjoinindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    int depth;
+    BOOST_CHECK(coinjoinindex.LookupDepth(COutPoint(txMixed.GetHash(), 0), COINJOIN_BASE_DENOM, depth));
+    BOOST_CHECK_EQUAL(depth, 0);
+    BOOST_CHECK(coinjoinindex.LookupDepth(COutPoint(txMixed.GetHash(), 2), COIN, depth));
+    BOOST_CHECK_EQUAL(depth, -2);
+    BOOST_CHECK(coinjoinindex.LookupDepth(COutPoint(txDenoms.GetHash(), 2), COINJOIN_BASE_DENOM << 1, depth));
+    BOOST_CHECK_EQUAL(depth, 1);
+
+    // Non-denominated outputs of transactions which are not indexed are not denominated either
+    BOOST_CHECK(coinjoinindex.LookupDepth(COutPoint(m_coinbase_txns[2]->GetHash(), 0), m_coinbase_txns[2]->vout[0].nValue, depth));
+    BOOST_CHECK_EQUAL(depth, -2);
+    BOOST_CHECK(!coinjoinindex.LookupDepth(COutPoint(m_coinbase_txns[2]->GetHash(), 0), COINJOIN_BASE_DENOM, depth));
+    BOOST_CHECK(!coinjoinindex.LookupDepth(COutPoint(txMixed.GetHash(), 3), COINJOIN_BASE_DENOM, depth));
+
+    // Mempool transactions get their depth from the outputs they spend
+    CMutableTransaction txMempool = CreateSpend(coinbaseKey, {COutPoint(txDenoms.GetHash(), 0), COutPoint(txDenoms.GetHash(), 1)},
+                                                {COINJOIN_BASE_DENOM, COINJOIN_BASE_DENOM >> 1});
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(txMempool), nullptr /* pfMissingInputs */,
+                                       nullptr /* plTxnReplaced */, true /* bypass_limits */, 0 /* nAbsurdFee */));
+    }
+    BOOST_CHECK(coinjoinindex.LookupDepth(COutPoint(txMempool.GetHash(), 1), COINJOIN_BASE_DENOM >> 1, depth));
+    BOOST_CHECK_EQUAL(depth, 2);
+    mempool.clear();
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    coinjoinindex.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cachedb.h>
+#include <modules/masternode/masternode_man.h>
+#include <modules/masternode/masternode_payments.h>
+#include <modules/platform/funding.h>
+#include <modules/platform/funding_object.h>
+#include <streams.h>
+
+#include <test/test_chaincoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** A funding object as read from disk, holding the vote records of mapVotes and the votes of fileVotes */
+void ReadObjectWithVotes(CGovernanceObject& govobj, const CGovernanceObject::vote_m_t& mapVotes,
+                         const CGovernanceObjectVoteFile& fileVotes = CGovernanceObjectVoteFile())
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << uint256() << 0 << int64_t{0} << uint256() << std::vector<unsigned char>() << GOVERNANCE_OBJECT_PROPOSAL << COutPoint() << std::vector<unsigned char>();
+    ss << int64_t{0} << false << mapVotes << fileVotes;
+    ss >> govobj;
+}
+
+/** A funding manager as read from funding.dat, holding mapObjects */
+void ReadManagerWithObjects(CGovernanceManager& fundingOut, const std::map<uint256, CGovernanceObject>& mapObjects)
+{
+    // an empty manager ends with the sizes of its objects and last masternode objects, swap in our objects
+    CDataStream ssEmpty(SER_DISK, CLIENT_VERSION);
+    ssEmpty << CGovernanceManager();
+    CDataStream ss(ssEmpty.begin(), ssEmpty.end() - 2, SER_DISK, CLIENT_VERSION);
+    ss << mapObjects << std::map<COutPoint, CGovernanceManager::last_object_rec>();
+    ss >> fundingOut;
+}
+
+vote_rec_t MakeVoteRecord(const std::map<vote_signal_enum_t, vote_outcome_enum_t>& mapOutcomes)
+{
+    vote_rec_t voteRecord;
+    for (const auto& outcomePair : mapOutcomes) {
+        voteRecord.mapInstances[outcomePair.first] = vote_instance_t(outcomePair.second, 1, 1);
+    }
+    return voteRecord;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(funding_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(object_vote_counts)
+{
+    CGovernanceObject::vote_m_t mapVotes;
+    mapVotes[COutPoint(InsecureRand256(), 0)] = MakeVoteRecord({{VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES}, {VOTE_SIGNAL_DELETE, VOTE_OUTCOME_YES}});
+    mapVotes[COutPoint(InsecureRand256(), 0)] = MakeVoteRecord({{VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES}});
+    mapVotes[COutPoint(InsecureRand256(), 0)] = MakeVoteRecord({{VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES}, {VOTE_SIGNAL_ENDORSED, VOTE_OUTCOME_NO}});
+    mapVotes[COutPoint(InsecureRand256(), 0)] = MakeVoteRecord({{VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO}});
+    mapVotes[COutPoint(InsecureRand256(), 0)] = MakeVoteRecord({{VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_ABSTAIN}});
+
+    // The counts are rebuilt from the vote records read from disk
+    CGovernanceObject govobj;
+    ReadObjectWithVotes(govobj, mapVotes);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetAbstainCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobj.GetAbsoluteNoCount(VOTE_SIGNAL_FUNDING), -2);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_DELETE), 1);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_ENDORSED), 1);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_VALID), 0);
+
+    // Unsupported signals are recounted and find nothing
+    BOOST_CHECK_EQUAL(govobj.CountMatchingVotes(VOTE_SIGNAL_NONE, VOTE_OUTCOME_YES), 0);
+
+    // Copies keep the counts
+    CGovernanceObject govobjCopy(govobj);
+    BOOST_CHECK_EQUAL(govobjCopy.GetYesCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(govobjCopy.GetNoCount(VOTE_SIGNAL_ENDORSED), 1);
+
+    // Reading other vote records replaces the counts
+    CGovernanceObject::vote_m_t mapVotesOther;
+    mapVotesOther[COutPoint(InsecureRand256(), 0)] = MakeVoteRecord({{VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO}});
+    ReadObjectWithVotes(govobj, mapVotesOther);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 0);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_DELETE), 0);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_ENDORSED), 0);
+}
+
+BOOST_AUTO_TEST_CASE(vote_file_spills_on_flush)
+{
+    // spilled votes are read back through the global database
+    g_modulecachedb = MakeUnique<CModuleCacheDB>(1 << 20, true);
+    CModuleCacheDB& db = *g_modulecachedb;
+    CMasternodeMan man;
+    CMasternodePayments payments;
+
+    // one object with 5 votes over the 1000 kept in memory
+    const uint256 nParentHash = InsecureRand256();
+    std::vector<CGovernanceVote> vecVotes;
+    CGovernanceObjectVoteFile fileVotes;
+    for (int i = 0; i < 1005; i++) {
+        vecVotes.emplace_back(COutPoint(InsecureRand256(), 0), nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+        fileVotes.AddVote(vecVotes.back());
+    }
+    CGovernanceObject govobj;
+    ReadObjectWithVotes(govobj, {}, fileVotes);
+    const uint256 nHash = govobj.GetHash();
+
+    // Nothing is spilled while reading
+    CGovernanceManager fundingMigrated;
+    ReadManagerWithObjects(fundingMigrated, {{nHash, govobj}});
+    CGovernanceVote vote;
+    BOOST_CHECK(!db.ReadGovernanceVote(vecVotes.front().GetHash(), vote));
+
+    // The oldest votes are written with the object and still served after leaving memory
+    BOOST_CHECK(db.Flush(man, payments, fundingMigrated));
+    for (int i = 0; i < 5; i++) {
+        BOOST_CHECK(db.ReadGovernanceVote(vecVotes[i].GetHash(), vote));
+        BOOST_CHECK(vote.GetHash() == vecVotes[i].GetHash());
+    }
+    BOOST_CHECK(!db.ReadGovernanceVote(vecVotes[5].GetHash(), vote));
+    BOOST_CHECK_EQUAL(fundingMigrated.GetMatchingVotes(nHash).size(), 1005U);
+
+    CGovernanceManager fundingLoaded;
+    BOOST_CHECK(db.Read(fundingLoaded));
+    CGovernanceObject* pObj = fundingLoaded.FindGovernanceObject(nHash);
+    BOOST_REQUIRE(pObj);
+    BOOST_CHECK_EQUAL(pObj->GetVoteFile().GetVoteCount(), 1005);
+    BOOST_CHECK_EQUAL(pObj->GetVoteFile().GetDiskVoteHashes().size(), 5U);
+    BOOST_CHECK(pObj->GetVoteFile().HasVote(vecVotes.front().GetHash()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(pObj->GetVoteFile().SerializeVoteToStream(vecVotes.front().GetHash(), ss));
+    BOOST_CHECK_EQUAL(fundingLoaded.GetMatchingVotes(nHash).size(), 1005U);
+
+    // Spilled votes are erased with their object
+    fundingMigrated.Clear();
+    BOOST_CHECK(db.Flush(man, payments, fundingMigrated));
+    BOOST_CHECK(!db.ReadGovernanceVote(vecVotes.front().GetHash(), vote));
+    g_modulecachedb.reset();
+}
+
+BOOST_AUTO_TEST_CASE(vote_filter_missing)
+{
+    std::vector<uint256> vecHave, vecAll;
+    std::set<uint256> setNew;
+    for (int i = 0; i < 1000; i++) {
+        vecHave.push_back(InsecureRand256());
+    }
+    vecAll = vecHave;
+    for (int i = 0; i < 100; i++) {
+        vecAll.push_back(InsecureRand256());
+        setNew.insert(vecAll.back());
+    }
+
+    // A peer without the object gets all votes
+    BOOST_CHECK(CGovernanceVoteFilter().GetMissing(vecAll) == vecAll);
+
+    // A peer which has them all gets nothing, whatever the order
+    CGovernanceVoteFilter filter(vecHave);
+    std::vector<uint256> vecShuffled(vecHave.rbegin(), vecHave.rend());
+    BOOST_CHECK(filter.GetMissing(vecShuffled).empty());
+
+    // Otherwise only votes the peer doesn't have are sent, short of rare false positives
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << filter;
+    CGovernanceVoteFilter filterReceived;
+    ss >> filterReceived;
+    std::vector<uint256> vecMissing = filterReceived.GetMissing(vecAll);
+    for (const auto& nHash : vecMissing) {
+        BOOST_CHECK(setNew.count(nHash));
+    }
+    BOOST_CHECK_GE(vecMissing.size(), 90U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
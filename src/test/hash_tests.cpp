@@ -4,9 +4,13 @@
 
 #include <crypto/siphash.h>
 #include <hash.h>
+#include <primitives/block.h>
+#include <streams.h>
 #include <util/strencodings.h>
 #include <test/test_chaincoin.h>
 
+#include <atomic>
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -148,4 +152,90 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(blockheader_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = uint256S("0x000000000000000000000000000000000000000000000000000000000000abcd");
+    header.nTime = 1554076800;
+    header.nBits = 0x1d00ffff;
+    header.nNonce = 42;
+
+    const uint256 hash = header.GetHash();
+    BOOST_CHECK(hash == HashC11((char*)&(header.nVersion), (char*)&((&(header.nNonce))[1])));
+    BOOST_CHECK(header.GetHash() == hash);
+
+    // Writing a field directly must not return the stale cached hash
+    header.nNonce++;
+    const uint256 hash2 = header.GetHash();
+    BOOST_CHECK(hash2 != hash);
+    BOOST_CHECK(hash2 == HashC11((char*)&(header.nVersion), (char*)&((&(header.nNonce))[1])));
+
+    // Copies carry the cache, deserialization and SetNull reset it
+    CBlockHeader copy(header);
+    BOOST_CHECK(copy.GetHash() == hash2);
+    header.nNonce--;
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << header;
+    ss >> copy;
+    BOOST_CHECK(copy.GetHash() == hash);
+    copy.SetNull();
+    BOOST_CHECK(copy.GetHash() == CBlockHeader().GetHash());
+
+    CBlock block(header);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash);
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_hash_cache_threads)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.nBits = 0x1d00ffff;
+    header.nNonce = 7;
+    const uint256 expected = HashC11((char*)&(header.nVersion), (char*)&((&(header.nNonce))[1]));
+
+    // Readers and copies racing on one header never see a wrong hash
+    std::vector<std::thread> threads;
+    std::atomic<int> nErrors(0);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 200; i++) {
+                if (header.GetHash() != expected) nErrors++;
+                CBlockHeader copy(header);
+                if (copy.GetHash() != expected) nErrors++;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(nErrors, 0);
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_hash_batch)
+{
+    // Cover empty input, partial lanes and several full lanes
+    for (size_t n : {0, 1, 3, 4, 8, 9, 17, 40}) {
+        std::vector<CBlockHeader> headers(n);
+        std::vector<uint256> expected(n);
+        for (size_t i = 0; i < n; i++) {
+            headers[i].nVersion = 4;
+            headers[i].hashPrevBlock = InsecureRand256();
+            headers[i].hashMerkleRoot = InsecureRand256();
+            headers[i].nTime = InsecureRand32();
+            headers[i].nBits = 0x1d00ffff;
+            headers[i].nNonce = InsecureRand32();
+            expected[i] = HashC11((char*)&(headers[i].nVersion), (char*)&((&(headers[i].nNonce))[1]));
+            // Prime every third cache so cached and uncached headers are mixed
+            if (i % 3 == 0) headers[i].GetHash();
+        }
+
+        std::vector<uint256> hashes(n);
+        HashC11Batch(headers.data(), n, hashes.data());
+        BOOST_CHECK(hashes == expected);
+        for (size_t i = 0; i < n; i++) {
+            BOOST_CHECK(headers[i].GetHash() == expected[i]);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
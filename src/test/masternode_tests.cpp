@@ -0,0 +1,435 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cachedb.h>
+#include <key.h>
+#include <modules/masternode/masternode_man.h>
+#include <modules/masternode/masternode_payments.h>
+#include <modules/masternode/masternode_sync.h>
+#include <modules/platform/funding.h>
+#include <net.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <validation.h>
+
+#include <test/test_chaincoin.h>
+
+#include <future>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Gives the tests access to the last paid index of CMasternodeMan */
+class CMasternodeManTest : public CMasternodeMan
+{
+public:
+    using CMasternodeMan::ConnectLastPaid;
+    using CMasternodeMan::DisconnectLastPaid;
+    using CMasternodeMan::PruneLastPaid;
+    using CMasternodeMan::mapPayeeLastPaid;
+    using CMasternodeMan::nLastPaidHeight;
+    using CMasternodeMan::cs;
+    using CMasternodeMan::Find;
+    using CMasternodeMan::GetMasternodeScores;
+    using CMasternodeMan::RankCacheRemove;
+    using CMasternodeMan::listRankCache;
+    using CMasternodeMan::mapMasternodes;
+    using CMasternodeMan::setPaymentQueue;
+    using CMasternodeMan::vecPendingMessages;
+    using CMasternodeMan::cs_vecPendingMessages;
+    using CMasternodeMan::setCacheDirtyMasternodes;
+    using CMasternodeMan::fCacheStateDirty;
+
+    void QueuePing(CNode* pfrom)
+    {
+        LOCK(cs_vecPendingMessages);
+        pfrom->AddRef();
+        vecPendingMessages.push_back(CPendingMasternodeMessage{pfrom, true, CMasternodeBroadcast(), CMasternodePing()});
+    }
+};
+
+/** Switch masternodeSync to the winners list stage for the lifetime of the object */
+struct MasternodeListSynced
+{
+    MasternodeListSynced()
+    {
+        masternodeSync.Reset();
+        while (!masternodeSync.IsMasternodeListSynced()) masternodeSync.SwitchToNextAsset(nullptr);
+    }
+    ~MasternodeListSynced() { masternodeSync.Reset(); }
+};
+
+std::vector<COutPoint> RankingOutpoints(const CMasternodeMan::score_pair_vec_t* pvecScores)
+{
+    std::vector<COutPoint> vecOutpoints;
+    if (!pvecScores) return vecOutpoints;
+    for (const auto& scorePair : *pvecScores) {
+        vecOutpoints.push_back(scorePair.second->outpoint);
+    }
+    return vecOutpoints;
+}
+
+CMasternode MakeMasternode(const CKey& keyCollateral, uint32_t n)
+{
+    CKey keyMasternode;
+    keyMasternode.MakeNewKey(true);
+    COutPoint outpoint(InsecureRand256(), n);
+    CTxDestination dest = keyCollateral.GetPubKey().GetID();
+    return CMasternode(CService(), outpoint, keyCollateral.GetPubKey(), dest, keyMasternode.GetPubKey(), PROTOCOL_VERSION);
+}
+
+/** A block at nHeight whose coinbase pays the masternode amount to payee */
+CBlock MakePaymentBlock(int nHeight, const CScript& payee)
+{
+    const CAmount nReward = 100 * COIN;
+    const CAmount nPayment = GetMasternodePayment(nHeight, nReward);
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    coinbase.vout.emplace_back(nReward - nPayment, CScript() << OP_TRUE);
+    coinbase.vout.emplace_back(nPayment, payee);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+    return block;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(masternode_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(last_paid_connect_disconnect)
+{
+    CMasternodeManTest man;
+    CKey key;
+    key.MakeNewKey(true);
+    CMasternode mn = MakeMasternode(key, 0);
+    BOOST_CHECK(man.Add(mn));
+    const CScript payee = GetScriptForDestination(mn.collDest);
+
+    LOCK(man.cs);
+
+    // Payments are only counted for payees which got payment votes
+    CBlock block = MakePaymentBlock(10, payee);
+    man.ConnectLastPaid(block, std::set<CScript>(), 10, 1000);
+    BOOST_CHECK_EQUAL(man.mapPayeeLastPaid.count(payee), 0U);
+    BOOST_CHECK_EQUAL(man.Find(mn.outpoint)->nBlockLastPaid, 0);
+    BOOST_CHECK_EQUAL(man.nLastPaidHeight, 10);
+
+    CBlock block2 = MakePaymentBlock(11, payee);
+    man.ConnectLastPaid(block2, {payee}, 11, 1100);
+    BOOST_CHECK_EQUAL(man.mapPayeeLastPaid.count(payee), 1U);
+    BOOST_CHECK_EQUAL(man.Find(mn.outpoint)->nBlockLastPaid, 11);
+    BOOST_CHECK_EQUAL(man.Find(mn.outpoint)->nTimeLastPaid, 1100);
+
+    // A payment of another amount does not count
+    CBlock block3 = MakePaymentBlock(12, payee);
+    CMutableTransaction coinbase(*block3.vtx[0]);
+    coinbase.vout[0].nValue += 1;
+    coinbase.vout[1].nValue -= 1;
+    block3.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    man.ConnectLastPaid(block3, {payee}, 12, 1200);
+    BOOST_CHECK_EQUAL(man.Find(mn.outpoint)->nBlockLastPaid, 11);
+
+    // Disconnecting the paying block forgets the payment
+    man.DisconnectLastPaid(block2, 11);
+    BOOST_CHECK_EQUAL(man.mapPayeeLastPaid.count(payee), 0U);
+    BOOST_CHECK_EQUAL(man.Find(mn.outpoint)->nBlockLastPaid, 0);
+    BOOST_CHECK_EQUAL(man.nLastPaidHeight, 10);
+}
+
+BOOST_AUTO_TEST_CASE(last_paid_prune)
+{
+    CMasternodeManTest man;
+    CKey key;
+    key.MakeNewKey(true);
+    CMasternode mn = MakeMasternode(key, 0);
+    BOOST_CHECK(man.Add(mn));
+    const CScript payee = GetScriptForDestination(mn.collDest);
+
+    CKey keyGone;
+    keyGone.MakeNewKey(true);
+    const CScript payeeGone = GetScriptForDestination(keyGone.GetPubKey().GetID());
+
+    LOCK(man.cs);
+    man.ConnectLastPaid(MakePaymentBlock(1, payee), {payee}, 1, 100);
+    man.ConnectLastPaid(MakePaymentBlock(2, payeeGone), {payeeGone}, 2, 200);
+    BOOST_CHECK_EQUAL(man.mapPayeeLastPaid.size(), 2U);
+
+    // Within the payment window nothing is pruned
+    man.PruneLastPaid();
+    BOOST_CHECK_EQUAL(man.mapPayeeLastPaid.size(), 2U);
+
+    // Past it, only the payee without a masternode is dropped
+    const int nHeight = 3 + mnpayments.GetStorageLimit();
+    man.ConnectLastPaid(MakePaymentBlock(nHeight, CScript() << OP_TRUE), std::set<CScript>(), nHeight, 300);
+    man.PruneLastPaid();
+    BOOST_CHECK_EQUAL(man.mapPayeeLastPaid.size(), 1U);
+    BOOST_CHECK_EQUAL(man.mapPayeeLastPaid.count(payee), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(masternode_list_snapshot)
+{
+    CMasternodeManTest man;
+    CKey key;
+    key.MakeNewKey(true);
+    CMasternode mn1 = MakeMasternode(key, 0);
+    BOOST_CHECK(man.Add(mn1));
+
+    // Readers share one snapshot until the list changes
+    auto pmap1 = man.GetFullMasternodeMap();
+    BOOST_CHECK_EQUAL(pmap1->size(), 1U);
+    BOOST_CHECK(man.GetFullMasternodeMap() == pmap1);
+
+    // A change hands out a new snapshot and leaves the old one alone
+    CMasternode mn2 = MakeMasternode(key, 1);
+    BOOST_CHECK(man.Add(mn2));
+    auto pmap2 = man.GetFullMasternodeMap();
+    BOOST_CHECK(pmap2 != pmap1);
+    BOOST_CHECK_EQUAL(pmap2->size(), 2U);
+    BOOST_CHECK_EQUAL(pmap1->size(), 1U);
+    BOOST_CHECK(pmap2->count(mn2.outpoint));
+}
+
+BOOST_AUTO_TEST_CASE(rank_cache_follows_list)
+{
+    MasternodeListSynced synced;
+    CMasternodeManTest man;
+    CKey key;
+    key.MakeNewKey(true);
+    for (uint32_t n = 0; n < 8; n++) {
+        CMasternode mn = MakeMasternode(key, n);
+        BOOST_CHECK(man.Add(mn));
+    }
+    const uint256 hash1 = InsecureRand256();
+    const uint256 hash2 = InsecureRand256();
+
+    LOCK(man.cs);
+    BOOST_CHECK_EQUAL(RankingOutpoints(man.GetMasternodeScores(hash1)).size(), 8U);
+    man.GetMasternodeScores(hash2);
+    BOOST_CHECK_EQUAL(man.listRankCache.size(), 2U);
+
+    // Added and removed masternodes are filed into the cached rankings,
+    // which then match rankings computed from scratch
+    CMasternode mnNew = MakeMasternode(key, 8);
+    BOOST_CHECK(man.Add(mnNew));
+    const COutPoint outpointGone = man.mapMasternodes.begin()->first;
+    man.RankCacheRemove(man.mapMasternodes.begin()->second);
+    man.setPaymentQueue.erase(std::make_pair(man.mapMasternodes.begin()->second.nBlockLastPaid, outpointGone));
+    man.mapMasternodes.erase(outpointGone);
+
+    std::vector<COutPoint> vecCached1 = RankingOutpoints(man.GetMasternodeScores(hash1));
+    std::vector<COutPoint> vecCached2 = RankingOutpoints(man.GetMasternodeScores(hash2));
+    BOOST_CHECK_EQUAL(man.listRankCache.size(), 2U);
+    man.listRankCache.clear();
+    BOOST_CHECK(RankingOutpoints(man.GetMasternodeScores(hash1)) == vecCached1);
+    BOOST_CHECK(RankingOutpoints(man.GetMasternodeScores(hash2)) == vecCached2);
+    BOOST_CHECK_EQUAL(vecCached1.size(), 8U);
+    BOOST_CHECK(std::find(vecCached1.begin(), vecCached1.end(), mnNew.outpoint) != vecCached1.end());
+    BOOST_CHECK(std::find(vecCached1.begin(), vecCached1.end(), outpointGone) == vecCached1.end());
+}
+
+BOOST_AUTO_TEST_CASE(payment_queue_order)
+{
+    CMasternodeManTest man;
+    std::vector<CScript> vecPayees;
+    std::vector<COutPoint> vecOutpoints;
+    for (uint32_t n = 0; n < 3; n++) {
+        CKey key;
+        key.MakeNewKey(true);
+        CMasternode mn = MakeMasternode(key, n);
+        BOOST_CHECK(man.Add(mn));
+        vecPayees.push_back(GetScriptForDestination(mn.collDest));
+        vecOutpoints.push_back(mn.outpoint);
+    }
+
+    LOCK(man.cs);
+    // Pay the masternodes in the order 2, 0, 1
+    man.ConnectLastPaid(MakePaymentBlock(10, vecPayees[2]), {vecPayees[2]}, 10, 100);
+    man.ConnectLastPaid(MakePaymentBlock(11, vecPayees[0]), {vecPayees[0]}, 11, 110);
+    man.ConnectLastPaid(MakePaymentBlock(12, vecPayees[1]), {vecPayees[1]}, 12, 120);
+
+    // The queue lists them least recently paid first, in step with nBlockLastPaid
+    BOOST_CHECK_EQUAL(man.setPaymentQueue.size(), 3U);
+    std::vector<COutPoint> vecQueue;
+    for (const auto& entry : man.setPaymentQueue) {
+        BOOST_CHECK_EQUAL(man.Find(entry.second)->nBlockLastPaid, entry.first);
+        vecQueue.push_back(entry.second);
+    }
+    BOOST_CHECK(vecQueue == std::vector<COutPoint>({vecOutpoints[2], vecOutpoints[0], vecOutpoints[1]}));
+
+    // Undoing a payment moves the masternode back to the front
+    man.DisconnectLastPaid(MakePaymentBlock(12, vecPayees[1]), 12);
+    BOOST_CHECK(man.setPaymentQueue.begin()->second == vecOutpoints[1]);
+    BOOST_CHECK_EQUAL(man.setPaymentQueue.size(), 3U);
+}
+
+BOOST_AUTO_TEST_CASE(pending_messages_release_nodes)
+{
+    CMasternodeManTest man;
+    CAddress addr(CService(), NODE_NONE);
+    CNode node1(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true);
+    CNode node2(2, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true);
+
+    // A finalized node gets its references back
+    man.QueuePing(&node1);
+    man.QueuePing(&node2);
+    man.QueuePing(&node1);
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 2);
+    man.ReleasePendingMessages(node1.GetId());
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 0);
+    BOOST_CHECK_EQUAL(node2.GetRefCount(), 1);
+    BOOST_CHECK_EQUAL(man.vecPendingMessages.size(), 1U);
+
+    // A disconnected node is not kept alive by its queued messages
+    man.QueuePing(&node1);
+    node2.fDisconnect = true;
+    man.ReleaseDisconnectedPendingMessages();
+    BOOST_CHECK_EQUAL(node2.GetRefCount(), 0);
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 1);
+
+    // Clear drops everything
+    man.Clear();
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 0);
+    BOOST_CHECK(man.vecPendingMessages.empty());
+}
+
+BOOST_AUTO_TEST_CASE(block_payees_tallies)
+{
+    const CScript payee1 = CScript() << OP_1;
+    const CScript payee2 = CScript() << OP_2;
+    auto vote = [](const CScript& payee) { return CMasternodePaymentVote(COutPoint(InsecureRand256(), 0), 100, payee); };
+
+    CMasternodeBlockPayees payees(100);
+    CScript payeeBest;
+    BOOST_CHECK(!payees.GetBestPayee(payeeBest));
+    BOOST_CHECK_EQUAL(payees.GetTotalVotes(), 0);
+
+    // The earliest payee wins a tie
+    payees.AddPayee(vote(payee1));
+    payees.AddPayee(vote(payee2));
+    BOOST_CHECK(payees.GetBestPayee(payeeBest));
+    BOOST_CHECK(payeeBest == payee1);
+    BOOST_CHECK(!payees.HasPayeeWithVotes(payee1, 2));
+
+    payees.AddPayee(vote(payee2));
+    BOOST_CHECK(payees.GetBestPayee(payeeBest));
+    BOOST_CHECK(payeeBest == payee2);
+    BOOST_CHECK(payees.HasPayeeWithVotes(payee2, 2));
+    BOOST_CHECK(!payees.HasPayeeWithVotes(payee1, 2));
+    BOOST_CHECK_EQUAL(payees.GetTotalVotes(), 3);
+    BOOST_CHECK(!payees.HasClearWinner());
+
+    // Tallies are rebuilt when loaded from disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << payees;
+    CMasternodeBlockPayees payeesLoaded;
+    ss >> payeesLoaded;
+    BOOST_CHECK_EQUAL(payeesLoaded.GetTotalVotes(), 3);
+    BOOST_CHECK(payeesLoaded.GetBestPayee(payeeBest));
+    BOOST_CHECK(payeeBest == payee2);
+    BOOST_CHECK(payeesLoaded.HasPayeeWithVotes(payee2, 2));
+}
+
+BOOST_AUTO_TEST_CASE(module_cache_writes_changes)
+{
+    CModuleCacheDB db(1 << 20, true);
+    CMasternodeManTest man;
+    CKey keyCollateral;
+    keyCollateral.MakeNewKey(true);
+    CMasternode mn1 = MakeMasternode(keyCollateral, 0);
+    CMasternode mn2 = MakeMasternode(keyCollateral, 1);
+    BOOST_CHECK(man.Add(mn1));
+    BOOST_CHECK(man.Add(mn2));
+    BOOST_CHECK_EQUAL(man.setCacheDirtyMasternodes.size(), 2U);
+
+    auto reload = [&db] {
+        CMasternodeManTest manLoaded;
+        BOOST_CHECK(db.Read(manLoaded));
+        return manLoaded.mapMasternodes;
+    };
+
+    // Added masternodes and the state are written and no longer dirty
+    man.fCacheStateDirty = true;
+    BOOST_CHECK(db.Flush(man, mnpayments, funding));
+    BOOST_CHECK(man.setCacheDirtyMasternodes.empty());
+    BOOST_CHECK(!man.fCacheStateDirty);
+    BOOST_CHECK_EQUAL(reload().size(), 2U);
+
+    // Only entries marked as changed are written
+    {
+        LOCK(man.cs);
+        man.Find(mn2.outpoint)->nProtocolVersion = 1;
+    }
+    BOOST_CHECK(man.PoSeBan(mn1.outpoint));
+    BOOST_CHECK(db.Flush(man, mnpayments, funding));
+    auto mapLoaded = reload();
+    BOOST_CHECK_EQUAL(mapLoaded.at(mn1.outpoint).nPoSeBanScore, MASTERNODE_POSE_BAN_MAX_SCORE);
+    BOOST_CHECK_EQUAL(mapLoaded.at(mn2.outpoint).nProtocolVersion, PROTOCOL_VERSION);
+
+    // Cleared masternodes are erased
+    man.Clear();
+    BOOST_CHECK_EQUAL(man.setCacheDirtyMasternodes.size(), 2U);
+    BOOST_CHECK(db.Flush(man, mnpayments, funding));
+    BOOST_CHECK(reload().empty());
+}
+
+BOOST_AUTO_TEST_CASE(module_cache_parallel_read)
+{
+    CModuleCacheDB db(1 << 20, true);
+    CKey keyCollateral;
+    keyCollateral.MakeNewKey(true);
+
+    // Modules read from their dat files are written to the database in full
+    CMasternodeManTest man;
+    for (uint32_t n = 0; n < 10; n++) {
+        CMasternode mn = MakeMasternode(keyCollateral, n);
+        BOOST_CHECK(man.Add(mn));
+    }
+    CDataStream ssMan(SER_DISK, CLIENT_VERSION);
+    ssMan << man;
+    CMasternodeManTest manMigrated;
+    ssMan >> manMigrated;
+
+    std::map<uint256, CMasternodePaymentVote> mapVotes;
+    std::map<int, CMasternodeBlockPayees> mapBlocks;
+    for (int nHeight = 100; nHeight < 110; nHeight++) {
+        CMasternodePaymentVote vote(COutPoint(InsecureRand256(), 0), nHeight, CScript() << OP_1);
+        mapVotes.emplace(vote.GetHash(), vote);
+        mapBlocks.emplace(nHeight, CMasternodeBlockPayees(nHeight)).first->second.AddPayee(vote);
+    }
+    CDataStream ssPayments(SER_DISK, CLIENT_VERSION);
+    ssPayments << mapVotes << mapBlocks;
+    CMasternodePayments paymentsMigrated;
+    ssPayments >> paymentsMigrated;
+
+    CGovernanceManager fundingMigrated;
+    fundingMigrated.Clear();
+    BOOST_CHECK(db.Flush(manMigrated, paymentsMigrated, fundingMigrated));
+
+    // The modules are read back in parallel, as at startup
+    CMasternodeManTest manLoaded;
+    CMasternodePayments paymentsLoaded;
+    CGovernanceManager fundingLoaded;
+    auto manRead = std::async(std::launch::async, [&] { return db.Read(manLoaded); });
+    auto paymentsRead = std::async(std::launch::async, [&] { return db.Read(paymentsLoaded); });
+    auto fundingRead = std::async(std::launch::async, [&] { return db.Read(fundingLoaded); });
+    BOOST_CHECK(manRead.get());
+    BOOST_CHECK(paymentsRead.get());
+    BOOST_CHECK(fundingRead.get());
+
+    BOOST_CHECK_EQUAL(manLoaded.size(), 10);
+    for (const auto& mnpair : man.mapMasternodes) {
+        BOOST_CHECK(manLoaded.Has(mnpair.first));
+    }
+    BOOST_CHECK_EQUAL(paymentsLoaded.GetVoteCount(), 10);
+    BOOST_CHECK_EQUAL(paymentsLoaded.GetBlockCount(), 10);
+    BOOST_CHECK_EQUAL(paymentsLoaded.mapMasternodeBlocks.at(105).GetTotalVotes(), 1);
+    BOOST_CHECK(manLoaded.setCacheDirtyMasternodes.empty());
+    BOOST_CHECK(paymentsLoaded.setCacheDirtyVotes.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
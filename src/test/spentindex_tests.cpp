@@ -0,0 +1,120 @@
+// Copyright (c) 2019 PM-Tech
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/spentindex.h>
+#include <rpc/server.h>
+#include <script/interpreter.h>
+#include <test/test_chaincoin.h>
+#include <undo.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <univalue.h>
+
+extern UniValue CallRPC(std::string args);
+
+BOOST_AUTO_TEST_SUITE(spentindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(spentindex_undo_mismatch, BasicTestingSetup)
+{
+    SpentIndex index(1 << 20, true, true);
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbase.GetHash(), 0));
+    spend.vin.emplace_back(COutPoint(InsecureRand256(), 1));
+    spend.vout.emplace_back(49 * COIN, CScript() << OP_TRUE);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(spend));
+
+    // Undo data which doesn't belong to the block is an error, not a crash
+    CBlockUndo block_undo;
+    BOOST_CHECK(!index.WriteSpentOutputs(block, block_undo, 10));
+    block_undo.vtxundo.resize(1);
+    block_undo.vtxundo[0].vprevout.emplace_back(CTxOut(50 * COIN, CScript()), 1, true);
+    BOOST_CHECK(!index.WriteSpentOutputs(block, block_undo, 10));
+
+    SpentInfo info;
+    BOOST_CHECK(!index.LookupSpent(spend.vin[0].prevout, info));
+
+    block_undo.vtxundo[0].vprevout.emplace_back(CTxOut(2 * COIN, CScript()), 5, false);
+    BOOST_CHECK(index.WriteSpentOutputs(block, block_undo, 10));
+    BOOST_CHECK(index.LookupSpent(spend.vin[1].prevout, info));
+    BOOST_CHECK(info.txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(info.input_index, 1U);
+    BOOST_CHECK_EQUAL(info.height, 10);
+    BOOST_CHECK_EQUAL(info.amount, 2 * COIN);
+}
+
+BOOST_FIXTURE_TEST_CASE(getspentinfo, TestChain100Setup)
+{
+    const COutPoint coinbase_outpoint(m_coinbase_txns[0]->GetHash(), 0);
+    const std::string coinbase_arg = coinbase_outpoint.hash.GetHex() + " 0";
+
+    // The index must be enabled
+    BOOST_CHECK_THROW(CallRPC("getspentinfo " + coinbase_arg), std::runtime_error);
+
+    g_spentindex = MakeUnique<SpentIndex>(1 << 20, true, true);
+    g_spentindex->Start();
+
+    // Spend the first coinbase output
+    CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.emplace_back(coinbase_outpoint);
+    spend.vout.emplace_back(5 * COIN, coinbase_script);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbase_script, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    CreateAndProcessBlock({spend}, coinbase_script);
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    UniValue result = CallRPC("getspentinfo " + coinbase_arg);
+    BOOST_CHECK_EQUAL(find_value(result.get_obj(), "txid").get_str(), spend.GetHash().GetHex());
+    BOOST_CHECK_EQUAL(find_value(result.get_obj(), "vin").get_int(), 0);
+    BOOST_CHECK_EQUAL(find_value(result.get_obj(), "height").get_int(), 101);
+    BOOST_CHECK_EQUAL(AmountFromValue(find_value(result.get_obj(), "amount")), m_coinbase_txns[0]->vout[0].nValue);
+
+    // Unspent outputs and bad arguments are errors
+    BOOST_CHECK_THROW(CallRPC("getspentinfo " + spend.GetHash().GetHex() + " 0"), std::runtime_error);
+    BOOST_CHECK_THROW(CallRPC("getspentinfo " + coinbase_outpoint.hash.GetHex() + " -1"), std::runtime_error);
+    BOOST_CHECK_THROW(CallRPC("getspentinfo " + coinbase_outpoint.hash.GetHex()), std::runtime_error);
+
+    // The output is unspent again once its spending block is disconnected
+    CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    CValidationState state;
+    BOOST_REQUIRE(InvalidateBlock(state, Params(), tip));
+    BOOST_REQUIRE(ActivateBestChain(state, Params()));
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_THROW(CallRPC("getspentinfo " + coinbase_arg), std::runtime_error);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    g_spentindex->Stop();
+    g_spentindex.reset();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -367,4 +367,55 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(checkinputscripts_parallel, TestChain100Setup)
+{
+    // Signed inputs of a mixing transaction are checked as they come in, before the transaction is complete
+    CScript p2pk_scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    // mature the coinbase outputs spent below
+    for (int i = 0; i < 3; i++) {
+        CreateAndProcessBlock({}, p2pk_scriptPubKey);
+    }
+
+    CMutableTransaction spend_tx;
+    spend_tx.nVersion = 1;
+    std::vector<std::pair<unsigned int, CTxOut>> inputs;
+    for (unsigned int i = 0; i < 4; i++) {
+        spend_tx.vin.emplace_back(COutPoint(m_coinbase_txns[i]->GetHash(), 0));
+        inputs.emplace_back(i, m_coinbase_txns[i]->vout[0]);
+    }
+    spend_tx.vout.emplace_back(11*CENT, p2pk_scriptPubKey);
+    for (unsigned int i = 0; i < spend_tx.vin.size(); i++) {
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(p2pk_scriptPubKey, spend_tx, i, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend_tx.vin[i].scriptSig << vchSig;
+    }
+
+    // Valid inputs pass, on the script check threads as well as on this one
+    BOOST_CHECK(CheckInputScriptsParallel(CTransaction(spend_tx), inputs, STANDARD_SCRIPT_VERIFY_FLAGS));
+    int script_check_threads = nScriptCheckThreads;
+    nScriptCheckThreads = 0;
+    BOOST_CHECK(CheckInputScriptsParallel(CTransaction(spend_tx), inputs, STANDARD_SCRIPT_VERIFY_FLAGS));
+    nScriptCheckThreads = script_check_threads;
+
+    // A signature for another input fails, but only when that input is checked
+    CMutableTransaction invalid_tx(spend_tx);
+    invalid_tx.vin[3].scriptSig = invalid_tx.vin[2].scriptSig;
+    BOOST_CHECK(!CheckInputScriptsParallel(CTransaction(invalid_tx), inputs, STANDARD_SCRIPT_VERIFY_FLAGS));
+    BOOST_CHECK(CheckInputScriptsParallel(CTransaction(invalid_tx), {inputs.begin(), inputs.begin() + 3}, STANDARD_SCRIPT_VERIFY_FLAGS));
+    nScriptCheckThreads = 0;
+    BOOST_CHECK(!CheckInputScriptsParallel(CTransaction(invalid_tx), inputs, STANDARD_SCRIPT_VERIFY_FLAGS));
+    nScriptCheckThreads = script_check_threads;
+
+    // Inputs are checked against the outputs they are said to spend
+    std::vector<std::pair<unsigned int, CTxOut>> wrong_inputs(inputs);
+    wrong_inputs[1].second.scriptPubKey = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    BOOST_CHECK(!CheckInputScriptsParallel(CTransaction(spend_tx), wrong_inputs, STANDARD_SCRIPT_VERIFY_FLAGS));
+
+    // The checked transaction is still accepted to the mempool
+    BOOST_CHECK(ToMemPool(spend_tx));
+    mempool.clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,7 +9,9 @@
 #include <consensus/validation.h>
 #include <miner.h>
 #include <pow.h>
+#include <protocol.h>
 #include <random.h>
+#include <streams.h>
 #include <test/test_chaincoin.h>
 #include <validation.h>
 #include <validationinterface.h>
@@ -184,4 +186,56 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, chainActive.Tip()->GetBlockHash());
 }
 
+/** Append a block to a block file as framed by the network magic and its size */
+static void WriteFramed(CDataStream& file, const CDataStream& payload)
+{
+    file.write((const char*)Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE);
+    file << static_cast<unsigned int>(payload.size());
+    file.write(payload.data(), payload.size());
+}
+
+BOOST_AUTO_TEST_CASE(load_external_block_file_corrupt)
+{
+    const std::shared_ptr<const CBlock> block1 = GoodBlock(Params().GenesisBlock().GetHash());
+    const std::shared_ptr<const CBlock> block2 = GoodBlock(block1->GetHash());
+    const std::shared_ptr<const CBlock> block3 = GoodBlock(block2->GetHash());
+
+    // block2 is hidden in the frame of a corrupt block, which is followed by
+    // more than the import buffer of padding before block3
+    CDataStream file(SER_DISK, CLIENT_VERSION);
+    CDataStream payload(SER_DISK, CLIENT_VERSION);
+    payload << *block1;
+    WriteFramed(file, payload);
+
+    CDataStream corrupt(SER_DISK, CLIENT_VERSION);
+    corrupt << block1->GetBlockHeader();
+    corrupt.insert(corrupt.end(), 9, '\xff'); // a transaction count too large to read
+    payload.clear();
+    payload << *block2;
+    WriteFramed(corrupt, payload);
+    WriteFramed(file, corrupt);
+
+    file.insert(file.end(), 3 * MAX_BLOCK_SERIALIZED_SIZE, '\0');
+    payload.clear();
+    payload << *block3;
+    WriteFramed(file, payload);
+
+    const fs::path path = GetDataDir() / "bootstrap_corrupt.dat";
+    FILE* fileOut = fsbridge::fopen(path, "wb");
+    BOOST_REQUIRE(fileOut);
+    BOOST_REQUIRE_EQUAL(fwrite(file.data(), 1, file.size(), fileOut), file.size());
+    fclose(fileOut);
+
+    // All blocks are found again by scanning the corrupt frame once the earlier block is imported
+    FILE* fileIn = fsbridge::fopen(path, "rb");
+    BOOST_REQUIRE(fileIn);
+    BOOST_CHECK(LoadExternalBlockFile(Params(), fileIn));
+    LOCK(cs_main);
+    for (const auto& block : {block1, block2, block3}) {
+        const CBlockIndex* pindex = LookupBlockIndex(block->GetHash());
+        BOOST_REQUIRE(pindex);
+        BOOST_CHECK(pindex->nStatus & BLOCK_HAVE_DATA);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -37,6 +37,14 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to CoinJoin! index DB specific cache (MiB)
+static const int64_t nMaxCoinJoinIndexCache = 16;
+//! Max memory allocated to address index DB specific cache (MiB)
+static const int64_t nMaxAddressIndexCache = 1024;
+//! Max memory allocated to spent index DB specific cache (MiB)
+static const int64_t nMaxSpentIndexCache = 1024;
+//! Max memory allocated to all block filter index caches combined in MiB.
+static const int64_t nMaxBlockFilterIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
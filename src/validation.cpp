@@ -46,9 +46,14 @@
 #include <modules/masternode/masternode_man.h>
 #include <modules/masternode/masternode_payments.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <mutex>
 #include <numeric>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -1513,7 +1518,9 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
@@ -1544,6 +1551,8 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1713,6 +1722,26 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+bool CheckInputScriptsParallel(const CTransaction& tx, const std::vector<std::pair<unsigned int, CTxOut>>& vInputs, unsigned int flags)
+{
+    PrecomputedTransactionData txdata(tx);
+    CCheckQueueControl<CScriptCheck> control(nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    std::vector<CScriptCheck> vChecks;
+    vChecks.reserve(vInputs.size());
+    for (const auto& input : vInputs) {
+        // store the signatures in the signature cache, the whole transaction will be checked again later
+        CScriptCheck check(input.second, tx, input.first, flags, true, &txdata);
+        if (!nScriptCheckThreads) {
+            if (!check()) return false;
+            continue;
+        }
+        vChecks.push_back(CScriptCheck());
+        check.swap(vChecks.back());
+    }
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -3397,6 +3426,12 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+    {
+        // Warm the header hash caches in one batch outside cs_main, this is a
+        // no-op for headers already hashed by the caller
+        std::vector<uint256> hashes(headers.size());
+        HashC11Batch(headers.data(), headers.size(), hashes.data());
+    }
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
@@ -3857,6 +3892,93 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
     return true;
 }
 
+/** Number of block index entries a worker hashes in one go when checking their proof of work. */
+static const size_t BLOCK_INDEX_POW_CHUNK = 2000;
+
+bool CheckBlockIndexProofOfWork(const CChainParams& chainparams)
+{
+    const int64_t nStart = GetTimeMillis();
+
+    std::vector<const CBlockIndex*> vToCheck;
+    size_t nEntries;
+    {
+        LOCK(cs_main);
+        std::vector<const CBlockIndex*> vTrustedTips;
+        if (!gArgs.GetBoolArg("-checkindexpow", DEFAULT_CHECK_INDEX_POW)) {
+            if (fCheckpointsEnabled) {
+                const CBlockIndex* pcheckpoint = Checkpoints::GetLastCheckpoint(chainparams.Checkpoints());
+                if (pcheckpoint) vTrustedTips.push_back(pcheckpoint);
+            }
+            if (!hashAssumeValid.IsNull()) {
+                const CBlockIndex* pindexAssumeValid = LookupBlockIndex(hashAssumeValid);
+                if (pindexAssumeValid) vTrustedTips.push_back(pindexAssumeValid);
+            }
+        }
+
+        nEntries = mapBlockIndex.size();
+        vToCheck.reserve(nEntries);
+        for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex) {
+            const CBlockIndex* pindex = item.second;
+            bool fTrusted = false;
+            for (const CBlockIndex* pindexTip : vTrustedTips) {
+                if (pindexTip->GetAncestor(pindex->nHeight) == pindex) {
+                    fTrusted = true;
+                    break;
+                }
+            }
+            if (!fTrusted) vToCheck.push_back(pindex);
+        }
+    }
+
+    // The headers of loaded entries never change, so they are hashed without cs_main
+
+    // Workers claim chunks of entries until all are checked or one fails
+    std::atomic<size_t> nNext{0};
+    std::atomic<bool> fFailed{false};
+    std::mutex csFailed;
+    const CBlockIndex* pindexFailed = nullptr;
+    auto worker = [&]() {
+        std::vector<CBlockHeader> vHeader;
+        std::vector<uint256> vHash;
+        while (!fFailed) {
+            const size_t nBegin = nNext.fetch_add(BLOCK_INDEX_POW_CHUNK);
+            if (nBegin >= vToCheck.size()) break;
+            const size_t nCount = std::min(BLOCK_INDEX_POW_CHUNK, vToCheck.size() - nBegin);
+            vHeader.resize(nCount);
+            vHash.resize(nCount);
+            for (size_t i = 0; i < nCount; i++) {
+                vHeader[i] = vToCheck[nBegin + i]->GetBlockHeader();
+            }
+            HashC11Batch(vHeader.data(), nCount, vHash.data());
+            for (size_t i = 0; i < nCount; i++) {
+                const CBlockIndex* pindex = vToCheck[nBegin + i];
+                if (vHash[i] != pindex->GetBlockHash() || !CheckProofOfWork(vHash[i], pindex->nBits, chainparams.GetConsensus())) {
+                    std::lock_guard<std::mutex> lock(csFailed);
+                    if (!pindexFailed) pindexFailed = pindex;
+                    fFailed = true;
+                    break;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> vThreads;
+    for (int i = 1; i < nScriptCheckThreads; i++) {
+        vThreads.emplace_back(&TraceThread<std::function<void()>>, "idxpow", std::function<void()>(worker));
+    }
+    worker();
+    for (std::thread& thread : vThreads) {
+        thread.join();
+    }
+
+    if (pindexFailed) {
+        return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexFailed->ToString());
+    }
+    LogPrintf("%s: checked proof of work of %u of %u block index entries in %dms\n", __func__,
+        vToCheck.size(), nEntries, GetTimeMillis() - nStart);
+    return true;
+}
+
 bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     if (!g_chainstate.LoadBlockIndex(chainparams.GetConsensus(), *pblocktree))
@@ -4379,6 +4501,159 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return g_chainstate.LoadGenesisBlock(chainparams);
 }
 
+/** Maximum number of threads deserializing and checking the blocks of an imported block file */
+static const int MAX_IMPORT_WORKERS = 8;
+/** Number of blocks framed ahead of the one being connected, per import worker */
+static const size_t IMPORT_BLOCKS_PER_WORKER = 16;
+/** How far ahead of the earliest block not connected yet the blocks of an imported file are framed */
+static const uint64_t IMPORT_READAHEAD_SIZE = MAX_BLOCK_SERIALIZED_SIZE + 8;
+
+namespace {
+
+/**
+ * Deserializes, hashes and checks the blocks LoadExternalBlockFile finds in a
+ * block file on worker threads, and hands them back in file order so that
+ * they are still connected to the block index one at a time.
+ */
+class ExternalBlockReader
+{
+public:
+    struct Job {
+        /// The serialized block, as framed by LoadExternalBlockFile.
+        CDataStream data{SER_DISK, CLIENT_VERSION};
+        uint64_t nBlockPos;
+        /// Where scanning continues if the block cannot be deserialized.
+        uint64_t nRewindPos;
+        /// Where scanning was continued assuming the block fills its frame.
+        uint64_t nFramedEnd;
+
+        std::shared_ptr<CBlock> block;
+        uint256 hash;
+        std::string error;
+        /// Where scanning has to continue, once deserialized.
+        uint64_t nNextPos;
+        bool done{false};
+    };
+
+    ExternalBlockReader(const Consensus::Params& consensus_params, int n_workers)
+        : m_consensus_params(consensus_params)
+    {
+        for (int i = 0; i < n_workers; i++) {
+            m_workers.emplace_back(&ExternalBlockReader::ThreadWorker, this);
+        }
+    }
+
+    ~ExternalBlockReader()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    size_t Size() const
+    {
+        LOCK(m_mutex);
+        return m_jobs.size();
+    }
+
+    /// Position the earliest queued block rewinds to on failure.
+    uint64_t FrontRewindPos() const
+    {
+        LOCK(m_mutex);
+        assert(!m_jobs.empty());
+        return m_jobs.front()->nRewindPos;
+    }
+
+    void Push(std::unique_ptr<Job> job)
+    {
+        {
+            LOCK(m_mutex);
+            m_pending.push_back(job.get());
+            m_jobs.push_back(std::move(job));
+        }
+        m_cv.notify_all();
+    }
+
+    /// Wait for the earliest queued block to be deserialized and remove it.
+    std::unique_ptr<Job> Pop()
+    {
+        WAIT_LOCK(m_mutex, lock);
+        assert(!m_jobs.empty());
+        m_cv.wait(lock, [this] { return m_jobs.front()->done; });
+        std::unique_ptr<Job> job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        return job;
+    }
+
+    /// Drop all queued blocks, waiting for the ones being deserialized.
+    void Clear()
+    {
+        WAIT_LOCK(m_mutex, lock);
+        // the jobs not picked up yet are the last ones queued
+        m_jobs.resize(m_jobs.size() - m_pending.size());
+        m_pending.clear();
+        m_cv.wait(lock, [this] {
+            return std::all_of(m_jobs.begin(), m_jobs.end(), [](const std::unique_ptr<Job>& job) { return job->done; });
+        });
+        m_jobs.clear();
+    }
+
+private:
+    void ThreadWorker()
+    {
+        RenameThread("chaincoin-loadblkw");
+        while (true) {
+            Job* job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+                if (m_stop) return;
+                job = m_pending.front();
+                m_pending.pop_front();
+            }
+
+            const uint64_t nSize = job->data.size();
+            try {
+                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                job->data >> *pblock;
+                job->hash = pblock->GetHash();
+                // Cache the context-free checks, AcceptBlock reports their failures
+                CValidationState state;
+                CheckBlock(*pblock, state, m_consensus_params);
+                job->nNextPos = job->nBlockPos + nSize - job->data.size();
+                job->block = std::move(pblock);
+            } catch (const std::exception& e) {
+                job->error = e.what();
+                job->nNextPos = job->nRewindPos;
+            }
+
+            {
+                LOCK(m_mutex);
+                job->done = true;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    const Consensus::Params& m_consensus_params;
+
+    mutable Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::unique_ptr<Job>> m_jobs GUARDED_BY(m_mutex);
+    /// Jobs not picked up by a worker yet.
+    std::deque<Job*> m_pending GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -4387,45 +4662,102 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
 
     int nLoaded = 0;
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor. It can rewind
+        // to any framed block even with the buffer filled up to IMPORT_READAHEAD_SIZE past the read position.
+        CBufferedFile blkdat(fileIn, 3*IMPORT_READAHEAD_SIZE, 2*IMPORT_READAHEAD_SIZE, SER_DISK, CLIENT_VERSION);
+        const int nWorkers = std::max(1, std::min(GetNumCores(), MAX_IMPORT_WORKERS));
+        ExternalBlockReader reader(chainparams.GetConsensus(), nWorkers);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        bool fEndOfFile = false;
+        while (true) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+            // Frame the blocks following the one connected next, and have them deserialized
+            // by the workers. Every framed block stays within the range blkdat can rewind to.
+            while (!fEndOfFile && reader.Size() < nWorkers * IMPORT_BLOCKS_PER_WORKER) {
+                if (!blkdat.SetPos(nRewind)) {
+                    throw std::runtime_error(strprintf("%s: Failed to rewind block file to position %u", __func__, nRewind));
+                }
+                if (blkdat.eof()) {
+                    fEndOfFile = true;
+                    break;
+                }
+                nRewind++; // start one byte further next time, in case of failure
+                // Scanning further than a header short of the range blkdat can rewind to would
+                // lose the blocks framed so far
+                const bool fScanLimited = reader.Size() > 0;
+                const uint64_t nScanLimit = fScanLimited ? std::max(reader.FrontRewindPos() + MAX_BLOCK_SERIALIZED_SIZE, blkdat.GetPos())
+                                                         : std::numeric_limits<uint64_t>::max();
+                blkdat.SetLimit(nScanLimit);
+                unsigned int nSize = 0;
+                uint64_t nHeaderPos = nScanLimit;
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(chainparams.MessageStart()[0]);
+                    nHeaderPos = blkdat.GetPos();
+                    nRewind = nHeaderPos+1;
+                    blkdat.SetLimit(); // remove the scan limit
+                    blkdat >> buf;
+                    if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                        continue;
+                } catch (const std::exception&) {
+                    if (fScanLimited && !blkdat.eof()) {
+                        // scan on from here once the earlier blocks are connected
+                        nRewind = nHeaderPos;
+                        break;
+                    }
+                    // no valid block header found; don't complain
+                    fEndOfFile = true;
+                    break;
+                }
+                uint64_t nBlockPos = blkdat.GetPos();
+                if (reader.Size() > 0 && nBlockPos + nSize > reader.FrontRewindPos() + IMPORT_READAHEAD_SIZE) {
+                    // frame it again once the earlier blocks are connected
+                    nRewind = nHeaderPos;
+                    break;
+                }
+                std::unique_ptr<ExternalBlockReader::Job> job = MakeUnique<ExternalBlockReader::Job>();
+                job->nBlockPos = nBlockPos;
+                job->nRewindPos = nRewind;
+                try {
+                    // read block
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    job->data.resize(nSize);
+                    blkdat.read(job->data.data(), nSize);
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                     continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
+                }
+                nRewind = job->nFramedEnd = nBlockPos + nSize;
+                reader.Push(std::move(job));
+            }
+            if (reader.Size() == 0) {
                 break;
             }
+
+            std::unique_ptr<ExternalBlockReader::Job> job = reader.Pop();
+            if (job->nNextPos != job->nFramedEnd) {
+                // The block does not fill its frame, the blocks framed after it are scanned again
+                reader.Clear();
+                nRewind = job->nNextPos;
+                fEndOfFile = false;
+            }
+            if (!job->block) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, job->error);
+                continue;
+            }
             try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                    dbp->nPos = job->nBlockPos;
+                std::shared_ptr<CBlock> pblock = job->block;
                 CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
 
-                uint256 hash = block.GetHash();
+                const uint256& hash = job->hash;
                 {
                     LOCK(cs_main);
                     // detect out of order blocks, and store them for later
@@ -123,6 +123,7 @@ void CCoinJoinClientManager::ProcessMessage(CNode* pfrom, const std::string& str
             LOCK(cs_vecqueue);
             // process every queue only once
             // status has changed, update and remove if closed
+            int nMasternodeQueues = 0;
             for (std::vector<CCoinJoinQueue>::iterator it = vecCoinJoinQueue.begin(); it!=vecCoinJoinQueue.end(); ++it) {
                 if (*it == queue) {
                     LogPrint(BCLog::CJOIN, "%s CJQUEUE -- seen CoinJoin queue (%s) from masternode %s, vecCoinJoinQueue size: %d from %s\n",
@@ -133,11 +134,15 @@ void CCoinJoinClientManager::ProcessMessage(CNode* pfrom, const std::string& str
                              m_wallet->GetDisplayName(), queue.ToString(), infoMn.addr.ToString(), GetQueueSize(), pfrom->addr.ToStringIPPort());
                     if (queue.status > it->status) it->status = queue.status;
                 } else if (it->masternodeOutpoint == queue.masternodeOutpoint) {
-                    // refuse to create another queue this often
-                    LogPrint(BCLog::CJOIN, "%s CJQUEUE -- last request is still in queue, return.\n", m_wallet->GetDisplayName());
-                    return;
+                    nMasternodeQueues++;
                 }
             }
+
+            if (nMasternodeQueues >= COINJOIN_MAX_SESSIONS) {
+                // refuse to create another queue this often
+                LogPrint(BCLog::CJOIN, "%s CJQUEUE -- last requests are still in queue, return.\n", m_wallet->GetDisplayName());
+                return;
+            }
         }
 
 
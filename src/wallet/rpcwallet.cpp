@@ -2794,9 +2794,10 @@ static UniValue listunspent(const JSONRPCRequest& request)
             "    \"spendable\" : xxx,        (bool) Whether we have the private keys to spend this output\n"
             "    \"solvable\" : xxx,         (bool) Whether we know how to spend this output, ignoring the lack of keys\n"
             "    \"desc\" : xxx,             (string, only when solvable) A descriptor for spending this output\n"
-            "    \"safe\" : xxx              (bool) Whether this output is considered safe to spend. Unconfirmed transactions\n"
+            "    \"safe\" : xxx,            (bool) Whether this output is considered safe to spend. Unconfirmed transactions\n"
             "                              from outside keys and unconfirmed replacement transactions are considered unsafe\n"
             "                              and are not eligible for spending by fundrawtransaction and sendtoaddress.\n"
+            "    \"cj_depth\" : n            (numeric) The CoinJoin! depth of the output, -2 if not denominated (needs -coinjoinindex)\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -2940,7 +2941,7 @@ static UniValue listunspent(const JSONRPCRequest& request)
             entry.pushKV("desc", descriptor->ToString());
         }
         entry.pushKV("safe", out.fSafe);
-        // temporarily disabled due to lock order entry.pushKV("cj_depth", pwallet->chain().analyzeCoin(COutPoint(out.tx->GetHash(), out.i)));
+        entry.pushKV("cj_depth", pwallet->chain().analyzeCoin(COutPoint(out.tx->GetHash(), out.i), out.tx->tx->vout[out.i].nValue));
         results.push_back(entry);
     }
 
@@ -2106,7 +2106,7 @@ CAmount CWalletTx::GetDenominatedCredit(interfaces::Chain::Lock& locked_chain, i
         {
             const CTxOut &txout = tx->vout[i];
             const COutPoint outpoint = COutPoint(hashTx, i);
-            const int nDepth = nCoinJoinDepth  ? pwallet->chain().analyzeCoin(outpoint) : 0;
+            const int nDepth = nCoinJoinDepth  ? pwallet->chain().analyzeCoin(outpoint, txout.nValue) : 0;
             if(nDepth >= nCoinJoinDepth){
                 nCredit += pwallet->GetCredit(txout, ISMINE_SPENDABLE);
             }
@@ -2707,7 +2707,7 @@ bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAm
 
             if(coin_selection_params.use_private) {
                 COutPoint outpoint = COutPoint(out.tx->GetHash(), out.i);
-                int nDepth = chain().analyzeCoin(outpoint);
+                int nDepth = chain().analyzeCoin(outpoint, out.tx->tx->vout[out.i].nValue);
                 // make sure it's actually anonymized
                 if(nDepth < coinjoinClient->nCoinJoinDepth) continue;
             }
@@ -2729,7 +2729,7 @@ bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAm
                 //make sure it's the denom we're looking for, round the amount up to smallest denom
                 if(out.tx->tx->vout[out.i].nValue == denom && nValueRet + denom < nTargetValue + nSmallestDenom) {
                     COutPoint outpoint = COutPoint(out.tx->GetHash(), out.i);
-                    int nDepth = chain().analyzeCoin(outpoint);
+                    int nDepth = chain().analyzeCoin(outpoint, denom);
                     // make sure it's actually anonymized
                     if(nDepth < coinjoinClient->nCoinJoinDepth) continue;
                     nValueRet += out.tx->tx->vout[out.i].nValue;
@@ -2909,7 +2909,7 @@ bool CWallet::SelectJoinCoins(CAmount nValueMin, CAmount nValueMax, std::vector<
         if (nValueRet + out.tx->tx->vout[out.i].nValue <= nValueMax) {
             CTxIn txin = CTxIn(out.tx->tx->GetHash(), out.i);
 
-            int nDepth = chain().analyzeCoin(txin.prevout);
+            int nDepth = chain().analyzeCoin(txin.prevout, out.tx->tx->vout[out.i].nValue);
             CAmount nValueCoin = out.tx->tx->vout[out.i].nValue;
             nValueRet += nValueCoin;
             cjPairRet.emplace_back(std::make_pair(txin, CTxOut(nValueCoin, CScript(), nDepth)));